@@ -0,0 +1,397 @@
+/*
+ * Measures how long estimator and controller take to react to real pressure
+ * on the local host, from its onset to the first estimation without offers
+ * and the first kill, respectively.
+ *
+ * Each run forks a child process that generates the pressure:
+ *
+ * - `memory`: the child allocates and touches anonymous memory at a fixed
+ *   rate. The memory threshold is set `--memory_margin` above the memory
+ *   used before the run. The onset is the moment the child has allocated
+ *   that much, as reported by the child itself.
+ * - `cpu`: the child forks `--cpu_workers` busy loops. The 1 minute load
+ *   threshold is set half the number of workers above the load before the
+ *   run. The onset is the start of the workers. As the load average is an
+ *   exponentially weighted average, expect latencies of several seconds.
+ *
+ * Estimator and controller sample the actual host. The resource usage of
+ * the agent is faked with a revocable executor standing in for the child
+ * and a non-revocable one. Both modules are polled every `--intervals`,
+ * i.e. the intervals the agent would use, until the controller kills or
+ * `--timeout` expires. No Mesos agent is needed.
+ */
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
+#include <stout/error.hpp>
+#include <stout/flags.hpp>
+#include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/strings.hpp>
+
+#include <glog/logging.h>
+
+#include "config.hpp"
+#include "os.hpp"
+#include "samplers.hpp"
+#include "threshold_qos_controller.hpp"
+#include "threshold_resource_estimator.hpp"
+
+#include "testutils.hpp"
+
+using std::string;
+using std::vector;
+
+using mesos::slave::QoSCorrection;
+
+using com::blue_yonder::ThresholdQoSController;
+using com::blue_yonder::ThresholdResourceEstimator;
+using com::blue_yonder::os::meminfo;
+
+
+namespace {
+
+class Flags : public virtual flags::FlagsBase
+{
+public:
+  Flags()
+  {
+    add(&Flags::scenarios,
+        "scenarios",
+        "Comma separated kinds of pressure to generate: memory, cpu.",
+        "memory,cpu");
+
+    add(&Flags::intervals,
+        "intervals",
+        "Comma separated intervals at which estimations and corrections are triggered.",
+        "100ms,1secs,5secs");
+
+    add(&Flags::runs,
+        "runs",
+        "Number of runs per scenario and interval.",
+        5);
+
+    add(&Flags::memory_margin,
+        "memory_margin",
+        "Memory the child allocates before the memory threshold is reached.",
+        Megabytes(512));
+
+    add(&Flags::memory_rate,
+        "memory_rate",
+        "Memory the child allocates per second.",
+        Megabytes(256));
+
+    add(&Flags::cpu_workers,
+        "cpu_workers",
+        "Number of busy loops of the CPU pressure. Defaults to the number of CPUs.");
+
+    add(&Flags::timeout,
+        "timeout",
+        "Maximum duration of a single run.",
+        Minutes(3));
+
+    add(&Flags::cooldown,
+        "cooldown",
+        "Pause between two runs to let the host settle.",
+        Seconds(5));
+  }
+
+  string scenarios;
+  string intervals;
+  size_t runs;
+  Bytes memory_margin;
+  Bytes memory_rate;
+  Option<size_t> cpu_workers;
+  Duration timeout;
+  Duration cooldown;
+};
+
+
+typedef std::chrono::steady_clock Clock;
+
+// Nanoseconds on the monotonic clock, which is shared with the children
+int64_t monotonicNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void sleepFor(Duration const& duration) {
+  std::this_thread::sleep_for(std::chrono::nanoseconds(duration.ns()));
+}
+
+
+/*
+ * The children only use async-signal-safe calls, as they are forked from a
+ * process running the libprocess threads.
+ */
+void reportOnset(int fd) {
+  int64_t const onset = monotonicNanos();
+  ssize_t const written = write(fd, &onset, sizeof(onset));
+  (void) written;
+}
+
+[[noreturn]] void growMemory(int fd, Bytes const& margin, Bytes const& rate) {
+  size_t const chunk = 16 * 1024 * 1024;
+  uint64_t const nanos = 1000000000ull * chunk / std::max<uint64_t>(rate.bytes(), 1);
+  struct timespec const delay = {
+    static_cast<time_t>(nanos / 1000000000), static_cast<long>(nanos % 1000000000)};
+
+  bool reported = false;
+  for (size_t allocated = 0; allocated < 2 * margin.bytes(); allocated += chunk) {
+    void* memory = mmap(nullptr, chunk, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      break;
+    }
+    memset(memory, 1, chunk);
+    if (!reported && allocated + chunk >= margin.bytes()) {
+      reportOnset(fd);
+      reported = true;
+    }
+    nanosleep(&delay, nullptr);
+  }
+
+  // Hold on to the memory until killed
+  while (true) {
+    pause();
+  }
+}
+
+[[noreturn]] void burnCpu(int fd, size_t workers) {
+  // The workers are killed along with their process group
+  for (size_t i = 1; i < workers; ++i) {
+    if (fork() == 0) {
+      break;
+    }
+  }
+  if (getpid() == getpgrp()) {
+    reportOnset(fd);
+  }
+  volatile uint64_t counter = 0;
+  while (true) {
+    ++counter;
+  }
+}
+
+
+struct Latencies
+{
+  vector<double> estimator; // milliseconds
+  vector<double> controller;
+  size_t early = 0; // decisions before the onset, e.g. due to other pressure
+  size_t timeouts = 0;
+};
+
+struct Run
+{
+  Option<double> estimator;
+  Option<double> controller;
+};
+
+/*
+ * Performs a single run of the given scenario and returns the latencies of
+ * estimator and controller in milliseconds.
+ */
+Try<Run> run(string const& scenario, Duration const& interval, Flags const& flags) {
+  Configuration config;
+  config.resources = Resources::parse("cpus(*):1;mem(*):1024").get();
+
+  size_t const workers = flags.cpu_workers.getOrElse(std::thread::hardware_concurrency());
+  if (scenario == "memory") {
+    auto const memory = meminfo();
+    if (memory.isError()) {
+      return Error("Failed to sample memory: " + memory.error());
+    }
+    config.memThreshold =
+      memory.get().total - memory.get().memAvailable + flags.memory_margin;
+  } else if (scenario == "cpu") {
+    auto const load = ::os::loadavg();
+    if (load.isError()) {
+      return Error("Failed to sample load: " + load.error());
+    }
+    config.loadThreshold.one = load.get().one + workers / 2.0;
+  } else {
+    return Error("Unknown scenario '" + scenario + "'");
+  }
+
+  // The revocable executor stands in for the child and is the victim of kills
+  ResourceUsageFake usage;
+  usage.set("cpus(*):1;mem(*):1024", "cpus(*):1;mem(*):1024");
+
+  ThresholdResourceEstimator estimator(Samplers(), config);
+  ThresholdQoSController controller(Samplers(), config);
+  estimator.initialize(usage);
+  controller.initialize(usage);
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return ErrnoError("Failed to create pipe");
+  }
+
+  pid_t const child = fork();
+  if (child < 0) {
+    return ErrnoError("Failed to fork");
+  }
+  if (child == 0) {
+    close(fds[0]);
+    setpgid(0, 0);
+    if (scenario == "memory") {
+      growMemory(fds[1], flags.memory_margin, flags.memory_rate);
+    }
+    burnCpu(fds[1], workers);
+  }
+  close(fds[1]);
+  setpgid(child, child);
+
+  Run result;
+  Option<int64_t> estimatorDecision;
+  Option<int64_t> controllerDecision;
+  auto const deadline = Clock::now() + std::chrono::nanoseconds(flags.timeout.ns());
+  while (controllerDecision.isNone() && Clock::now() < deadline) {
+    auto const next = Clock::now() + std::chrono::nanoseconds(interval.ns());
+
+    if (estimatorDecision.isNone() && estimator.oversubscribable().get().empty()) {
+      estimatorDecision = monotonicNanos();
+    }
+
+    std::list<QoSCorrection> const corrections = controller.corrections().get();
+    if (!corrections.empty()) {
+      controllerDecision = monotonicNanos();
+    }
+
+    std::this_thread::sleep_until(next);
+  }
+
+  kill(-child, SIGKILL);
+  waitpid(child, nullptr, 0);
+
+  // The child has written the onset before it was killed, if it got that far
+  int64_t onset = 0;
+  bool const reachedOnset = read(fds[0], &onset, sizeof(onset)) == sizeof(onset);
+  close(fds[0]);
+
+  if (reachedOnset) {
+    if (estimatorDecision.isSome()) {
+      result.estimator = (estimatorDecision.get() - onset) / 1e6;
+    }
+    if (controllerDecision.isSome()) {
+      result.controller = (controllerDecision.get() - onset) / 1e6;
+    }
+  } else if (controllerDecision.isSome()) {
+    // Killed before the child got to generate the intended pressure
+    result.controller = -1.0;
+  }
+  return result;
+}
+
+// Nearest-rank percentile of the sorted values
+double percentile(vector<double> const& sorted, double percentile) {
+  size_t const rank = static_cast<size_t>(std::ceil(percentile * sorted.size()));
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void print(string const& scenario, Duration const& interval, string const& module, vector<double> values) {
+  std::cout << std::left << std::setw(10) << scenario << std::setw(10) << stringify(interval)
+            << std::setw(12) << module << std::right << std::setw(6) << values.size();
+  if (values.empty()) {
+    std::cout << std::endl;
+    return;
+  }
+
+  std::sort(values.begin(), values.end());
+  std::cout << std::fixed << std::setprecision(1)
+            << std::setw(10) << values.front()
+            << std::setw(10) << percentile(values, 0.5)
+            << std::setw(10) << percentile(values, 0.9)
+            << std::setw(10) << percentile(values, 0.99)
+            << std::setw(10) << values.back() << std::endl;
+}
+
+} // namespace {
+
+
+int main(int argc, char** argv) {
+  Flags flags;
+  Try<flags::Warnings> load = flags.load(None(), argc, argv);
+  if (load.isError()) {
+    std::cerr << flags.usage(load.error()) << std::endl;
+    return 1;
+  }
+  if (flags.help) {
+    std::cout << flags.usage() << std::endl;
+    return 0;
+  }
+
+  // Threshold crossings are logged on every decision
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  FLAGS_minloglevel = google::WARNING;
+
+  vector<Duration> intervals;
+  foreach (string const& value, strings::tokenize(flags.intervals, ",")) {
+    Try<Duration> interval = Duration::parse(value);
+    if (interval.isError()) {
+      std::cerr << "Invalid interval '" << value << "': " << interval.error() << std::endl;
+      return 1;
+    }
+    intervals.push_back(interval.get());
+  }
+
+  std::cout << std::left << std::setw(10) << "scenario" << std::setw(10) << "interval"
+            << std::setw(12) << "module" << std::right << std::setw(6) << "runs"
+            << std::setw(10) << "min ms" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms"
+            << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::endl;
+
+  foreach (string const& scenario, strings::tokenize(flags.scenarios, ",")) {
+    foreach (Duration const& interval, intervals) {
+      Latencies latencies;
+      for (size_t i = 0; i < flags.runs; ++i) {
+        Try<Run> result = run(scenario, interval, flags);
+        if (result.isError()) {
+          std::cerr << result.error() << std::endl;
+          return 1;
+        }
+
+        auto const& latency = result.get();
+        if (latency.controller.isNone()) {
+          ++latencies.timeouts;
+        } else if (latency.controller.get() < 0) {
+          ++latencies.early;
+        } else {
+          latencies.controller.push_back(latency.controller.get());
+        }
+        if (latency.estimator.isSome() && latency.estimator.get() >= 0) {
+          latencies.estimator.push_back(latency.estimator.get());
+        }
+
+        sleepFor(flags.cooldown);
+      }
+
+      print(scenario, interval, "estimator", latencies.estimator);
+      print(scenario, interval, "controller", latencies.controller);
+      if (latencies.early > 0 || latencies.timeouts > 0) {
+        std::cout << "  " << latencies.early << " runs killed before the onset, "
+                  << latencies.timeouts << " runs timed out" << std::endl;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,223 @@
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stout/bytes.hpp>
+#include <stout/os.hpp>
+
+#include <glog/logging.h>
+
+#include <benchmark/benchmark.h>
+
+#include "os.hpp"
+#include "proc_parser.hpp"
+#include "threshold.hpp"
+#include "threshold_qos_controller.hpp"
+#include "threshold_resource_estimator.hpp"
+
+#include "testutils.hpp"
+
+using com::blue_yonder::ThresholdQoSController;
+using com::blue_yonder::ThresholdResourceEstimator;
+using com::blue_yonder::os::meminfo;
+using com::blue_yonder::os::parseDiskStats;
+using com::blue_yonder::os::parseVmStat;
+
+namespace proc = com::blue_yonder::proc;
+
+namespace threshold = com::blue_yonder::threshold;
+
+namespace {
+
+/*
+ * Fills the usage with the given number of executors, half of them revocable.
+ * Memory footprints differ so that the victim selection has to compare them.
+ */
+void setExecutors(ResourceUsageFake& usage, int64_t executors) {
+  std::vector<std::string> revocable;
+  std::vector<std::string> nonRevocable;
+  for (int64_t i = 0; i < executors; ++i) {
+    auto const resources = "cpus(*):0.5;mem(*):" + std::to_string(32 + i % 97);
+    (i % 2 == 0 ? revocable : nonRevocable).push_back(resources);
+  }
+  usage.setMany(revocable, nonRevocable);
+}
+
+void BM_MemInfo(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(meminfo());
+  }
+}
+BENCHMARK(BM_MemInfo);
+
+/*
+ * Content of /proc/diskstats with the given number of devices, as on hosts
+ * with many disks and partitions.
+ */
+std::string diskstatsContent(int64_t devices) {
+  std::string content;
+  for (int64_t i = 0; i < devices; ++i) {
+    content += "   8      " + std::to_string(i) + " sd" + std::to_string(i) +
+      " 9046321 173018 1240374826 3862452 41277052 10470452 2014561568 76305932"
+      " 0 13426176 80210540 0 0 0 0 1021553 2053217\n";
+  }
+  return content;
+}
+
+void BM_FindNewlineScalar(benchmark::State& state) {
+  auto const content = diskstatsContent(64);
+  while (state.KeepRunning()) {
+    for (char const* current = content.data(); current != content.data() + content.size();) {
+      current = proc::detail::findNewlineScalar(current, content.data() + content.size());
+      current += current != content.data() + content.size();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * content.size());
+}
+BENCHMARK(BM_FindNewlineScalar);
+
+void BM_FindNewline(benchmark::State& state) {
+  auto const content = diskstatsContent(64);
+  while (state.KeepRunning()) {
+    for (char const* current = content.data(); current != content.data() + content.size();) {
+      current = proc::findNewline(current, content.data() + content.size());
+      current += current != content.data() + content.size();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * content.size());
+}
+BENCHMARK(BM_FindNewline);
+
+void BM_ParseUint(benchmark::State& state) {
+  std::string const value = "1240374826";
+  uint64_t parsed = 0;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(proc::parseUint(proc::View(value), parsed));
+  }
+}
+BENCHMARK(BM_ParseUint);
+
+void BM_VmStat(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(com::blue_yonder::os::vmstat());
+  }
+}
+BENCHMARK(BM_VmStat);
+
+void BM_ParseVmStat(benchmark::State& state) {
+  std::string const content =
+    "nr_free_pages 1021553\npgscan_kswapd 0\npgscan_direct 10413\npgscan_direct_throttle 0\n"
+    "pgsteal_kswapd 40127\npgsteal_direct 9046\npgsteal_anon 3011\nallocstall_dma 0\n"
+    "allocstall_normal 12\nallocstall_movable 81\npswpin 7711\npswpout 80210\npgfault 2053217\n";
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(parseVmStat(proc::View(content), 0));
+  }
+}
+BENCHMARK(BM_ParseVmStat);
+
+void BM_ParseDiskStats(benchmark::State& state) {
+  auto const content = diskstatsContent(state.range(0));
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(parseDiskStats(proc::View(content), 0));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseDiskStats)->RangeMultiplier(8)->Range(8, 512);
+
+// The stream based parsing `parseDiskStats` replaced, as a baseline
+void BM_ParseDiskStatsStream(benchmark::State& state) {
+  auto const content = diskstatsContent(state.range(0));
+  while (state.KeepRunning()) {
+    std::istringstream proc{content};
+    std::map<std::string, std::pair<uint64_t, uint64_t>> devices;
+    std::string line;
+    while (std::getline(proc, line)) {
+      std::istringstream fields{line};
+      std::string major, minor, name;
+      uint64_t counters[11] = {};
+      fields >> major >> minor >> name;
+      for (auto& counter : counters) {
+        fields >> counter;
+      }
+      devices[name] = std::make_pair(counters[9], counters[10]);
+    }
+    benchmark::DoNotOptimize(devices);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseDiskStatsStream)->RangeMultiplier(8)->Range(8, 512);
+
+void BM_LoadExceedsThreshold(benchmark::State& state) {
+  Try<os::Load> const load = os::Load{3.9, 2.9, 1.9};
+  os::Load const loadThreshold{4, 3, 2};
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(threshold::loadExceedsThreshold(load, loadThreshold));
+  }
+}
+BENCHMARK(BM_LoadExceedsThreshold);
+
+void BM_MemExceedsThreshold(benchmark::State& state) {
+  Try<MemInfo> const memory = MemInfo{Bytes::parse("512MB").get(), Bytes::parse("300MB").get()};
+  Bytes const memThreshold = Bytes::parse("384MB").get();
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(threshold::memExceedsThreshold(memory, memThreshold));
+  }
+}
+BENCHMARK(BM_MemExceedsThreshold);
+
+void BM_CalcUnusedResources(benchmark::State& state) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  setExecutors(usage, state.range(0));
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  ThresholdResourceEstimator estimator(
+    Samplers(load, memory),
+    makeConfiguration(
+      "cpus(*):100000;mem(*):100000000", os::Load{4, 3, 2}, Bytes::parse("384MB").get()));
+  estimator.initialize(usage);
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(estimator.oversubscribable().get());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CalcUnusedResources)
+  ->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMicrosecond);
+
+void BM_Corrections(benchmark::State& state) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  setExecutors(usage, state.range(0));
+
+  // Exceed the memory threshold so that the victim selection is measured.
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "0MB");
+
+  ThresholdQoSController controller(
+    Samplers(load, memory), makeConfiguration("", os::Load{4, 3, 2}, Bytes::parse("384MB").get()));
+  controller.initialize(usage);
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(controller.corrections().get());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Corrections)
+  ->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMicrosecond);
+
+} // namespace {
+
+int main(int argc, char** argv) {
+  // Threshold crossings are logged on every decision, which would dominate
+  // the measurements.
+  FLAGS_minloglevel = google::WARNING;
+
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include "checkpoint.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stout/error.hpp>
+#include <stout/os/mkdir.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include <process/clock.hpp>
+
+using process::Owned;
+
+using com::blue_yonder::Checkpoint;
+
+
+namespace {
+
+char const MAGIC[8] = {'T', 'H', 'R', 'S', 'T', 'A', 'T', 'E'};
+
+// FNV-1a, sufficient to detect torn writes.
+uint64_t checksum(char const* data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+} // namespace {
+
+
+Try<Owned<Checkpoint>> Checkpoint::open(std::string const& path, uint32_t version) {
+  auto const directory = Path(path).dirname();
+  auto const created = ::os::mkdir(directory);
+  if (created.isError()) {
+    return Error("Failed to create " + directory + ": " + created.error());
+  }
+
+  // The state names the executors running on the host, so it is only
+  // readable by the agent. A file of an earlier version may be less strict.
+  int const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return ErrnoError("Failed to open " + path);
+  }
+  if (fchmod(fd, 0600) != 0) {
+    auto const error = ErrnoError("Failed to restrict access to " + path);
+    ::close(fd);
+    return error;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    auto const error = ErrnoError("Failed to stat " + path);
+    ::close(fd);
+    return error;
+  }
+
+  // A new file is zeroed, so it is not mistaken for a valid state. Blocks
+  // are allocated up front, as running out of disk space while writing to
+  // the mapping would raise SIGBUS rather than fail.
+  size_t const size = std::max<size_t>(status.st_size, sizeof(Header));
+  int const allocated = posix_fallocate(fd, 0, size);
+  if (allocated != 0) {
+    auto const error = Error("Failed to allocate " + path + ": " + strerror(allocated));
+    ::close(fd);
+    return error;
+  }
+
+  void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    auto const error = ErrnoError("Failed to map " + path);
+    ::close(fd);
+    return error;
+  }
+
+  return Owned<Checkpoint>(new Checkpoint(path, version, fd, mapping, size));
+}
+
+Checkpoint::Checkpoint(
+    std::string const& path,
+    uint32_t version,
+    int fd,
+    void* mapping,
+    size_t size)
+  : location(path),
+    version(version),
+    fd(fd),
+    mapping(mapping),
+    size(size)
+{}
+
+Checkpoint::~Checkpoint() {
+  munmap(mapping, size);
+  ::close(fd);
+}
+
+Checkpoint::Header* Checkpoint::header() const {
+  return static_cast<Header*>(mapping);
+}
+
+char* Checkpoint::data() const {
+  return static_cast<char*>(mapping) + sizeof(Header);
+}
+
+bool Checkpoint::valid(Duration const& maxAge) const {
+  Header const* const current = header();
+  if (memcmp(current->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      current->version != version ||
+      current->stateSize > size - sizeof(Header) ||
+      current->checksum != checksum(data(), current->stateSize)) {
+    return false;
+  }
+
+  double const age = process::Clock::now().secs() - current->timestamp;
+  return age >= 0 && age <= maxAge.secs();
+}
+
+Option<std::string> Checkpoint::restore(Duration const& maxAge) const {
+  if (!valid(maxAge)) {
+    return None();
+  }
+  return std::string(data(), header()->stateSize);
+}
+
+Try<Nothing> Checkpoint::save(std::string const& state) {
+  if (state.size() > std::numeric_limits<uint32_t>::max()) {
+    return Error("State of " + stringify(state.size()) + " bytes is too large");
+  }
+
+  size_t const required = sizeof(Header) + state.size();
+  if (required > size) {
+    size_t const grown = std::max(required, 2 * size);
+    int const allocated = posix_fallocate(fd, 0, grown);
+    if (allocated != 0) {
+      return Error("Failed to grow " + location + ": " + strerror(allocated));
+    }
+    void* remapped = mmap(nullptr, grown, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (remapped == MAP_FAILED) {
+      return ErrnoError("Failed to map " + location);
+    }
+    munmap(mapping, size);
+    mapping = remapped;
+    size = grown;
+  }
+
+  Header* const current = header();
+  memcpy(data(), state.data(), state.size());
+  memcpy(current->magic, MAGIC, sizeof(MAGIC));
+  current->version = version;
+  current->stateSize = static_cast<uint32_t>(state.size());
+  current->timestamp = process::Clock::now().secs();
+  current->checksum = checksum(data(), state.size());
+  return Nothing();
+}
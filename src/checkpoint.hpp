@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include <process/owned.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+/*
+ * Persists the decision state of a module in a memory-mapped file so that it
+ * survives restarts of the agent.
+ *
+ * The file consists of a `Header` followed by the serialized state, see
+ * `StateWriter`. Saving the state is a plain copy into the mapping, the
+ * kernel takes care of writing it back. The mapping grows geometrically with
+ * the state. A checksum guards against states that have only partially been
+ * written when the host went down.
+ *
+ * A checkpoint is not thread-safe. Saving it may allocate disk space and
+ * touches the whole state, so the modules save it on their I/O thread, one
+ * save at a time.
+ */
+class Checkpoint
+{
+public:
+  struct Header
+  {
+    char magic[8]; // "THRSTATE"
+    uint32_t version;
+    uint32_t stateSize;
+    double timestamp; // of the last save
+    uint64_t checksum; // of the state
+  };
+
+  // Opens or creates the checkpoint file at `path`.
+  static Try<process::Owned<Checkpoint>> open(std::string const& path, uint32_t version);
+
+  ~Checkpoint();
+
+  /*
+   * Returns the state saved by a previous incarnation, if it is of the
+   * expected version, intact, and has been saved at most `maxAge` ago.
+   */
+  Option<std::string> restore(Duration const& maxAge) const;
+
+  Try<Nothing> save(std::string const& state);
+
+  std::string const& path() const { return location; }
+
+private:
+  Checkpoint(std::string const& path, uint32_t version, int fd, void* mapping, size_t size);
+  Checkpoint(Checkpoint const&) = delete;
+  Checkpoint& operator=(Checkpoint const&) = delete;
+
+  bool valid(Duration const& maxAge) const;
+
+  Header* header() const;
+  char* data() const;
+
+  std::string const location;
+  uint32_t const version;
+  int fd;
+  void* mapping;
+  size_t size; // of the mapping
+};
+
+
+/*
+ * Serializes the state of a module into a byte string for a `Checkpoint`.
+ * Values are written in native byte order, as a checkpoint never leaves its
+ * host. Any change to what a module writes must bump the version of its
+ * checkpoint.
+ */
+class StateWriter
+{
+public:
+  // Replaces the content of `buffer`, reusing its capacity
+  explicit StateWriter(std::string& buffer) : buffer(buffer) { buffer.clear(); }
+
+  template <typename T>
+  void write(T const& value)
+  {
+    static_assert(std::is_pod<T>::value, "Value must be POD");
+    buffer.append(reinterpret_cast<char const*>(&value), sizeof(value));
+  }
+
+  void write(std::string const& value)
+  {
+    write(static_cast<uint64_t>(value.size()));
+    buffer.append(value);
+  }
+
+  template <typename T>
+  void write(Option<T> const& value)
+  {
+    write(value.isSome());
+    if (value.isSome()) {
+      write(value.get());
+    }
+  }
+
+  template <typename Value>
+  void write(std::map<std::string, Value> const& values)
+  {
+    write(static_cast<uint64_t>(values.size()));
+    for (auto const& value : values) {
+      write(value.first);
+      write(value.second);
+    }
+  }
+
+private:
+  std::string& buffer;
+};
+
+
+/*
+ * Reads a state written by a `StateWriter`, in the same order. Every read
+ * returns false if the state ends prematurely, leaving the value unspecified.
+ */
+class StateReader
+{
+public:
+  explicit StateReader(std::string const& buffer) : buffer(buffer), position{0} {}
+
+  template <typename T>
+  bool read(T& value)
+  {
+    static_assert(std::is_pod<T>::value, "Value must be POD");
+    if (buffer.size() - position < sizeof(value)) {
+      return false;
+    }
+    memcpy(&value, buffer.data() + position, sizeof(value));
+    position += sizeof(value);
+    return true;
+  }
+
+  bool read(std::string& value)
+  {
+    uint64_t length;
+    if (!read(length) || buffer.size() - position < length) {
+      return false;
+    }
+    value.assign(buffer, position, length);
+    position += length;
+    return true;
+  }
+
+  template <typename T>
+  bool read(Option<T>& value)
+  {
+    bool some;
+    if (!read(some)) {
+      return false;
+    }
+    if (!some) {
+      value = None();
+      return true;
+    }
+    T present;
+    if (!read(present)) {
+      return false;
+    }
+    value = present;
+    return true;
+  }
+
+  template <typename Value>
+  bool read(std::map<std::string, Value>& values)
+  {
+    uint64_t count;
+    if (!read(count)) {
+      return false;
+    }
+    values.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+      std::string key;
+      Value value;
+      if (!read(key) || !read(value)) {
+        return false;
+      }
+      values.emplace(key, value);
+    }
+    return true;
+  }
+
+  // Whether all of the state has been read
+  bool done() const { return position == buffer.size(); }
+
+private:
+  std::string const& buffer;
+  size_t position;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
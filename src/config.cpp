@@ -0,0 +1,526 @@
+#include "config.hpp"
+
+#include <limits>
+#include <set>
+#include <string>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/numify.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+#include <stout/os/read.hpp>
+
+#include "executor_history.hpp"
+
+using mesos::Resources;
+using ::os::Load;
+
+using com::blue_yonder::Configuration;
+using com::blue_yonder::ExecutorHistory;
+
+
+namespace {
+
+struct ParsingError
+{
+  std::string message;
+
+  ParsingError(std::string const& description, std::string const& error)
+    : message("Failed to parse " + description + ": " + error)
+  {}
+};
+
+double parseDouble(std::string const& value, std::string const& description) {
+  auto thresholdParam = numify<double>(value);
+  if (thresholdParam.isError()) {
+    throw ParsingError{description, thresholdParam.error()};
+  }
+  if (thresholdParam.get() < 0) {
+    throw ParsingError{description, "Must not be negative"};
+  }
+  return thresholdParam.get();
+}
+
+std::string const SHADOW_PREFIX = "shadow_";
+
+// Parameters only read on startup of a module. They are not accepted from the
+// config file, as a reload would silently ignore them.
+std::set<std::string> const STARTUP_PARAMETERS = {
+  "config_file",
+  "shm_export",
+  "shm_mode",
+  "state_dir",
+  "state_max_age",
+  "trace_dump",
+};
+
+// Parameters of the sampling both policies share. A shadow policy judged on
+// other devices or interfaces than it was given would be misleading.
+std::set<std::string> const SAMPLING_PARAMETERS = {
+  "io_devices",
+  "net_interfaces",
+  "sample_timeout",
+};
+
+void parseParameters(mesos::Parameters const& parameters, Configuration& config) {
+  for (auto const& parameter : parameters.parameter()) {
+    // Shadow parameters are parsed into a configuration of their own
+    if (strings::startsWith(parameter.key(), SHADOW_PREFIX)) {
+      continue;
+    }
+
+    // Parse the resource to offer for oversubscription
+    if (parameter.key() == "resources") {
+      Try<Resources> parsed = Resources::parse(parameter.value());
+      if (parsed.isError()) {
+        throw ParsingError("resources", parsed.error());
+      }
+      config.resources = parsed.get();
+    }
+
+    // Parse any thresholds
+    if (parameter.key() == "load_threshold_1min") {
+      config.loadThreshold.one = parseDouble(parameter.value(), "1 min load threshold");
+    } else if (parameter.key() == "load_threshold_5min") {
+      config.loadThreshold.five = parseDouble(parameter.value(), "5 min load threshold");
+    } else if (parameter.key() == "load_threshold_15min") {
+      config.loadThreshold.fifteen = parseDouble(parameter.value(), "15 min load threshold");
+    } else if (parameter.key() == "mem_threshold") {
+      auto thresholdParam = Bytes::parse(parameter.value() + "MB");
+      if (thresholdParam.isError()) {
+        throw ParsingError("memory threshold", thresholdParam.error());
+      }
+      config.memThreshold = thresholdParam.get();
+    } else if (parameter.key() == "pgscan_direct_threshold") {
+      config.reclaimThreshold.pgscanDirect = parseDouble(parameter.value(), "direct page scan threshold");
+    } else if (parameter.key() == "pgsteal_threshold") {
+      config.reclaimThreshold.pgsteal = parseDouble(parameter.value(), "page steal threshold");
+    } else if (parameter.key() == "allocstall_threshold") {
+      config.reclaimThreshold.allocstall = parseDouble(parameter.value(), "allocation stall threshold");
+    } else if (parameter.key() == "swap_threshold") {
+      config.reclaimThreshold.swap = parseDouble(parameter.value(), "swap threshold");
+    } else if (parameter.key() == "throttle_ratio_threshold") {
+      config.throttleRatioThreshold = parseDouble(parameter.value(), "throttle ratio threshold");
+    } else if (parameter.key() == "io_util_threshold") {
+      config.ioUtilThreshold = parseDouble(parameter.value(), "I/O utilization threshold");
+    } else if (parameter.key() == "io_queue_depth_threshold") {
+      config.ioQueueDepthThreshold = parseDouble(parameter.value(), "I/O queue depth threshold");
+    } else if (parameter.key() == "io_devices") {
+      config.ioDevices.clear();
+      for (auto const& device : strings::tokenize(parameter.value(), ", ")) {
+        config.ioDevices.insert(device);
+      }
+    } else if (parameter.key() == "net_rx_threshold") {
+      config.netRxThreshold = parseDouble(parameter.value(), "network receive threshold");
+    } else if (parameter.key() == "net_tx_threshold") {
+      config.netTxThreshold = parseDouble(parameter.value(), "network transmit threshold");
+    } else if (parameter.key() == "net_interfaces") {
+      config.netInterfaces.clear();
+      for (auto const& interface : strings::tokenize(parameter.value(), ", ")) {
+        config.netInterfaces.insert(interface);
+      }
+    } else if (parameter.key() == "runqueue_delay_threshold") {
+      config.runQueueDelayThreshold = parseDouble(parameter.value(), "run queue delay threshold");
+    } else if (parameter.key() == "cpu_frequency_threshold") {
+      config.cpuFrequencyThreshold = parseDouble(parameter.value(), "CPU frequency threshold");
+      if (config.cpuFrequencyThreshold == 0) {
+        throw ParsingError("CPU frequency threshold", "Must be positive");
+      }
+    }
+
+    // Parse the time to wait for host samples
+    if (parameter.key() == "sample_timeout") {
+      auto timeout = Duration::parse(parameter.value());
+      if (timeout.isError()) {
+        throw ParsingError("sample timeout", timeout.error());
+      }
+      if (timeout.get() <= Duration::zero()) {
+        throw ParsingError("sample timeout", "Must be positive");
+      }
+      config.sampleTimeout = timeout.get();
+    }
+
+    // Parse the ramping of offers
+    if (parameter.key() == "offer_ramp_increase") {
+      config.offerRampIncrease = parseDouble(parameter.value(), "offer ramp increase");
+      if (config.offerRampIncrease == 0) {
+        throw ParsingError("offer ramp increase", "Must be positive");
+      }
+    } else if (parameter.key() == "offer_ramp_decrease") {
+      config.offerRampDecrease = parseDouble(parameter.value(), "offer ramp decrease");
+      if (config.offerRampDecrease > 1) {
+        throw ParsingError("offer ramp decrease", "Must not be greater than 1");
+      }
+    }
+
+    // Parse the headroom for non-revocable peaks
+    if (parameter.key() == "headroom_percentile") {
+      config.headroomPercentile = parseDouble(parameter.value(), "headroom percentile");
+      if (config.headroomPercentile.get() > 1) {
+        throw ParsingError("headroom percentile", "Must not be greater than 1");
+      }
+    } else if (parameter.key() == "headroom_margin") {
+      config.headroomMargin = parseDouble(parameter.value(), "headroom margin");
+    } else if (parameter.key() == "headroom_window") {
+      auto window = numify<size_t>(parameter.value());
+      if (window.isError()) {
+        throw ParsingError("headroom window", window.error());
+      }
+      if (window.get() == 0) {
+        throw ParsingError("headroom window", "Must be positive");
+      }
+      config.headroomWindow = window.get();
+    }
+
+    // Parse the victim selection on memory pressure
+    if (parameter.key() == "memory_victim") {
+      if (parameter.value() == "largest") {
+        config.memoryVictim = Configuration::LARGEST;
+      } else if (parameter.value() == "growth") {
+        config.memoryVictim = Configuration::GROWTH;
+      } else {
+        throw ParsingError("memory victim", "Must be 'largest' or 'growth'");
+      }
+    } else if (parameter.key() == "memory_growth_window") {
+      auto window = numify<size_t>(parameter.value());
+      if (window.isError()) {
+        throw ParsingError("memory growth window", window.error());
+      }
+      // The growth is fitted to the executor history, which needs one
+      // snapshot more than the window spans.
+      if (window.get() < 2 || window.get() >= ExecutorHistory::DEFAULT_WINDOW) {
+        throw ParsingError(
+          "memory growth window",
+          "Must be between 2 and " + stringify(ExecutorHistory::DEFAULT_WINDOW - 1));
+      }
+      config.memoryGrowthWindow = window.get();
+    }
+
+    // Parse the victim selection by lost work
+    if (parameter.key() == "victim_selection") {
+      if (parameter.value() == "usage") {
+        config.victimSelection = Configuration::USAGE;
+      } else if (parameter.value() == "lost_work") {
+        config.victimSelection = Configuration::LOST_WORK;
+      } else {
+        throw ParsingError("victim selection", "Must be 'usage' or 'lost_work'");
+      }
+    } else if (parameter.key() == "priority_label") {
+      config.priorityLabel = parameter.value();
+    } else if (parameter.key() == "lost_work_min_share") {
+      config.lostWorkMinShare = parseDouble(parameter.value(), "lost work minimum share");
+      if (config.lostWorkMinShare > 1) {
+        throw ParsingError("lost work minimum share", "Must not be greater than 1");
+      }
+    }
+
+    // Parse the kernel memory protection
+    if (parameter.key() == "memory_protection") {
+      if (parameter.value() != "true" && parameter.value() != "false") {
+        throw ParsingError("memory protection", "Must be 'true' or 'false'");
+      }
+      config.memoryProtection = parameter.value() == "true";
+    } else if (parameter.key() == "cgroup_root") {
+      config.cgroupRoot = parameter.value();
+    } else if (parameter.key() == "revocable_cgroup") {
+      config.revocableCgroup = parameter.value();
+    } else if (parameter.key() == "memory_high_min") {
+      auto minimum = Bytes::parse(parameter.value() + "MB");
+      if (minimum.isError()) {
+        throw ParsingError("minimum memory.high", minimum.error());
+      }
+      config.memoryHighMin = minimum.get();
+    } else if (parameter.key() == "oom_score_adj") {
+      auto score = numify<int>(parameter.value());
+      if (score.isError()) {
+        throw ParsingError("OOM score adjustment", score.error());
+      }
+      if (score.get() < -1000 || score.get() > 1000) {
+        throw ParsingError("OOM score adjustment", "Must be between -1000 and 1000");
+      }
+      config.oomScoreAdj = score.get();
+    }
+
+    // Parse the location of the runtime configuration
+    if (parameter.key() == "config_file") {
+      config.configFile = parameter.value();
+    }
+
+    // Parse the state checkpointing
+    if (parameter.key() == "state_dir") {
+      config.stateDir = parameter.value();
+    } else if (parameter.key() == "state_max_age") {
+      auto maxAge = Duration::parse(parameter.value());
+      if (maxAge.isError()) {
+        throw ParsingError("maximum state age", maxAge.error());
+      }
+      config.stateMaxAge = maxAge.get();
+    } else if (parameter.key() == "trace_dump") {
+      if (parameter.value() != "true" && parameter.value() != "false") {
+        throw ParsingError("trace dump", "Must be 'true' or 'false'");
+      }
+      config.traceDump = parameter.value() == "true";
+    }
+
+    // Parse the shared memory export
+    if (parameter.key() == "shm_export") {
+      if (parameter.value() != "true" && parameter.value() != "false") {
+        throw ParsingError("shared memory export", "Must be 'true' or 'false'");
+      }
+      config.shmExport = parameter.value() == "true";
+    } else if (parameter.key() == "shm_mode") {
+      // Octal like chmod, read and write permissions only. The module itself
+      // needs to write the segment.
+      auto const& value = parameter.value();
+      if (value.empty() || value.size() > 4 ||
+          value.find_first_not_of("01234567") != std::string::npos) {
+        throw ParsingError("shared memory mode", "Must be an octal mode, e.g. 0640");
+      }
+      auto const mode = std::stoul(value, nullptr, 8);
+      if ((mode & ~0666ul) != 0 || (mode & 0600ul) != 0600ul) {
+        throw ParsingError(
+          "shared memory mode",
+          "Must only grant read and write permissions, including both to the owner");
+      }
+      config.shmMode = static_cast<mode_t>(mode);
+    }
+  }
+}
+
+// Returns the parameters prefixed with `shadow_`, without the prefix. Only
+// parameters of the policy itself can be shadowed.
+mesos::Parameters shadowParameters(mesos::Parameters const& parameters) {
+  mesos::Parameters shadow;
+  for (auto const& parameter : parameters.parameter()) {
+    if (strings::startsWith(parameter.key(), SHADOW_PREFIX)) {
+      auto const key = parameter.key().substr(SHADOW_PREFIX.size());
+      if (STARTUP_PARAMETERS.count(key) > 0 ||
+          SAMPLING_PARAMETERS.count(key) > 0 ||
+          strings::startsWith(key, SHADOW_PREFIX)) {
+        throw ParsingError(
+          "shadow policy",
+          "'" + parameter.key() + "' is shared with the live policy and cannot be shadowed");
+      }
+      auto* stripped = shadow.add_parameter();
+      stripped->set_key(key);
+      stripped->set_value(parameter.value());
+    }
+  }
+  return shadow;
+}
+
+} // namespace {
+
+
+Configuration::Configuration()
+  : resources(),
+    loadThreshold{
+      std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max()},
+    memThreshold(std::numeric_limits<uint64_t>::max()),
+    reclaimThreshold{
+      std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max(),
+      std::numeric_limits<double>::max()},
+    throttleRatioThreshold(std::numeric_limits<double>::max()),
+    ioUtilThreshold(std::numeric_limits<double>::max()),
+    ioQueueDepthThreshold(std::numeric_limits<double>::max()),
+    ioDevices(),
+    netRxThreshold(std::numeric_limits<double>::max()),
+    netTxThreshold(std::numeric_limits<double>::max()),
+    netInterfaces(),
+    runQueueDelayThreshold(std::numeric_limits<double>::max()),
+    cpuFrequencyThreshold(0),
+    sampleTimeout(Seconds(5)),
+    offerRampIncrease(1),
+    offerRampDecrease(0.5),
+    headroomPercentile(None()),
+    headroomMargin(0.1),
+    headroomWindow(360),
+    memoryVictim(LARGEST),
+    memoryGrowthWindow(8),
+    victimSelection(USAGE),
+    priorityLabel("priority"),
+    lostWorkMinShare(0.5),
+    memoryProtection(false),
+    cgroupRoot("/sys/fs/cgroup/mesos"),
+    revocableCgroup(None()),
+    memoryHighMin(Megabytes(64)),
+    oomScoreAdj(1000),
+    shadow(),
+    configFile(None()),
+    stateDir(None()),
+    stateMaxAge(Minutes(5)),
+    traceDump(false),
+    shmExport(false),
+    shmMode(0600),
+    parameters()
+{}
+
+bool Configuration::samplesVmStat() const {
+  auto const never = std::numeric_limits<double>::max();
+  return reclaimThreshold.pgscanDirect < never ||
+         reclaimThreshold.pgsteal < never ||
+         reclaimThreshold.allocstall < never ||
+         reclaimThreshold.swap < never;
+}
+
+bool Configuration::samplesDiskStats() const {
+  auto const never = std::numeric_limits<double>::max();
+  return ioUtilThreshold < never || ioQueueDepthThreshold < never;
+}
+
+bool Configuration::samplesNetDev() const {
+  auto const never = std::numeric_limits<double>::max();
+  return netRxThreshold < never || netTxThreshold < never;
+}
+
+bool Configuration::samplesSchedStat() const {
+  return runQueueDelayThreshold < std::numeric_limits<double>::max();
+}
+
+bool Configuration::samplesCpuFreq() const {
+  // The frequency is a lower bound, so it is not configured at 0
+  return cpuFrequencyThreshold > 0;
+}
+
+bool Configuration::rampsOffers() const {
+  return offerRampIncrease < 1;
+}
+
+std::ostream& com::blue_yonder::operator<<(std::ostream& stream, Configuration const& config) {
+  stream << "Resources: " << config.resources << " "
+         << "Load thresholds: " << config.loadThreshold.one << " "
+         << config.loadThreshold.five << " " << config.loadThreshold.fifteen << " "
+         << "Memory threshold: " << config.memThreshold;
+
+  if (config.samplesVmStat()) {
+    stream << " Reclaim thresholds: " << config.reclaimThreshold.pgscanDirect << " "
+           << config.reclaimThreshold.pgsteal << " " << config.reclaimThreshold.allocstall << " "
+           << config.reclaimThreshold.swap;
+  }
+  if (config.throttleRatioThreshold < std::numeric_limits<double>::max()) {
+    stream << " Throttle ratio threshold: " << config.throttleRatioThreshold;
+  }
+  if (config.samplesDiskStats()) {
+    stream << " I/O thresholds: " << config.ioUtilThreshold << " "
+           << config.ioQueueDepthThreshold << " "
+           << (config.ioDevices.empty() ? "all devices" : strings::join(",", config.ioDevices));
+  }
+  if (config.samplesNetDev()) {
+    stream << " Network thresholds: " << config.netRxThreshold << " "
+           << config.netTxThreshold << " "
+           << (config.netInterfaces.empty()
+               ? "all interfaces" : strings::join(",", config.netInterfaces));
+  }
+  if (config.samplesSchedStat()) {
+    stream << " Run queue delay threshold: " << config.runQueueDelayThreshold << "ms";
+  }
+  if (config.samplesCpuFreq()) {
+    stream << " CPU frequency threshold: " << config.cpuFrequencyThreshold << "%";
+  }
+  if (config.rampsOffers()) {
+    stream << " Offer ramp: +" << config.offerRampIncrease << " *" << config.offerRampDecrease;
+  }
+  if (config.memoryVictim == Configuration::GROWTH) {
+    stream << " Memory victim: growth over " << config.memoryGrowthWindow << " corrections";
+  }
+  if (config.victimSelection == Configuration::LOST_WORK) {
+    stream << " Victim selection: lost work, priority label " << config.priorityLabel
+           << ", minimum share " << config.lostWorkMinShare;
+  }
+  if (config.memoryProtection) {
+    stream << " Memory protection: " << config.revocableCgroup.getOrElse(config.cgroupRoot)
+           << " memory.high >= " << config.memoryHighMin << " oom_score_adj " << config.oomScoreAdj;
+  }
+  if (config.headroomPercentile.isSome()) {
+    stream << " Headroom: p" << 100 * config.headroomPercentile.get() << " +"
+           << 100 * config.headroomMargin << "% over " << config.headroomWindow << " estimations";
+  }
+  if (config.shmExport) {
+    stream << " Shared memory export with mode 0" << std::oct << config.shmMode << std::dec;
+  }
+  if (config.shadow.get() != nullptr) {
+    stream << " Shadow policy: [" << *config.shadow << "]";
+  }
+  return stream;
+}
+
+Try<Configuration> com::blue_yonder::parseConfiguration(mesos::Parameters const& parameters) {
+  Configuration config;
+  config.parameters = parameters;
+
+  try {
+    parseParameters(parameters, config);
+    auto shadow = shadowParameters(parameters);
+
+    if (config.configFile.isSome()) {
+      auto const path = config.configFile.get();
+      auto const overrides = readConfigFile(path);
+      if (overrides.isError()) {
+        throw ParsingError("config file '" + path + "'", overrides.error());
+      }
+      for (auto const& parameter : overrides.get().parameter()) {
+        if (STARTUP_PARAMETERS.count(parameter.key()) > 0) {
+          throw ParsingError(
+            "config file '" + path + "'",
+            "'" + parameter.key() + "' requires a restart and must be a module parameter");
+        }
+      }
+      parseParameters(overrides.get(), config);
+      shadow.MergeFrom(shadowParameters(overrides.get()));
+    }
+
+    // Unlike the temporary directory, the state directory is private to the
+    // agent, so nobody else can plant a link at the name of the dump.
+    if (config.traceDump && config.stateDir.isNone()) {
+      throw ParsingError("trace dump", "Requires a state directory");
+    }
+
+    // The shadow policy starts out as a copy of the live one. Only thresholds,
+    // offers and victims matter as it never acts.
+    if (shadow.parameter_size() > 0) {
+      Configuration shadowConfig = config;
+      try {
+        parseParameters(shadow, shadowConfig);
+      } catch (ParsingError e) {
+        throw ParsingError("shadow policy", e.message);
+      }
+      config.shadow = std::make_shared<Configuration const>(shadowConfig);
+    }
+  } catch (ParsingError e) {
+    return Error(e.message);
+  }
+
+  return config;
+}
+
+Try<mesos::Parameters> com::blue_yonder::readConfigFile(std::string const& path) {
+  Try<std::string> content = ::os::read(path);
+  if (content.isError()) {
+    return Error(content.error());
+  }
+
+  Try<JSON::Object> object = JSON::parse<JSON::Object>(content.get());
+  if (object.isError()) {
+    return Error(object.error());
+  }
+  return parametersFromJSON(object.get());
+}
+
+Try<mesos::Parameters> com::blue_yonder::parametersFromJSON(JSON::Object const& object) {
+  mesos::Parameters parameters;
+  foreachpair (std::string const& key, JSON::Value const& value, object.values) {
+    if (!value.is<JSON::String>()) {
+      return Error("Value of '" + key + "' must be a string");
+    }
+    auto* parameter = parameters.add_parameter();
+    parameter->set_key(key);
+    parameter->set_value(value.as<JSON::String>().value);
+  }
+  return parameters;
+}
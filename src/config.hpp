@@ -0,0 +1,144 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+
+#include <sys/types.h>
+
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
+#include <stout/json.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+#include "threshold.hpp"
+
+namespace com {
+namespace blue_yonder {
+
+/*
+ * The configuration of a threshold module as given by its module parameters.
+ * Thresholds that are not configured are never reached.
+ */
+struct Configuration
+{
+  Configuration();
+
+  mesos::Resources resources;
+  ::os::Load loadThreshold;
+  Bytes memThreshold;
+  threshold::ReclaimRates reclaimThreshold;
+  double throttleRatioThreshold;
+  double ioUtilThreshold;
+  double ioQueueDepthThreshold;
+  std::set<std::string> ioDevices; // all if empty
+  double netRxThreshold; // fraction of the link speed
+  double netTxThreshold; // fraction of the link speed
+  std::set<std::string> netInterfaces; // all with a known link speed if empty
+  double runQueueDelayThreshold; // milliseconds per timeslice
+  double cpuFrequencyThreshold; // percent of the nominal frequency, reached at or below
+
+  // Time after which a decision is taken as if sampling the host failed
+  Duration sampleTimeout;
+
+  // Fraction of the revocable resources added to the offers per estimation
+  // while no threshold is reached, and the factor they are cut by once one is
+  double offerRampIncrease;
+  double offerRampDecrease;
+
+  // Percentile of the usage of non-revocable executors to reserve, the
+  // margin added on top as a fraction of it, and the number of estimations
+  // the percentile is taken over
+  Option<double> headroomPercentile;
+  double headroomMargin;
+  size_t headroomWindow;
+
+  // How the controller chooses the revocable executor to kill on memory
+  // pressure: the largest one, or the one whose usage grew the most over the
+  // last `memoryGrowthWindow` corrections, weighted by its size
+  enum MemoryVictim { LARGEST, GROWTH };
+  MemoryVictim memoryVictim;
+  size_t memoryGrowthWindow;
+
+  // How the controller chooses among the revocable executors to kill: by
+  // their usage of the resource at hand, or by the work lost, i.e. the time
+  // since they started weighted by the priority in their `priorityLabel`
+  // label, among those freeing enough of that resource. For CPU, I/O and
+  // network that is at least `lostWorkMinShare` of what the heaviest
+  // executor would free.
+  enum VictimSelection { USAGE, LOST_WORK };
+  VictimSelection victimSelection;
+  std::string priorityLabel;
+  double lostWorkMinShare;
+
+  // Whether revocable and non-revocable containers are told apart in their
+  // cgroup v2 memory settings, see `MemoryProtection`
+  bool memoryProtection;
+  std::string cgroupRoot; // holding a cgroup per container
+  Option<std::string> revocableCgroup; // common parent of all revocable containers
+  Bytes memoryHighMin; // below which `memory.high` is never set
+  int oomScoreAdj; // of revocable tasks
+
+  // Policy evaluated on the same samples as this one without acting on it,
+  // given by the parameters prefixed with `shadow_`. Null if there is none.
+  std::shared_ptr<Configuration const> shadow;
+
+  // Optional JSON file whose parameters take precedence over the module
+  // parameters. It is watched and reloaded at runtime.
+  Option<std::string> configFile;
+
+  // Directory in which the decision state is checkpointed across restarts of
+  // the agent, and the maximum age of a checkpoint to be restored.
+  Option<std::string> stateDir;
+  Duration stateMaxAge;
+
+  // Whether the decision trace is dumped into the state directory on SIGUSR2
+  bool traceDump;
+
+  // Whether the host state of every decision is published in POSIX shared
+  // memory, see `HostStateReader`, and the permissions of the segment
+  bool shmExport;
+  mode_t shmMode;
+
+  // The module parameters this configuration has been created from.
+  mesos::Parameters parameters;
+
+  // Optional signals are only sampled if any of their thresholds is set.
+  bool samplesVmStat() const;
+  bool samplesDiskStats() const;
+  bool samplesNetDev() const;
+  bool samplesSchedStat() const;
+  bool samplesCpuFreq() const;
+
+  // Whether offers are ramped up gradually rather than restored at once
+  bool rampsOffers() const;
+};
+
+std::ostream& operator<<(std::ostream& stream, Configuration const& config);
+
+/*
+ * Parses and validates the given module parameters. If they reference a
+ * `config_file`, the parameters read from that file override them.
+ */
+Try<Configuration> parseConfiguration(mesos::Parameters const& parameters);
+
+/*
+ * Converts a JSON object mapping parameter names to string values into
+ * module parameters.
+ */
+Try<mesos::Parameters> parametersFromJSON(JSON::Object const& object);
+
+/*
+ * Reads module parameters from a JSON file holding a single object that maps
+ * parameter names to string values.
+ */
+Try<mesos::Parameters> readConfigFile(std::string const& path);
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,207 @@
+#include "config_watcher.hpp"
+
+#include <algorithm>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <stout/error.hpp>
+#include <stout/path.hpp>
+#include <stout/try.hpp>
+
+#include <glog/logging.h>
+
+#include <process/defer.hpp>
+#include <process/delay.hpp>
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/io.hpp>
+#include <process/process.hpp>
+
+using process::Future;
+using process::Process;
+
+using com::blue_yonder::ConfigWatcher;
+using com::blue_yonder::ConfigWatcherProcess;
+
+
+Duration const ConfigWatcher::DEFAULT_BACKOFF = Seconds(1);
+Duration const ConfigWatcher::MAX_BACKOFF = Minutes(1);
+
+
+class ConfigWatcherProcess : public Process<ConfigWatcherProcess>
+{
+public:
+  ConfigWatcherProcess(
+    std::string const& path,
+    std::function<void()> const& changed,
+    std::function<void()> const& failed,
+    Duration const& backoff);
+
+protected:
+  virtual void initialize() override;
+  virtual void finalize() override;
+
+private:
+  // Returns an inotify descriptor watching the directory of `path`
+  Try<int> open() const;
+  void watch();
+  void _watch(Future<short> const& ready);
+  void retry();
+  void reopen();
+
+  std::string const path;
+  std::function<void()> const changed;
+  std::function<void()> const failed;
+  Duration const initialBackoff;
+  Duration backoff;
+  int fd;
+  Future<short> polling;
+};
+
+
+ConfigWatcherProcess::ConfigWatcherProcess(
+  std::string const& path,
+  std::function<void()> const& changed,
+  std::function<void()> const& failed,
+  Duration const& backoff)
+  : ProcessBase(process::ID::generate("threshold-config-watcher")),
+    path{path},
+    changed{changed},
+    failed{failed},
+    initialBackoff{backoff},
+    backoff{backoff},
+    fd{-1}
+{
+  // The watch is established right away rather than in `initialize()` so
+  // that no change is missed once the constructor has returned. Events are
+  // queued by the kernel until we start polling.
+  auto const opened = open();
+  if (opened.isError()) {
+    LOG(ERROR) << opened.error() << ". Changes to " << path << " will be ignored until it can be watched";
+    return;
+  }
+  fd = opened.get();
+
+  LOG(INFO) << "Watching " << path << " for configuration changes";
+}
+
+Try<int> ConfigWatcherProcess::open() const {
+  int const fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    return ErrnoError("Failed to initialize inotify");
+  }
+
+  auto const directory = Path(path).dirname();
+  if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    auto const error = ErrnoError("Failed to watch " + directory);
+    ::close(fd);
+    return error;
+  }
+  return fd;
+}
+
+void ConfigWatcherProcess::initialize() {
+  if (fd >= 0) {
+    watch();
+  } else {
+    retry();
+  }
+}
+
+void ConfigWatcherProcess::finalize() {
+  polling.discard();
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+void ConfigWatcherProcess::watch() {
+  polling = process::io::poll(fd, process::io::READ);
+  polling.onAny(process::defer(self(), &Self::_watch, std::placeholders::_1));
+}
+
+void ConfigWatcherProcess::_watch(Future<short> const& ready) {
+  if (ready.isDiscarded()) {
+    return;
+  }
+  if (ready.isFailed()) {
+    LOG(ERROR) << "Failed to wait for changes to " << path << ": " << ready.failure();
+    ::close(fd);
+    fd = -1;
+    retry();
+    return;
+  }
+
+  auto const filename = Path(path).basename();
+  bool modified = false;
+  bool removed = false; // along with the directory
+
+  alignas(inotify_event) char buffer[4096];
+  ssize_t length;
+  while ((length = ::read(fd, buffer, sizeof(buffer))) > 0) {
+    for (char const* current = buffer; current < buffer + length;) {
+      auto const* event = reinterpret_cast<inotify_event const*>(current);
+      if (event->len > 0 && filename == event->name) {
+        modified = true;
+      }
+      if (event->mask & IN_IGNORED) {
+        removed = true;
+      }
+      current += sizeof(inotify_event) + event->len;
+    }
+  }
+
+  if (modified) {
+    changed();
+  }
+  if (removed) {
+    LOG(ERROR) << "Lost the watch on " << Path(path).dirname();
+    ::close(fd);
+    fd = -1;
+    retry();
+    return;
+  }
+  watch();
+}
+
+void ConfigWatcherProcess::retry() {
+  failed();
+  LOG(INFO) << "Trying to watch " << path << " again in " << backoff;
+  process::delay(backoff, self(), &Self::reopen);
+  backoff = std::min(backoff * 2, ConfigWatcher::MAX_BACKOFF);
+}
+
+void ConfigWatcherProcess::reopen() {
+  auto const opened = open();
+  if (opened.isError()) {
+    LOG(ERROR) << opened.error();
+    retry();
+    return;
+  }
+  fd = opened.get();
+  backoff = initialBackoff;
+
+  LOG(INFO) << "Watching " << path << " for configuration changes again";
+
+  // The file may have changed while it was not watched.
+  changed();
+  watch();
+}
+
+
+ConfigWatcher::ConfigWatcher(
+  std::string const& path,
+  std::function<void()> const& changed,
+  std::function<void()> const& failed,
+  Duration const& backoff)
+  : process(new ConfigWatcherProcess(path, changed, failed, backoff))
+{
+  spawn(process.get());
+}
+
+ConfigWatcher::~ConfigWatcher() {
+  terminate(process.get());
+  wait(process.get());
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <stout/duration.hpp>
+
+#include <process/owned.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+class ConfigWatcherProcess;
+
+/*
+ * Watches a file via inotify and invokes a callback whenever it has been
+ * rewritten or replaced. Watching stops when the watcher is destroyed.
+ *
+ * The containing directory is watched rather than the file itself. This way
+ * we also notice files that are atomically replaced by renaming a new version
+ * over them, as done by most editors and configuration management tools.
+ *
+ * Waiting for events is done via `process::io::poll`, so the watcher does not
+ * block any libprocess worker thread. The callbacks are invoked from within the
+ * watcher's own actor and should just dispatch to the interested actor.
+ *
+ * If the watch cannot be established or is lost, e.g. because the directory
+ * does not exist (yet) or has been removed, `failed` is invoked and the watch
+ * is established anew after `backoff`, doubling up to `MAX_BACKOFF`. As the
+ * file may have changed in the meantime, `changed` is invoked once the watch
+ * has been re-established.
+ */
+class ConfigWatcher
+{
+public:
+  static Duration const DEFAULT_BACKOFF;
+  static Duration const MAX_BACKOFF;
+
+  ConfigWatcher(
+    std::string const& path,
+    std::function<void()> const& changed,
+    std::function<void()> const& failed = []() {},
+    Duration const& backoff = DEFAULT_BACKOFF);
+  ~ConfigWatcher();
+
+private:
+  process::Owned<ConfigWatcherProcess> process;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,295 @@
+#include "decision_trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include <unistd.h>
+
+#include <stout/error.hpp>
+#include <stout/nothing.hpp>
+#include <stout/os/mkdir.hpp>
+#include <stout/os/write.hpp>
+#include <stout/path.hpp>
+
+#include <glog/logging.h>
+
+#include <process/clock.hpp>
+
+#include "io_thread.hpp"
+#include "os.hpp"
+
+using com::blue_yonder::DecisionRecord;
+using com::blue_yonder::DecisionTrace;
+
+
+constexpr uint32_t DecisionTrace::VERSION;
+constexpr size_t DecisionTrace::DEFAULT_CAPACITY;
+
+namespace {
+
+// Incremented by the signal handler. Each trace compares it with the number
+// of requests it has already served.
+std::atomic<uint64_t> pendingDumpRequests{0};
+
+// The handler that was installed before ours, e.g. by the agent or another
+// module. It is invoked after every dump request.
+struct sigaction previousAction;
+
+void requestDump(int signal, siginfo_t* info, void* context) {
+  ++pendingDumpRequests;
+
+  if (previousAction.sa_flags & SA_SIGINFO) {
+    if (previousAction.sa_sigaction != nullptr) {
+      previousAction.sa_sigaction(signal, info, context);
+    }
+  } else if (previousAction.sa_handler != SIG_DFL && previousAction.sa_handler != SIG_IGN) {
+    previousAction.sa_handler(signal);
+  }
+}
+
+void installDumpSignalHandler() {
+  static std::once_flag installed;
+  std::call_once(installed, []() {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = requestDump;
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGUSR2, &action, &previousAction) != 0) {
+      PLOG(WARNING) << "Failed to install SIGUSR2 handler for decision trace dumps";
+    }
+  });
+}
+
+// Writes the file via a uniquely named temporary one with mode 0600 that is
+// renamed over `path`. Neither follows a symlink planted at either name.
+Try<Nothing> writePrivately(std::string const& path, std::string const& data) {
+  auto const directory = ::os::mkdir(Path(path).dirname());
+  if (directory.isError()) {
+    return Error(directory.error());
+  }
+
+  std::string temporary = path + ".XXXXXX";
+  int const fd = ::mkstemp(&temporary[0]);
+  if (fd < 0) {
+    return ErrnoError("Failed to create " + temporary);
+  }
+
+  auto const written = ::os::write(fd, data);
+  ::close(fd);
+  if (written.isError()) {
+    ::unlink(temporary.c_str());
+    return Error(written.error());
+  }
+
+  if (::rename(temporary.c_str(), path.c_str()) != 0) {
+    auto const error = ErrnoError("Failed to rename " + temporary);
+    ::unlink(temporary.c_str());
+    return error;
+  }
+  return Nothing();
+}
+
+void copyTruncated(char* destination, size_t size, std::string const& source) {
+  auto const length = std::min(size - 1, source.size());
+  memcpy(destination, source.data(), length);
+  memset(destination + length, 0, size - length);
+}
+
+} // namespace {
+
+
+DecisionRecord DecisionRecord::make(
+    Kind kind,
+    Try<::os::Load> const& load,
+    Try<os::MemInfo> const& memory,
+    ::os::Load const& loadThreshold,
+    Bytes const& memThreshold,
+    size_t executors)
+{
+  DecisionRecord record;
+  memset(&record, 0, sizeof(record));
+
+  record.timestamp = process::Clock::now().secs();
+  record.kind = kind;
+  record.action = NONE;
+  record.executors = static_cast<uint32_t>(executors);
+
+  if (load.isSome()) {
+    record.load[0] = load.get().one;
+    record.load[1] = load.get().five;
+    record.load[2] = load.get().fifteen;
+  } else {
+    record.flags |= LOAD_ERROR;
+  }
+  record.loadThreshold[0] = loadThreshold.one;
+  record.loadThreshold[1] = loadThreshold.five;
+  record.loadThreshold[2] = loadThreshold.fifteen;
+
+  if (memory.isSome()) {
+    record.memTotalBytes = memory.get().total.bytes();
+    record.memAvailableBytes = memory.get().memAvailable.bytes();
+  } else {
+    record.flags |= MEM_ERROR;
+  }
+  record.memThresholdBytes = memThreshold.bytes();
+
+  return record;
+}
+
+void DecisionRecord::setVictim(mesos::ExecutorInfo const& executor) {
+  copyTruncated(frameworkId, sizeof(frameworkId), executor.framework_id().value());
+  copyTruncated(executorId, sizeof(executorId), executor.executor_id().value());
+}
+
+void DecisionRecord::setResources(mesos::Resources const& resources) {
+  cpus = resources.cpus().getOrElse(0);
+  memBytes = resources.mem().getOrElse(Bytes(0)).bytes();
+}
+
+void DecisionRecord::setReclaim(
+    Try<Option<threshold::ReclaimRates>> const& rates,
+    threshold::ReclaimRates const& threshold)
+{
+  if (rates.isError()) {
+    flags |= RECLAIM_ERROR;
+  } else if (rates.get().isSome()) {
+    reclaimRates[0] = rates.get().get().pgscanDirect;
+    reclaimRates[1] = rates.get().get().pgsteal;
+    reclaimRates[2] = rates.get().get().allocstall;
+    reclaimRates[3] = rates.get().get().swap;
+  }
+  reclaimThreshold[0] = threshold.pgscanDirect;
+  reclaimThreshold[1] = threshold.pgsteal;
+  reclaimThreshold[2] = threshold.allocstall;
+  reclaimThreshold[3] = threshold.swap;
+}
+
+void DecisionRecord::setThrottling(Option<double> const& throttling, double threshold) {
+  this->throttling = throttling.getOrElse(-1);
+  throttlingThreshold = threshold;
+}
+
+void DecisionRecord::setDisk(
+    Try<Option<threshold::DiskLoad>> const& load,
+    double utilizationThreshold,
+    double queueDepthThreshold)
+{
+  if (load.isError()) {
+    flags |= IO_ERROR;
+  } else if (load.get().isSome()) {
+    ioUtilization = load.get().get().utilization;
+    ioQueueDepth = load.get().get().queueDepth;
+  }
+  ioUtilThreshold = utilizationThreshold;
+  ioQueueDepthThreshold = queueDepthThreshold;
+}
+
+void DecisionRecord::setNetwork(
+    Try<Option<threshold::NetworkLoad>> const& load,
+    double rxThreshold,
+    double txThreshold)
+{
+  if (load.isError()) {
+    flags |= NET_ERROR;
+  } else if (load.get().isSome()) {
+    netRx = load.get().get().rx;
+    netTx = load.get().get().tx;
+  }
+  netRxThreshold = rxThreshold;
+  netTxThreshold = txThreshold;
+}
+
+void DecisionRecord::setRunQueue(Try<Option<double>> const& delay, double threshold) {
+  if (delay.isError()) {
+    flags |= RUNQUEUE_ERROR;
+  } else if (delay.get().isSome()) {
+    runQueueDelay = delay.get().get();
+  }
+  runQueueDelayThreshold = threshold;
+}
+
+void DecisionRecord::setFrequency(
+    Try<Option<threshold::CpuFrequency>> const& frequency,
+    double threshold)
+{
+  if (frequency.isError()) {
+    flags |= FREQUENCY_ERROR;
+  } else if (frequency.get().isSome()) {
+    cpuFrequency = frequency.get().get().percent.getOrElse(-1);
+    thermalThrottleEvents = frequency.get().get().throttleEvents;
+  }
+  cpuFrequencyThreshold = threshold;
+}
+
+
+DecisionTrace::DecisionTrace(
+    Option<std::string> const& dumpPath,
+    IOThread& io,
+    size_t capacity)
+  : dumpPath{dumpPath},
+    io(io),
+    records(std::max<size_t>(capacity, 1)),
+    next{0},
+    count{0},
+    servedDumpRequests{pendingDumpRequests.load()}
+{
+  if (dumpPath.isSome()) {
+    installDumpSignalHandler();
+  }
+}
+
+void DecisionTrace::record(DecisionRecord const& record) {
+  records[next] = record;
+  next = (next + 1) % records.size();
+  count = std::min(count + 1, records.size());
+
+  uint64_t const requested = pendingDumpRequests.load();
+  if (dumpPath.isSome() && requested != servedDumpRequests) {
+    servedDumpRequests = requested;
+    dump();
+  }
+}
+
+size_t DecisionTrace::size() const {
+  return count;
+}
+
+std::string DecisionTrace::serialize() const {
+  Header header;
+  memcpy(header.magic, "THRTRACE", sizeof(header.magic));
+  header.version = VERSION;
+  header.recordSize = sizeof(DecisionRecord);
+  header.records = count;
+
+  std::string result;
+  result.reserve(sizeof(header) + count * sizeof(DecisionRecord));
+  result.append(reinterpret_cast<char const*>(&header), sizeof(header));
+
+  auto const first = (next + records.size() - count) % records.size();
+  for (size_t i = 0; i < count; ++i) {
+    auto const& record = records[(first + i) % records.size()];
+    result.append(reinterpret_cast<char const*>(&record), sizeof(record));
+  }
+  return result;
+}
+
+void DecisionTrace::dump() {
+  // Writing the file is blocking I/O and therefore done on the I/O thread.
+  std::string const path = dumpPath.get();
+  std::string const data = serialize();
+  io.run<Try<Nothing>>([path, data]() { return writePrivately(path, data); })
+    .onAny([path](process::Future<Try<Nothing>> const& result) {
+      if (result.isReady() and result.get().isSome()) {
+        LOG(INFO) << "Dumped decision trace to " << path;
+      } else {
+        LOG(ERROR) << "Failed to dump decision trace to " << path << ": "
+                   << (result.isReady() ? result.get().error() : result.failure());
+      }
+    });
+}
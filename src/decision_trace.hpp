@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <stout/bytes.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include <mesos/resources.hpp>
+
+#include "threshold.hpp"
+
+namespace com {
+namespace blue_yonder {
+
+namespace os {
+struct MemInfo;
+}
+
+class IOThread;
+
+/*
+ * A compact, fixed-size record of a single decision taken by the estimator
+ * or the controller. It captures all inputs and the outcome so that a
+ * decision can be reconstructed after the fact.
+ *
+ * The layout is dumped verbatim. Any change to it must bump
+ * `DecisionTrace::VERSION`.
+ */
+struct DecisionRecord
+{
+  enum Kind : uint8_t {
+    ESTIMATION = 0,
+    CORRECTION = 1,
+  };
+
+  enum Action : uint8_t {
+    NONE = 0,
+    OFFER = 1,
+    KILL_MEMORY = 2,
+    KILL_LOAD = 3,
+    KILL_THROTTLING = 4,
+    KILL_IO = 5,
+    KILL_NETWORK = 6,
+    KILL_RUNQUEUE = 7,
+    KILL_FREQUENCY = 8,
+  };
+
+  enum Flag : uint16_t {
+    LOAD_ERROR = 1 << 0,
+    MEM_ERROR = 1 << 1,
+    LOAD_EXCEEDED = 1 << 2,
+    MEM_EXCEEDED = 1 << 3,
+    RECLAIM_ERROR = 1 << 4,
+    RECLAIM_EXCEEDED = 1 << 5,
+    THROTTLING_EXCEEDED = 1 << 6,
+    IO_ERROR = 1 << 7,
+    IO_EXCEEDED = 1 << 8,
+    NET_ERROR = 1 << 9,
+    NET_EXCEEDED = 1 << 10,
+    RUNQUEUE_ERROR = 1 << 11,
+    RUNQUEUE_EXCEEDED = 1 << 12,
+    FREQUENCY_ERROR = 1 << 13,
+    FREQUENCY_EXCEEDED = 1 << 14,
+    SAMPLE_INCOMPLETE = 1 << 15, // the host could not be sampled in time
+  };
+
+  double timestamp;
+  double load[3];
+  double loadThreshold[3];
+  uint64_t memTotalBytes;
+  uint64_t memAvailableBytes;
+  uint64_t memThresholdBytes;
+  double cpus; // offered or freed by a kill
+  uint64_t memBytes; // offered or freed by a kill
+  uint32_t executors;
+  uint8_t kind;
+  uint8_t action;
+  uint16_t flags;
+  // pgscan_direct, pgsteal, allocstall, swap per second
+  double reclaimRates[4];
+  double reclaimThreshold[4];
+  double throttling; // of non-revocable executors, negative if unknown
+  double throttlingThreshold;
+  double ioUtilization; // of the busiest selected device
+  double ioQueueDepth;
+  double ioUtilThreshold;
+  double ioQueueDepthThreshold;
+  double netRx; // fraction of the link speed of the busiest selected interface
+  double netTx;
+  double netRxThreshold;
+  double netTxThreshold;
+  double runQueueDelay; // milliseconds per timeslice
+  double runQueueDelayThreshold;
+  double cpuFrequency; // percent of the nominal frequency, -1 if unknown
+  double cpuFrequencyThreshold;
+  uint64_t thermalThrottleEvents; // since the previous decision
+  double offerFraction; // of the revocable resources, estimations only
+  char frameworkId[64]; // of the victim, truncated
+  char executorId[88]; // of the victim, truncated
+
+  static DecisionRecord make(
+    Kind kind,
+    Try<::os::Load> const& load,
+    Try<os::MemInfo> const& memory,
+    ::os::Load const& loadThreshold,
+    Bytes const& memThreshold,
+    size_t executors);
+
+  void setVictim(mesos::ExecutorInfo const& executor);
+  void setResources(mesos::Resources const& resources);
+  void setReclaim(
+    Try<Option<threshold::ReclaimRates>> const& rates,
+    threshold::ReclaimRates const& threshold);
+  void setThrottling(Option<double> const& throttling, double threshold);
+  void setDisk(
+    Try<Option<threshold::DiskLoad>> const& load,
+    double utilizationThreshold,
+    double queueDepthThreshold);
+  void setNetwork(
+    Try<Option<threshold::NetworkLoad>> const& load,
+    double rxThreshold,
+    double txThreshold);
+  void setRunQueue(Try<Option<double>> const& delay, double threshold);
+  void setFrequency(Try<Option<threshold::CpuFrequency>> const& frequency, double threshold);
+};
+
+static_assert(sizeof(DecisionRecord) == 448, "DecisionRecord layout changed");
+static_assert(std::is_pod<DecisionRecord>::value, "DecisionRecord must be POD");
+
+
+/*
+ * Ring buffer holding the most recent decisions.
+ *
+ * Recording a decision is a plain copy into preallocated memory. The trace is
+ * owned by an actor and must only be accessed from within it.
+ *
+ * The trace can be retrieved via the `/trace` endpoint of the owning actor.
+ * In addition, if a trace has a `dumpPath`, sending SIGUSR2 to the agent makes
+ * it dump itself to that path on the next decision. The file is only readable
+ * by the agent's user. A SIGUSR2 handler installed before the first such trace
+ * is still invoked.
+ */
+class DecisionTrace
+{
+public:
+  static constexpr uint32_t VERSION = 8;
+  static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+  struct Header
+  {
+    char magic[8]; // "THRTRACE"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t records;
+  };
+
+  DecisionTrace(
+    Option<std::string> const& dumpPath,
+    IOThread& io,
+    size_t capacity = DEFAULT_CAPACITY);
+
+  void record(DecisionRecord const& record);
+
+  size_t size() const;
+
+  /*
+   * Returns the header followed by all records, oldest first.
+   */
+  std::string serialize() const;
+
+private:
+  void dump();
+
+  Option<std::string> const dumpPath;
+  IOThread& io;
+  std::vector<DecisionRecord> records;
+  size_t next;
+  size_t count;
+  uint64_t servedDumpRequests;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,383 @@
+#include "executor_history.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include "checkpoint.hpp"
+
+using mesos::CgroupInfo;
+using mesos::ResourceUsage;
+
+using com::blue_yonder::ExecutorHistory;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+
+
+constexpr size_t ExecutorHistory::DEFAULT_WINDOW;
+constexpr uint64_t ExecutorHistory::DEFAULT_MEMORY_LIMIT;
+
+namespace {
+
+double const MISSING = std::numeric_limits<double>::quiet_NaN();
+
+uint64_t totalBytes(CgroupInfo::Blkio::Throttling::Statistics const& statistics) {
+  uint64_t bytes = 0;
+  for (auto const& value : statistics.io_service_bytes()) {
+    if (value.op() == CgroupInfo::Blkio::TOTAL) {
+      bytes += value.value();
+    }
+  }
+  return bytes;
+}
+
+// The agent reports the bytes per device and, without a device, in total.
+// Depending on the kernel either may be missing.
+double diskBytes(mesos::ResourceStatistics const& statistics) {
+  uint64_t perDevice = 0;
+  uint64_t total = 0;
+  for (auto const& throttling : statistics.blkio_statistics().throttling()) {
+    (throttling.has_device() ? perDevice : total) += totalBytes(throttling);
+  }
+  return static_cast<double>(std::max(perDevice, total));
+}
+
+// Only reported with the network/port_mapping isolator
+double netBytes(mesos::ResourceStatistics const& statistics) {
+  if (!statistics.has_net_rx_bytes() && !statistics.has_net_tx_bytes()) {
+    return MISSING;
+  }
+  return static_cast<double>(statistics.net_rx_bytes() + statistics.net_tx_bytes());
+}
+
+} // namespace {
+
+
+ExecutorHistory::ExecutorHistory(size_t window, Bytes const& memoryLimit)
+  : length{std::max<size_t>(window, 2)},
+    maxExecutors{memoryLimit.bytes() / bytesPerExecutor(length).bytes()},
+    generation{0},
+    warned{false}
+{
+  scratch.reserve(length);
+}
+
+Bytes ExecutorHistory::bytesPerExecutor(size_t window) {
+  return Bytes(
+    (SERIES_COUNT + 1) * window * sizeof(double) +
+    sizeof(uint64_t) + 2 * sizeof(uint32_t));
+}
+
+void ExecutorHistory::update(ResourceUsage const& usage) {
+  ++generation;
+
+  // Evict terminated executors first so that their slots can be reused by
+  // new ones right away.
+  found.clear();
+  for (auto const& executor : usage.executors()) {
+    auto const slot = find(executor.executor_info());
+    if (slot.isSome()) {
+      generations[slot.get()] = generation;
+    }
+    found.push_back(slot);
+  }
+  for (auto it = slots.begin(); it != slots.end();) {
+    if (generations[it->second] != generation) {
+      freeSlots.push_back(it->second);
+      it = slots.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  size_t untracked = 0;
+  for (int i = 0; i < usage.executors_size(); ++i) {
+    auto const& executor = usage.executors(i);
+    Option<size_t> slot = found[i];
+    if (slot.isNone()) {
+      slot = allocate();
+      if (slot.isNone()) {
+        ++untracked;
+        continue;
+      }
+      slots.emplace(key(executor.executor_info()), slot.get());
+      counts[slot.get()] = 0;
+      newest[slot.get()] = static_cast<uint32_t>(length - 1);
+    }
+
+    size_t const index = slot.get();
+    newest[index] = static_cast<uint32_t>((newest[index] + 1) % length);
+    counts[index] = static_cast<uint32_t>(std::min<size_t>(counts[index] + 1, length));
+    generations[index] = generation;
+
+    auto const& statistics = executor.statistics();
+    size_t const at = index * length + newest[index];
+    timestamps[at] = statistics.timestamp();
+    values[CPU_TIME][at] = statistics.cpus_user_time_secs() + statistics.cpus_system_time_secs();
+    values[CPU_PERIODS][at] = static_cast<double>(statistics.cpus_nr_periods());
+    values[CPU_THROTTLED][at] = static_cast<double>(statistics.cpus_nr_throttled());
+    values[MEM_BYTES][at] = static_cast<double>(statistics.mem_total_bytes());
+    values[DISK_BYTES][at] = diskBytes(statistics);
+    values[NET_BYTES][at] = netBytes(statistics);
+  }
+
+  if (untracked > 0 && !warned) {
+    LOG(WARNING) << "Not tracking the history of " << untracked << " executors as the limit of "
+                 << maxExecutors << " executors has been reached";
+    warned = true;
+  }
+}
+
+void ExecutorHistory::save(StateWriter& writer, size_t samples) const {
+  writer.write(static_cast<uint64_t>(length));
+  writer.write(static_cast<uint64_t>(slots.size()));
+  for (auto const& slot : slots) {
+    uint32_t const count = static_cast<uint32_t>(std::min<size_t>(counts[slot.second], samples));
+    writer.write(slot.first.first);
+    writer.write(slot.first.second);
+    writer.write(count);
+
+    // Oldest first, the timestamp followed by the value of each series
+    for (size_t age = count; age-- > 0;) {
+      size_t const at = position(slot.second, age);
+      writer.write(timestamps[at]);
+      for (auto const& series : values) {
+        writer.write(series[at]);
+      }
+    }
+  }
+}
+
+bool ExecutorHistory::restore(StateReader& reader) {
+  uint64_t window;
+  uint64_t executors;
+  if (!reader.read(window) || window != length || !reader.read(executors)) {
+    return false;
+  }
+
+  // The whole history is read before any of it is replaced.
+  std::vector<std::pair<ExecutorKey, uint32_t>> restored;
+  std::vector<double> restoredSamples;
+  for (uint64_t i = 0; i < executors; ++i) {
+    ExecutorKey executor;
+    uint32_t count;
+    if (!reader.read(executor.first) || !reader.read(executor.second) ||
+        !reader.read(count) || count > length) {
+      return false;
+    }
+    for (size_t j = 0; j < count * (SERIES_COUNT + 1); ++j) {
+      double value;
+      if (!reader.read(value)) {
+        return false;
+      }
+      restoredSamples.push_back(value);
+    }
+    restored.emplace_back(executor, count);
+  }
+
+  slots.clear();
+  freeSlots.clear();
+  generations.clear();
+  newest.clear();
+  counts.clear();
+  timestamps.clear();
+  for (auto& series : values) {
+    series.clear();
+  }
+
+  size_t next = 0;
+  for (auto const& executor : restored) {
+    auto const slot = allocate();
+    if (slot.isNone()) {
+      break;
+    }
+    slots.emplace(executor.first, slot.get());
+    generations[slot.get()] = generation;
+    counts[slot.get()] = executor.second;
+    newest[slot.get()] = static_cast<uint32_t>((executor.second + length - 1) % length);
+    for (size_t j = 0; j < executor.second; ++j) {
+      size_t const at = slot.get() * length + j;
+      timestamps[at] = restoredSamples[next++];
+      for (auto& series : values) {
+        series[at] = restoredSamples[next++];
+      }
+    }
+  }
+  return true;
+}
+
+Option<size_t> ExecutorHistory::allocate() {
+  if (!freeSlots.empty()) {
+    size_t const slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+  }
+
+  size_t const slot = generations.size();
+  if (slot >= maxExecutors) {
+    return None();
+  }
+
+  // Grow geometrically, but never beyond the memory limit
+  size_t const samples = (slot + 1) * length;
+  if (samples > timestamps.capacity()) {
+    size_t const reserved = std::min(2 * timestamps.capacity() + length, maxExecutors * length);
+    timestamps.reserve(reserved);
+    for (auto& series : values) {
+      series.reserve(reserved);
+    }
+  }
+  timestamps.resize(samples, MISSING);
+  for (auto& series : values) {
+    series.resize(samples, MISSING);
+  }
+  generations.push_back(0);
+  newest.push_back(0);
+  counts.push_back(0);
+  return slot;
+}
+
+Option<double> ExecutorHistory::latest(
+    mesos::ExecutorInfo const& executor,
+    Series series) const
+{
+  auto const slot = find(executor);
+  if (slot.isNone() || counts[slot.get()] == 0) {
+    return None();
+  }
+  double const value = values[series][position(slot.get(), 0)];
+  if (std::isnan(value)) {
+    return None();
+  }
+  return value;
+}
+
+Option<double> ExecutorHistory::delta(
+    mesos::ExecutorInfo const& executor,
+    Series series,
+    size_t samples) const
+{
+  auto const slot = find(executor);
+  if (slot.isNone() || counts[slot.get()] < 2 || samples == 0) {
+    return None();
+  }
+
+  size_t const age = std::min<size_t>(samples, counts[slot.get()] - 1);
+  double const current = values[series][position(slot.get(), 0)];
+  double const previous = values[series][position(slot.get(), age)];
+
+  // Counters are reset if the agent recreates a cgroup
+  if (std::isnan(current) || std::isnan(previous) || current < previous) {
+    return None();
+  }
+  return current - previous;
+}
+
+Option<double> ExecutorHistory::rate(
+    mesos::ExecutorInfo const& executor,
+    Series series,
+    size_t samples) const
+{
+  auto const increase = delta(executor, series, samples);
+  if (increase.isNone()) {
+    return None();
+  }
+
+  size_t const slot = find(executor).get();
+  size_t const age = std::min<size_t>(samples, counts[slot] - 1);
+  double const seconds = timestamps[position(slot, 0)] - timestamps[position(slot, age)];
+  if (seconds <= 0) {
+    return None();
+  }
+  return increase.get() / seconds;
+}
+
+Option<double> ExecutorHistory::slope(
+    mesos::ExecutorInfo const& executor,
+    Series series,
+    size_t samples) const
+{
+  auto const slot = find(executor);
+  if (slot.isNone()) {
+    return None();
+  }
+
+  // Timestamps relative to the newest sample keep the sums small
+  size_t const count = std::min<size_t>(samples + 1, counts[slot.get()]);
+  double const origin = timestamps[position(slot.get(), 0)];
+  double n = 0, sumT = 0, sumV = 0, sumTT = 0, sumTV = 0;
+  for (size_t age = 0; age < count; ++age) {
+    size_t const at = position(slot.get(), age);
+    double const value = values[series][at];
+    if (std::isnan(value)) {
+      continue;
+    }
+    double const t = timestamps[at] - origin;
+    n += 1;
+    sumT += t;
+    sumV += value;
+    sumTT += t * t;
+    sumTV += t * value;
+  }
+
+  double const spread = n * sumTT - sumT * sumT;
+  if (n < 3 || spread <= 0) {
+    return None();
+  }
+  return (n * sumTV - sumT * sumV) / spread;
+}
+
+Option<double> ExecutorHistory::percentile(
+    mesos::ExecutorInfo const& executor,
+    Series series,
+    double percentile) const
+{
+  auto const slot = find(executor);
+  if (slot.isNone()) {
+    return None();
+  }
+
+  scratch.clear();
+  for (size_t age = 0; age < counts[slot.get()]; ++age) {
+    double const value = values[series][position(slot.get(), age)];
+    if (!std::isnan(value)) {
+      scratch.push_back(value);
+    }
+  }
+  if (scratch.empty()) {
+    return None();
+  }
+
+  double const clamped = std::min(std::max(percentile, 0.0), 1.0);
+  size_t const rank = static_cast<size_t>(std::ceil(clamped * scratch.size()));
+  auto const nth = scratch.begin() + (rank > 0 ? rank - 1 : 0);
+  std::nth_element(scratch.begin(), nth, scratch.end());
+  return *nth;
+}
+
+size_t ExecutorHistory::samples(mesos::ExecutorInfo const& executor) const {
+  auto const slot = find(executor);
+  return slot.isSome() ? counts[slot.get()] : 0;
+}
+
+Option<size_t> ExecutorHistory::find(mesos::ExecutorInfo const& executor) const {
+  // Assigning to the probe reuses its capacity rather than allocating a key
+  // for every lookup.
+  probe.first = executor.framework_id().value();
+  probe.second = executor.executor_id().value();
+  auto const slot = slots.find(probe);
+  if (slot == slots.end()) {
+    return None();
+  }
+  return slot->second;
+}
+
+size_t ExecutorHistory::position(size_t slot, size_t age) const {
+  return slot * length + (newest[slot] + length - age) % length;
+}
+
+ExecutorHistory::ExecutorKey ExecutorHistory::key(mesos::ExecutorInfo const& executor) {
+  return std::make_pair(executor.framework_id().value(), executor.executor_id().value());
+}
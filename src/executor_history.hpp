@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stout/bytes.hpp>
+#include <stout/option.hpp>
+
+#include <mesos/mesos.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+class StateReader;
+class StateWriter;
+
+/*
+ * Keeps the most recent statistics the agent reported for each executor in
+ * fixed-length windows.
+ *
+ * Samples are stored as a structure of arrays: one contiguous array per
+ * series, holding the window of each executor back to back. A query thus
+ * only touches the timestamps and the series it asks for. Executors that
+ * are missing from the latest resource usage are evicted and their windows
+ * reused.
+ *
+ * The sample storage never exceeds the given memory limit. Executors that do
+ * not fit are not tracked, and all queries for them return None.
+ */
+class ExecutorHistory
+{
+public:
+  enum Series {
+    CPU_TIME = 0, // user and system seconds
+    CPU_PERIODS, // CFS periods
+    CPU_THROTTLED, // throttled CFS periods
+    MEM_BYTES, // total memory usage
+    DISK_BYTES, // bytes read from and written to block devices
+    NET_BYTES, // bytes received and transmitted, if reported
+    SERIES_COUNT
+  };
+
+  static constexpr size_t DEFAULT_WINDOW = 32;
+  static constexpr uint64_t DEFAULT_MEMORY_LIMIT = 32 * 1024 * 1024;
+
+  ExecutorHistory(
+    size_t window = DEFAULT_WINDOW,
+    Bytes const& memoryLimit = Bytes(DEFAULT_MEMORY_LIMIT));
+
+  /*
+   * Appends a sample for each executor of the given usage and evicts all
+   * executors that are not part of it.
+   */
+  void update(mesos::ResourceUsage const& usage);
+
+  // Returns the most recent value of a series.
+  Option<double> latest(mesos::ExecutorInfo const& executor, Series series) const;
+
+  /*
+   * Returns the increase of a cumulative series over the last `samples`
+   * samples, or over all samples in the window if there are fewer. Returns
+   * None if there are fewer than two samples, or if the counter has been
+   * reset in between.
+   */
+  Option<double> delta(mesos::ExecutorInfo const& executor, Series series, size_t samples) const;
+
+  // Returns the increase per second, like `delta`.
+  Option<double> rate(mesos::ExecutorInfo const& executor, Series series, size_t samples) const;
+
+  /*
+   * Returns the change per second of a series over the last `samples`
+   * samples, like `rate`, but as the slope of a least-squares fit. A single
+   * spike thus hardly matters. Unlike `rate`, it also applies to series that
+   * may decrease. Returns None if there are fewer than three samples.
+   */
+  Option<double> slope(mesos::ExecutorInfo const& executor, Series series, size_t samples) const;
+
+  /*
+   * Returns the given percentile (between 0 and 1) of a series over the whole
+   * window, using the nearest-rank method.
+   */
+  Option<double> percentile(
+    mesos::ExecutorInfo const& executor,
+    Series series,
+    double percentile) const;
+
+  // Returns the number of samples of the executor in the window.
+  size_t samples(mesos::ExecutorInfo const& executor) const;
+
+  size_t window() const { return length; }
+
+  // The number of executors currently tracked, and the maximum.
+  size_t size() const { return slots.size(); }
+  size_t capacity() const { return maxExecutors; }
+
+  // The size of the sample storage of a single executor
+  static Bytes bytesPerExecutor(size_t window);
+
+  /*
+   * Checkpoints the newest `samples` samples of all tracked executors, see
+   * `Checkpoint`. A restore fails if the window length differs, and leaves
+   * the history untouched then. Executors beyond the memory limit are not
+   * restored.
+   */
+  void save(StateWriter& writer, size_t samples) const;
+  bool restore(StateReader& reader);
+
+private:
+  typedef std::pair<std::string, std::string> ExecutorKey;
+
+  static ExecutorKey key(mesos::ExecutorInfo const& executor);
+
+  Option<size_t> find(mesos::ExecutorInfo const& executor) const;
+  Option<size_t> allocate();
+
+  // Position of the sample `age` samples before the newest one
+  size_t position(size_t slot, size_t age) const;
+
+  size_t const length;
+  size_t const maxExecutors;
+
+  std::map<ExecutorKey, size_t> slots;
+  std::vector<size_t> freeSlots;
+
+  // Per slot
+  std::vector<uint64_t> generations;
+  std::vector<uint32_t> newest;
+  std::vector<uint32_t> counts;
+
+  // Per series, `length` samples per slot
+  std::vector<double> timestamps;
+  std::vector<double> values[SERIES_COUNT];
+
+  // Scratch buffers reused across updates and queries
+  std::vector<Option<size_t>> found;
+  mutable std::vector<double> scratch;
+  mutable ExecutorKey probe;
+  uint64_t generation;
+  bool warned;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,143 @@
+#include "executor_statistics.hpp"
+
+#include "checkpoint.hpp"
+#include "revocable.hpp"
+
+using mesos::ResourceUsage;
+
+using com::blue_yonder::ExecutorHistory;
+using com::blue_yonder::ExecutorStatistics;
+using com::blue_yonder::isRevocable;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+
+
+constexpr size_t ExecutorStatistics::CHECKPOINTED_SAMPLES;
+
+ExecutorStatistics::ExecutorStatistics()
+  : generation{0}
+{}
+
+void ExecutorStatistics::update(ResourceUsage const& usage) {
+  samples.update(usage);
+
+  ++generation;
+  for (auto const& executor : usage.executors()) {
+    double const timestamp = executor.statistics().timestamp();
+    auto lifetime = lifetimes.find(key(executor.executor_info()));
+    if (lifetime == lifetimes.end()) {
+      lifetime = lifetimes.emplace(probe, Lifetime{timestamp, timestamp, generation}).first;
+    }
+    lifetime->second.lastSeen = timestamp;
+    lifetime->second.generation = generation;
+  }
+  for (auto lifetime = lifetimes.begin(); lifetime != lifetimes.end();) {
+    if (lifetime->second.generation != generation) {
+      lifetime = lifetimes.erase(lifetime);
+    } else {
+      ++lifetime;
+    }
+  }
+
+  double periods = 0;
+  double throttled = 0;
+  for (auto const& executor : usage.executors()) {
+    if (isRevocable(executor)) {
+      continue;
+    }
+    auto const executorPeriods =
+      samples.delta(executor.executor_info(), ExecutorHistory::CPU_PERIODS, 1);
+    auto const executorThrottled =
+      samples.delta(executor.executor_info(), ExecutorHistory::CPU_THROTTLED, 1);
+    if (executorPeriods.isSome() && executorThrottled.isSome()) {
+      periods += executorPeriods.get();
+      throttled += executorThrottled.get();
+    }
+  }
+
+  throttling = periods > 0 ? Option<double>(throttled / periods) : None();
+}
+
+Option<double> ExecutorStatistics::nonRevocableThrottling() const {
+  return throttling;
+}
+
+Option<double> ExecutorStatistics::cpuUsage(mesos::ExecutorInfo const& executor) const {
+  return samples.rate(executor, ExecutorHistory::CPU_TIME, 1);
+}
+
+Option<double> ExecutorStatistics::diskUsage(mesos::ExecutorInfo const& executor) const {
+  return samples.rate(executor, ExecutorHistory::DISK_BYTES, 1);
+}
+
+Option<double> ExecutorStatistics::networkUsage(mesos::ExecutorInfo const& executor) const {
+  return samples.rate(executor, ExecutorHistory::NET_BYTES, 1);
+}
+
+Option<double> ExecutorStatistics::memoryGrowth(
+    mesos::ExecutorInfo const& executor,
+    size_t snapshots) const
+{
+  return samples.slope(executor, ExecutorHistory::MEM_BYTES, snapshots);
+}
+
+Option<double> ExecutorStatistics::age(mesos::ExecutorInfo const& executor) const {
+  auto const lifetime = lifetimes.find(key(executor));
+  if (lifetime == lifetimes.end()) {
+    return None();
+  }
+  return lifetime->second.lastSeen - lifetime->second.firstSeen;
+}
+
+void ExecutorStatistics::save(StateWriter& writer) const {
+  writer.write(throttling);
+  writer.write(generation);
+  writer.write(static_cast<uint64_t>(lifetimes.size()));
+  for (auto const& lifetime : lifetimes) {
+    writer.write(lifetime.first.first);
+    writer.write(lifetime.first.second);
+    writer.write(lifetime.second);
+  }
+  samples.save(writer, CHECKPOINTED_SAMPLES);
+}
+
+bool ExecutorStatistics::restore(StateReader& reader) {
+  Option<double> restoredThrottling;
+  uint64_t restoredGeneration;
+  uint64_t count;
+  if (!reader.read(restoredThrottling) ||
+      !reader.read(restoredGeneration) ||
+      !reader.read(count)) {
+    return false;
+  }
+
+  std::map<ExecutorKey, Lifetime> restoredLifetimes;
+  for (uint64_t i = 0; i < count; ++i) {
+    ExecutorKey executor;
+    Lifetime lifetime;
+    if (!reader.read(executor.first) ||
+        !reader.read(executor.second) ||
+        !reader.read(lifetime)) {
+      return false;
+    }
+    restoredLifetimes.emplace(executor, lifetime);
+  }
+
+  if (!samples.restore(reader)) {
+    return false;
+  }
+  throttling = restoredThrottling;
+  generation = restoredGeneration;
+  lifetimes.swap(restoredLifetimes);
+  return true;
+}
+
+ExecutorStatistics::ExecutorKey const& ExecutorStatistics::key(
+    mesos::ExecutorInfo const& executor) const
+{
+  // Assigning to the probe reuses its capacity rather than allocating a key
+  // for every lookup.
+  probe.first = executor.framework_id().value();
+  probe.second = executor.executor_id().value();
+  return probe;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <stout/option.hpp>
+
+#include <mesos/mesos.hpp>
+
+#include "executor_history.hpp"
+
+namespace com {
+namespace blue_yonder {
+
+class StateReader;
+class StateWriter;
+
+/*
+ * Tracks the statistics the agent reports for each executor between two
+ * consecutive resource usage snapshots.
+ *
+ * The agent reads them from the executor's cgroups, e.g. `cpu.stat`,
+ * `cpuacct.stat` and the blkio throttling statistics, so we do not have to
+ * locate the cgroups ourselves. The samples are kept in an `ExecutorHistory`
+ * that forgets executors which are no longer reported.
+ */
+class ExecutorStatistics
+{
+public:
+  /*
+   * The number of the newest samples of each executor that are checkpointed.
+   * Enough to continue the rates right away and a memory growth soon after,
+   * while the checkpoint stays small.
+   */
+  static constexpr size_t CHECKPOINTED_SAMPLES = 4;
+
+  ExecutorStatistics();
+
+  void update(mesos::ResourceUsage const& usage);
+
+  /*
+   * Returns the fraction of CFS periods in which non-revocable executors have
+   * been throttled since the previous snapshot, or None if none of them has
+   * run with a CFS quota in between.
+   */
+  Option<double> nonRevocableThrottling() const;
+
+  /*
+   * Returns the CPUs used by the executor since the previous snapshot, or
+   * None if it was not part of the previous snapshot.
+   */
+  Option<double> cpuUsage(mesos::ExecutorInfo const& executor) const;
+
+  /*
+   * Returns the bytes per second read from and written to block devices by
+   * the executor since the previous snapshot, or None if it was not part of
+   * the previous snapshot.
+   */
+  Option<double> diskUsage(mesos::ExecutorInfo const& executor) const;
+
+  /*
+   * Returns the bytes per second received and transmitted by the executor
+   * since the previous snapshot, or None if it was not part of the previous
+   * snapshot or the agent does not report its network statistics.
+   */
+  Option<double> networkUsage(mesos::ExecutorInfo const& executor) const;
+
+  /*
+   * Returns the bytes per second by which the memory usage of the executor
+   * grew over the last `snapshots` snapshots, see `ExecutorHistory::slope`.
+   */
+  Option<double> memoryGrowth(mesos::ExecutorInfo const& executor, size_t snapshots) const;
+
+  /*
+   * Returns the seconds since the executor was first part of a snapshot, by
+   * the timestamps of its statistics, or None if it is not part of the
+   * latest one. Unlike the samples, this is not limited to the window.
+   */
+  Option<double> age(mesos::ExecutorInfo const& executor) const;
+
+  // The samples of all executors over the last `ExecutorHistory::window()` snapshots
+  ExecutorHistory const& history() const { return samples; }
+
+  /*
+   * Checkpoints the first-seen times and the newest `CHECKPOINTED_SAMPLES`
+   * samples of all executors, see `Checkpoint`. A failed restore leaves the
+   * statistics untouched.
+   */
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  struct Lifetime
+  {
+    double firstSeen;
+    double lastSeen;
+    uint64_t generation;
+  };
+
+  typedef std::pair<std::string, std::string> ExecutorKey;
+
+  ExecutorKey const& key(mesos::ExecutorInfo const& executor) const;
+
+  ExecutorHistory samples;
+  Option<double> throttling;
+  std::map<ExecutorKey, Lifetime> lifetimes;
+  uint64_t generation;
+  mutable ExecutorKey probe;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
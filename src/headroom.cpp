@@ -0,0 +1,187 @@
+#include "headroom.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "checkpoint.hpp"
+#include "executor_statistics.hpp"
+#include "revocable.hpp"
+
+using mesos::Resource;
+using mesos::Resources;
+using mesos::ResourceUsage;
+
+namespace com {
+namespace blue_yonder {
+
+PercentileWindow::PercentileWindow(size_t length)
+  : capacity{std::max<size_t>(length, 1)},
+    next{0}
+{
+  values.reserve(capacity);
+  scratch.reserve(capacity);
+}
+
+void PercentileWindow::add(double value) {
+  if (values.size() < capacity) {
+    values.push_back(value);
+  } else {
+    values[next] = value;
+  }
+  next = (next + 1) % capacity;
+}
+
+Option<double> PercentileWindow::percentile(double percentile) const {
+  if (values.empty()) {
+    return None();
+  }
+
+  scratch.assign(values.begin(), values.end());
+  double const clamped = std::min(std::max(percentile, 0.0), 1.0);
+  size_t const rank = static_cast<size_t>(std::ceil(clamped * scratch.size()));
+  auto const nth = scratch.begin() + (rank > 0 ? rank - 1 : 0);
+  std::nth_element(scratch.begin(), nth, scratch.end());
+  return *nth;
+}
+
+void PercentileWindow::save(StateWriter& writer) const {
+  // Oldest first
+  size_t const oldest = values.size() < capacity ? 0 : next;
+  writer.write(static_cast<uint64_t>(values.size()));
+  for (size_t i = 0; i < values.size(); ++i) {
+    writer.write(values[(oldest + i) % values.size()]);
+  }
+}
+
+bool PercentileWindow::restore(StateReader& reader) {
+  uint64_t count;
+  if (!reader.read(count)) {
+    return false;
+  }
+  std::vector<double> restored;
+  for (uint64_t i = 0; i < count; ++i) {
+    double value;
+    if (!reader.read(value)) {
+      return false;
+    }
+    restored.push_back(value);
+  }
+
+  values.clear();
+  next = 0;
+  for (double value : restored) {
+    add(value);
+  }
+  return true;
+}
+
+
+namespace {
+
+// Caps the sum of all scalar resources of the given name at `limit`
+void cap(Resources& resources, std::string const& name, double limit) {
+  Resources capped;
+  double remaining = std::max(limit, 0.0);
+  for (Resource resource : resources) {
+    if (resource.name() == name && resource.type() == mesos::Value::SCALAR) {
+      double const value = std::min(resource.scalar().value(), remaining);
+      remaining -= value;
+      resource.mutable_scalar()->set_value(value);
+    }
+    capped += resource;
+  }
+  resources = capped;
+}
+
+} // namespace {
+
+
+Headroom::Headroom(size_t window)
+  : cpus{window},
+    memBytes{window}
+{}
+
+void Headroom::update(ResourceUsage const& usage, ExecutorStatistics const& executors) {
+  double usedCpus = 0;
+  double usedMemBytes = 0;
+  for (auto const& executor : usage.executors()) {
+    if (isRevocable(executor)) {
+      continue;
+    }
+    // Executors only have a CPU usage from their second snapshot on
+    usedCpus += executors.cpuUsage(executor.executor_info()).getOrElse(0);
+    usedMemBytes += executor.statistics().mem_total_bytes();
+  }
+  cpus.add(usedCpus);
+  memBytes.add(usedMemBytes);
+}
+
+void Headroom::resize(size_t window) {
+  if (window != cpus.length()) {
+    cpus = PercentileWindow(window);
+    memBytes = PercentileWindow(window);
+  }
+}
+
+void Headroom::save(StateWriter& writer) const {
+  cpus.save(writer);
+  memBytes.save(writer);
+}
+
+bool Headroom::restore(StateReader& reader) {
+  PercentileWindow restoredCpus = cpus;
+  PercentileWindow restoredMemBytes = memBytes;
+  if (!restoredCpus.restore(reader) || !restoredMemBytes.restore(reader)) {
+    return false;
+  }
+  cpus = restoredCpus;
+  memBytes = restoredMemBytes;
+  return true;
+}
+
+Option<double> Headroom::reservedCpus(double percentile, double margin) const {
+  auto const peak = cpus.percentile(percentile);
+  if (peak.isNone()) {
+    return None();
+  }
+  return peak.get() * (1 + margin);
+}
+
+Option<Bytes> Headroom::reservedMem(double percentile, double margin) const {
+  auto const peak = memBytes.percentile(percentile);
+  if (peak.isNone()) {
+    return None();
+  }
+  return Bytes(static_cast<uint64_t>(peak.get() * (1 + margin)));
+}
+
+Resources Headroom::limit(
+    Resources const& offerable,
+    ResourceUsage const& usage,
+    double percentile,
+    double margin) const
+{
+  Resources limited = offerable;
+  Resources const capacity = Resources(usage.total()).nonRevocable();
+
+  auto const totalCpus = capacity.cpus();
+  auto const reservedCpus = this->reservedCpus(percentile, margin);
+  if (totalCpus.isSome() && reservedCpus.isSome()) {
+    cap(limited, "cpus", totalCpus.get() - reservedCpus.get());
+  }
+
+  auto const totalMem = capacity.mem();
+  auto const reservedMem = this->reservedMem(percentile, margin);
+  if (totalMem.isSome() && reservedMem.isSome()) {
+    // Memory resources are given in MB
+    double const available =
+      static_cast<double>(totalMem.get().bytes()) - static_cast<double>(reservedMem.get().bytes());
+    cap(limited, "mem", available / Bytes::MEGABYTES);
+  }
+
+  return limited;
+}
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <stout/bytes.hpp>
+#include <stout/option.hpp>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+class ExecutorStatistics;
+class StateReader;
+class StateWriter;
+
+/*
+ * Ring buffer of the most recent values of a series that answers percentile
+ * queries using the nearest-rank method.
+ */
+class PercentileWindow
+{
+public:
+  explicit PercentileWindow(size_t length);
+
+  void add(double value);
+
+  // Returns the given percentile (between 0 and 1), or None if empty
+  Option<double> percentile(double percentile) const;
+
+  size_t size() const { return values.size(); }
+  size_t length() const { return capacity; }
+
+  /*
+   * Checkpoints the values, see `Checkpoint`. If the window has become
+   * shorter since, only the most recent values are restored. A failed
+   * restore leaves the window untouched.
+   */
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  size_t capacity;
+  std::vector<double> values;
+  size_t next;
+  mutable std::vector<double> scratch;
+};
+
+/*
+ * Reserves headroom for the peaks of non-revocable executors.
+ *
+ * A static amount of revocable resources either has to be sized for the
+ * burstiest host or risks overloading it. Instead, the CPUs and memory used
+ * by all non-revocable executors together are tracked over a window of
+ * estimations. A percentile of them plus a margin is reserved, and only the
+ * rest of the agent's capacity may be offered as revocable.
+ */
+class Headroom
+{
+public:
+  explicit Headroom(size_t window);
+
+  // Records the usage of the non-revocable executors of the snapshot
+  void update(mesos::ResourceUsage const& usage, ExecutorStatistics const& executors);
+
+  // Starts over if the window length changes
+  void resize(size_t window);
+
+  /*
+   * Returns the CPUs and memory to reserve, i.e. the given percentile of the
+   * recorded usage increased by `margin` (a fraction of it). Returns None
+   * before the first snapshot.
+   */
+  Option<double> reservedCpus(double percentile, double margin) const;
+  Option<Bytes> reservedMem(double percentile, double margin) const;
+
+  /*
+   * Caps the CPUs and memory of `offerable` at what is left of the
+   * non-revocable capacity of the agent once the headroom is reserved.
+   * Resources the agent does not report a capacity for are not capped.
+   */
+  mesos::Resources limit(
+    mesos::Resources const& offerable,
+    mesos::ResourceUsage const& usage,
+    double percentile,
+    double margin) const;
+
+  // Checkpointing, like `PercentileWindow`
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  PercentileWindow cpus;
+  PercentileWindow memBytes;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,206 @@
+#pragma once
+
+/*
+ * Reader for the host state the threshold modules publish in POSIX shared
+ * memory if `shm_export` is set.
+ *
+ * Each module publishes the host state of its latest decision, i.e. the
+ * sampled signals, their thresholds and which of them are reached, in its
+ * own segment: `/threshold-resource-estimator` and
+ * `/threshold-qos-controller`. Local tools can poll it rather than parsing
+ * /proc themselves. A read is a copy of a few hundred bytes without any
+ * system call.
+ *
+ * This header only depends on the C++11 standard library and POSIX, so that
+ * it can be copied into other projects. Link with `-lrt` on glibc before
+ * 2.34.
+ *
+ *   com::blue_yonder::HostStateReader reader;
+ *   com::blue_yonder::HostState state;
+ *   if (reader.open(HOST_STATE_CONTROLLER) && reader.read(state) &&
+ *       (state.flags & HostState::MEM_EXCEEDED)) {
+ *     // back off
+ *   }
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace com {
+namespace blue_yonder {
+
+char const* const HOST_STATE_ESTIMATOR = "/threshold-resource-estimator";
+char const* const HOST_STATE_CONTROLLER = "/threshold-qos-controller";
+
+/*
+ * The host state of a single decision, as in its `DecisionRecord`. Signals
+ * that are not sampled are 0, throttling is negative if unknown. Thresholds
+ * that are not configured hold the largest value of their type, except for
+ * the CPU frequency which is a lower bound and 0 then.
+ */
+struct HostState
+{
+  enum Flag : uint32_t {
+    LOAD_ERROR = 1 << 0,
+    MEM_ERROR = 1 << 1,
+    LOAD_EXCEEDED = 1 << 2,
+    MEM_EXCEEDED = 1 << 3,
+    RECLAIM_ERROR = 1 << 4,
+    RECLAIM_EXCEEDED = 1 << 5,
+    THROTTLING_EXCEEDED = 1 << 6,
+    IO_ERROR = 1 << 7,
+    IO_EXCEEDED = 1 << 8,
+    NET_ERROR = 1 << 9,
+    NET_EXCEEDED = 1 << 10,
+    RUNQUEUE_ERROR = 1 << 11,
+    RUNQUEUE_EXCEEDED = 1 << 12,
+    FREQUENCY_ERROR = 1 << 13,
+    FREQUENCY_EXCEEDED = 1 << 14,
+    SAMPLE_INCOMPLETE = 1 << 15, // the host could not be sampled in time
+  };
+
+  double timestamp; // seconds since the epoch
+  uint64_t decisions; // published since the module started
+  uint32_t flags;
+  uint32_t executors;
+  double load[3];
+  double loadThreshold[3];
+  uint64_t memTotalBytes;
+  uint64_t memAvailableBytes;
+  uint64_t memThresholdBytes;
+  // pgscan_direct, pgsteal, allocstall, swap per second
+  double reclaimRates[4];
+  double reclaimThreshold[4];
+  double throttling; // of non-revocable executors
+  double throttlingThreshold;
+  double ioUtilization; // of the busiest selected device
+  double ioQueueDepth;
+  double ioUtilThreshold;
+  double ioQueueDepthThreshold;
+  double netRx; // fraction of the link speed of the busiest selected interface
+  double netTx;
+  double netRxThreshold;
+  double netTxThreshold;
+  double runQueueDelay; // milliseconds per timeslice
+  double runQueueDelayThreshold;
+  double cpuFrequency; // percent of the nominal frequency, -1 if unknown
+  double cpuFrequencyThreshold;
+  uint64_t thermalThrottleEvents; // since the previous decision
+  double offerFraction; // of the revocable resources, estimator only
+};
+
+static_assert(std::is_pod<HostState>::value, "HostState must be POD");
+
+/*
+ * The layout of a segment. The state is protected by a sequence lock: the
+ * single writer makes the sequence odd, copies the state and makes it even
+ * again. Readers retry until they see the same even sequence before and
+ * after their copy.
+ *
+ * Any change to the layout, including the one of `HostState`, must bump
+ * `VERSION`.
+ */
+struct HostStateSegment
+{
+  static constexpr uint32_t VERSION = 3;
+
+  char magic[8]; // "THRSHARE"
+  uint32_t version;
+  uint32_t size; // of the whole segment
+  std::atomic<uint64_t> sequence;
+  HostState state;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The sequence must be lock-free across processes");
+static_assert(std::is_standard_layout<HostStateSegment>::value, "HostStateSegment must be standard layout");
+
+char const HOST_STATE_MAGIC[8] = {'T', 'H', 'R', 'S', 'H', 'A', 'R', 'E'};
+
+/*
+ * Maps a segment read-only. A reader is not thread-safe, use one per thread.
+ */
+class HostStateReader
+{
+public:
+  HostStateReader() : segment(nullptr) {}
+
+  ~HostStateReader() { close(); }
+
+  HostStateReader(HostStateReader const&) = delete;
+  HostStateReader& operator=(HostStateReader const&) = delete;
+
+  // Returns false if the segment does not exist or is of another version.
+  bool open(char const* name) {
+    close();
+
+    int const fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(HostStateSegment)) {
+      ::close(fd);
+      return false;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(HostStateSegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+      return false;
+    }
+
+    segment = static_cast<HostStateSegment const*>(mapping);
+    if (memcmp(segment->magic, HOST_STATE_MAGIC, sizeof(HOST_STATE_MAGIC)) != 0 ||
+        segment->version != HostStateSegment::VERSION ||
+        segment->size != sizeof(HostStateSegment)) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (segment != nullptr) {
+      munmap(const_cast<HostStateSegment*>(segment), sizeof(HostStateSegment));
+      segment = nullptr;
+    }
+  }
+
+  /*
+   * Copies a consistent state. Returns false if the reader is not open or
+   * nothing has been published yet. Gives up after `attempts` concurrent
+   * writes, which only happens if the writer is much faster than expected.
+   */
+  bool read(HostState& state, int attempts = 1000) const {
+    if (segment == nullptr) {
+      return false;
+    }
+    for (int i = 0; i < attempts; ++i) {
+      uint64_t const before = segment->sequence.load(std::memory_order_acquire);
+      if (before % 2 != 0) {
+        continue;
+      }
+      memcpy(&state, &segment->state, sizeof(state));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (segment->sequence.load(std::memory_order_relaxed) == before) {
+        return before > 0;
+      }
+    }
+    return false;
+  }
+
+private:
+  HostStateSegment const* segment;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,156 @@
+#include "host_state_export.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <stout/error.hpp>
+
+#include "decision_trace.hpp"
+
+using process::Owned;
+
+using com::blue_yonder::DecisionRecord;
+using com::blue_yonder::HostState;
+using com::blue_yonder::HostStateExport;
+using com::blue_yonder::HostStateSegment;
+
+
+constexpr uint32_t HostStateSegment::VERSION;
+
+namespace {
+
+constexpr bool same(HostState::Flag flag, DecisionRecord::Flag other) {
+  return static_cast<uint32_t>(flag) == static_cast<uint32_t>(other);
+}
+
+} // namespace {
+
+// The flags of a decision are published as they are.
+static_assert(
+  same(HostState::LOAD_ERROR, DecisionRecord::LOAD_ERROR) &&
+  same(HostState::MEM_ERROR, DecisionRecord::MEM_ERROR) &&
+  same(HostState::LOAD_EXCEEDED, DecisionRecord::LOAD_EXCEEDED) &&
+  same(HostState::MEM_EXCEEDED, DecisionRecord::MEM_EXCEEDED) &&
+  same(HostState::RECLAIM_ERROR, DecisionRecord::RECLAIM_ERROR) &&
+  same(HostState::RECLAIM_EXCEEDED, DecisionRecord::RECLAIM_EXCEEDED) &&
+  same(HostState::THROTTLING_EXCEEDED, DecisionRecord::THROTTLING_EXCEEDED) &&
+  same(HostState::IO_ERROR, DecisionRecord::IO_ERROR) &&
+  same(HostState::IO_EXCEEDED, DecisionRecord::IO_EXCEEDED) &&
+  same(HostState::NET_ERROR, DecisionRecord::NET_ERROR) &&
+  same(HostState::NET_EXCEEDED, DecisionRecord::NET_EXCEEDED) &&
+  same(HostState::RUNQUEUE_ERROR, DecisionRecord::RUNQUEUE_ERROR) &&
+  same(HostState::RUNQUEUE_EXCEEDED, DecisionRecord::RUNQUEUE_EXCEEDED) &&
+  same(HostState::FREQUENCY_ERROR, DecisionRecord::FREQUENCY_ERROR) &&
+  same(HostState::FREQUENCY_EXCEEDED, DecisionRecord::FREQUENCY_EXCEEDED) &&
+  same(HostState::SAMPLE_INCOMPLETE, DecisionRecord::SAMPLE_INCOMPLETE),
+  "HostState flags must match DecisionRecord flags");
+
+
+Try<Owned<HostStateExport>> HostStateExport::open(std::string const& name, mode_t mode) {
+  int const fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, mode);
+  if (fd < 0) {
+    return ErrnoError("Failed to open shared memory segment " + name);
+  }
+
+  // The mode on creation is subject to the umask, and a segment left behind
+  // by an earlier run may have other permissions.
+  if (fchmod(fd, mode) != 0) {
+    auto const error = ErrnoError("Failed to set the mode of shared memory segment " + name);
+    ::close(fd);
+    return error;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    auto const error = ErrnoError("Failed to stat shared memory segment " + name);
+    ::close(fd);
+    return error;
+  }
+
+  // A segment of a different size stems from an incompatible layout. We zero
+  // it so that readers do not mistake it for a valid state.
+  if (static_cast<size_t>(status.st_size) != sizeof(HostStateSegment) &&
+      (ftruncate(fd, 0) != 0 || ftruncate(fd, sizeof(HostStateSegment)) != 0)) {
+    auto const error = ErrnoError("Failed to resize shared memory segment " + name);
+    ::close(fd);
+    return error;
+  }
+
+  void* mapping =
+    mmap(nullptr, sizeof(HostStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return ErrnoError("Failed to map shared memory segment " + name);
+  }
+
+  // The sequence is kept across restarts, so that readers never see it go
+  // back. The header is written last as readers check it on open.
+  auto* segment = static_cast<HostStateSegment*>(mapping);
+  if (memcmp(segment->magic, HOST_STATE_MAGIC, sizeof(HOST_STATE_MAGIC)) != 0 ||
+      segment->version != HostStateSegment::VERSION ||
+      segment->size != sizeof(HostStateSegment)) {
+    memset(&segment->state, 0, sizeof(segment->state));
+    segment->sequence.store(0, std::memory_order_relaxed);
+    segment->version = HostStateSegment::VERSION;
+    segment->size = sizeof(HostStateSegment);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(segment->magic, HOST_STATE_MAGIC, sizeof(HOST_STATE_MAGIC));
+  } else if (segment->sequence.load(std::memory_order_relaxed) % 2 != 0) {
+    // A previous incarnation died while publishing
+    segment->sequence.fetch_add(1, std::memory_order_release);
+  }
+
+  return Owned<HostStateExport>(new HostStateExport(name, segment));
+}
+
+HostStateExport::HostStateExport(std::string const& name, HostStateSegment* segment)
+  : segmentName(name),
+    segment(segment),
+    decisions(0)
+{}
+
+HostStateExport::~HostStateExport() {
+  munmap(segment, sizeof(HostStateSegment));
+}
+
+void HostStateExport::publish(DecisionRecord const& record) {
+  HostState state;
+  state.timestamp = record.timestamp;
+  state.decisions = ++decisions;
+  state.flags = record.flags;
+  state.executors = record.executors;
+  memcpy(state.load, record.load, sizeof(state.load));
+  memcpy(state.loadThreshold, record.loadThreshold, sizeof(state.loadThreshold));
+  state.memTotalBytes = record.memTotalBytes;
+  state.memAvailableBytes = record.memAvailableBytes;
+  state.memThresholdBytes = record.memThresholdBytes;
+  memcpy(state.reclaimRates, record.reclaimRates, sizeof(state.reclaimRates));
+  memcpy(state.reclaimThreshold, record.reclaimThreshold, sizeof(state.reclaimThreshold));
+  state.throttling = record.throttling;
+  state.throttlingThreshold = record.throttlingThreshold;
+  state.ioUtilization = record.ioUtilization;
+  state.ioQueueDepth = record.ioQueueDepth;
+  state.ioUtilThreshold = record.ioUtilThreshold;
+  state.ioQueueDepthThreshold = record.ioQueueDepthThreshold;
+  state.netRx = record.netRx;
+  state.netTx = record.netTx;
+  state.netRxThreshold = record.netRxThreshold;
+  state.netTxThreshold = record.netTxThreshold;
+  state.runQueueDelay = record.runQueueDelay;
+  state.runQueueDelayThreshold = record.runQueueDelayThreshold;
+  state.cpuFrequency = record.cpuFrequency;
+  state.cpuFrequencyThreshold = record.cpuFrequencyThreshold;
+  state.thermalThrottleEvents = record.thermalThrottleEvents;
+  state.offerFraction = record.offerFraction;
+
+  // Single writer sequence lock: odd while the state is being copied
+  uint64_t const sequence = segment->sequence.load(std::memory_order_relaxed);
+  segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&segment->state, &state, sizeof(state));
+  segment->sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+#include <sys/types.h>
+
+#include <stout/try.hpp>
+
+#include <process/owned.hpp>
+
+#include "host_state.hpp"
+
+namespace com {
+namespace blue_yonder {
+
+struct DecisionRecord;
+
+/*
+ * Publishes the host state of every decision of a module in a POSIX shared
+ * memory segment, see `HostStateReader`.
+ *
+ * The segment outlives the module so that readers keep their mapping across
+ * restarts of the agent. Publishing is a plain copy into the mapping guarded
+ * by a sequence lock. An export is owned by an actor and must only be
+ * accessed from within it.
+ */
+class HostStateExport
+{
+public:
+  /*
+   * Opens or creates the segment of the given name with the given
+   * permissions. A segment of another layout is reset.
+   */
+  static Try<process::Owned<HostStateExport>> open(std::string const& name, mode_t mode);
+
+  ~HostStateExport();
+
+  void publish(DecisionRecord const& record);
+
+  std::string const& name() const { return segmentName; }
+
+private:
+  HostStateExport(std::string const& name, HostStateSegment* segment);
+  HostStateExport(HostStateExport const&) = delete;
+  HostStateExport& operator=(HostStateExport const&) = delete;
+
+  std::string const segmentName;
+  HostStateSegment* segment;
+  uint64_t decisions;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,52 @@
+#include "io_thread.hpp"
+
+using com::blue_yonder::IOThread;
+
+
+constexpr size_t IOThread::DEFAULT_CAPACITY;
+
+IOThread::IOThread(size_t capacity)
+  : capacity{capacity},
+    stopping{false},
+    thread{&IOThread::loop, this}
+{}
+
+IOThread::~IOThread() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  condition.notify_one();
+  thread.join();
+}
+
+bool IOThread::enqueue(std::function<void()> const& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.size() >= capacity) {
+      return false;
+    }
+    tasks.push_back(task);
+  }
+  condition.notify_one();
+  return true;
+}
+
+void IOThread::loop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this]() { return stopping or not tasks.empty(); });
+
+      // Pending tasks are still executed on shutdown so that no caller is
+      // left waiting on a future that will never be completed.
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
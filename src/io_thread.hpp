@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <process/future.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+/*
+ * Runs blocking calls, such as reading host metrics from /proc, on a
+ * dedicated thread.
+ *
+ * The libprocess worker threads executing our actors are shared with the
+ * Mesos agent. A /proc read that stalls under memory pressure must therefore
+ * not run on them. Callers instead receive a future that is completed by the
+ * I/O thread once the call has returned.
+ *
+ * A call that hangs, e.g. a read of /proc stuck on an NFS mount, blocks all
+ * later ones. At most `capacity` calls are therefore kept waiting. Further
+ * calls fail right away rather than piling up behind the hanging one.
+ */
+class IOThread
+{
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 16;
+
+  explicit IOThread(size_t capacity = DEFAULT_CAPACITY);
+  IOThread(IOThread const&) = delete;
+  IOThread& operator=(IOThread const&) = delete;
+  ~IOThread();
+
+  template <typename T>
+  process::Future<T> run(std::function<T()> const& call)
+  {
+    auto const promise = std::make_shared<process::Promise<T>>();
+    if (!enqueue([promise, call]() { promise->set(call()); })) {
+      return process::Failure("Too many calls waiting for the I/O thread");
+    }
+    return promise->future();
+  }
+
+private:
+  // Returns false if the task has been rejected as the queue is full
+  bool enqueue(std::function<void()> const& task);
+  void loop();
+
+  size_t const capacity;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<std::function<void()>> tasks;
+  bool stopping;
+  std::thread thread;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,176 @@
+#include "memory_protection.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <stout/os/exists.hpp>
+#include <stout/os/ls.hpp>
+#include <stout/os/read.hpp>
+#include <stout/os/stat.hpp>
+#include <stout/os/write.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include <glog/logging.h>
+
+#include <mesos/resources.hpp>
+
+#include "config.hpp"
+#include "os.hpp"
+#include "revocable.hpp"
+
+using mesos::Resources;
+using mesos::ResourceUsage;
+
+namespace com {
+namespace blue_yonder {
+
+namespace {
+
+size_t write(std::string const& path, std::string const& value) {
+  auto const written = ::os::write(path, value);
+  if (written.isError()) {
+    LOG(WARNING) << "Failed to write '" << value << "' to " << path << ": " << written.error();
+    return 1;
+  }
+  return 0;
+}
+
+// Adjusts all tasks of a cgroup and of the cgroups nested in it
+size_t adjustOomScores(std::string const& cgroup, int score, std::string const& procRoot) {
+  size_t failures = 0;
+
+  auto const procs = ::os::read(path::join(cgroup, "cgroup.procs"));
+  if (procs.isError()) {
+    LOG(WARNING) << "Failed to read the tasks of " << cgroup << ": " << procs.error();
+    return 1;
+  }
+  for (auto const& pid : strings::tokenize(procs.get(), "\n")) {
+    // Tasks may exit at any time
+    auto const path = path::join(procRoot, pid, "oom_score_adj");
+    if (::os::exists(path::join(procRoot, pid))) {
+      failures += write(path, stringify(score));
+    }
+  }
+
+  auto const entries = ::os::ls(cgroup);
+  if (entries.isSome()) {
+    for (auto const& entry : entries.get()) {
+      auto const nested = path::join(cgroup, entry);
+      if (::os::stat::isdir(nested)) {
+        failures += adjustOomScores(nested, score, procRoot);
+      }
+    }
+  }
+  return failures;
+}
+
+bool contains(std::vector<MemoryProtection::Limit> const& limits, std::string const& cgroup) {
+  return std::any_of(limits.begin(), limits.end(), [&cgroup](MemoryProtection::Limit const& limit) {
+    return limit.first == cgroup;
+  });
+}
+
+} // namespace {
+
+MemoryProtection planMemoryProtection(
+    ResourceUsage const& usage,
+    Try<os::MemInfo> const& memory,
+    Configuration const& config)
+{
+  MemoryProtection protection;
+  protection.oomScoreAdj = config.oomScoreAdj;
+
+  uint64_t revocableUsage = 0;
+  uint64_t protectedMemory = 0;
+  std::vector<std::pair<std::string, uint64_t>> revocable;
+  for (auto const& executor : usage.executors()) {
+    if (!executor.has_container_id()) {
+      continue;
+    }
+    auto const cgroup = path::join(config.cgroupRoot, executor.container_id().value());
+    if (isRevocable(executor)) {
+      revocable.emplace_back(cgroup, executor.statistics().mem_total_bytes());
+      revocableUsage += executor.statistics().mem_total_bytes();
+      protection.revocable.push_back(cgroup);
+    } else {
+      auto const allocated = Resources(executor.allocated()).mem();
+      if (allocated.isSome()) {
+        protection.low.emplace_back(cgroup, allocated.get().bytes());
+        protectedMemory += allocated.get().bytes();
+      }
+    }
+  }
+
+  // Protection only applies as far as all ancestors are protected as well
+  if (!protection.low.empty()) {
+    protection.low.emplace_back(config.cgroupRoot, protectedMemory);
+  }
+
+  bool const thresholdSet = config.memThreshold < Bytes(std::numeric_limits<uint64_t>::max());
+  if (thresholdSet && memory.isSome() && !revocable.empty()) {
+    double const used = static_cast<double>(
+      (memory.get().total - memory.get().memAvailable).bytes());
+    double const slack = static_cast<double>(config.memThreshold.bytes()) - used;
+    double const minimum = static_cast<double>(config.memoryHighMin.bytes());
+
+    if (config.revocableCgroup.isSome()) {
+      double const high = std::max(minimum, revocableUsage + slack);
+      protection.high.emplace_back(config.revocableCgroup.get(), static_cast<uint64_t>(high));
+    } else {
+      for (auto const& container : revocable) {
+        // Beyond the threshold, the excess is taken from the containers in
+        // proportion to their usage rather than evenly, which would limit
+        // small ones to nothing.
+        double const share = slack >= 0
+          ? slack / revocable.size()
+          : revocableUsage > 0 ? slack * container.second / revocableUsage : 0;
+        double const high = std::max(minimum, container.second + share);
+        protection.high.emplace_back(container.first, static_cast<uint64_t>(high));
+      }
+    }
+  }
+
+  return protection;
+}
+
+void planMemoryReset(MemoryProtection& protection, MemoryProtection const& applied) {
+  for (auto const& limit : applied.high) {
+    if (!contains(protection.high, limit.first)) {
+      protection.unlimited.push_back(limit.first);
+    }
+  }
+  for (auto const& limit : applied.low) {
+    if (!contains(protection.low, limit.first)) {
+      protection.unprotected.push_back(limit.first);
+    }
+  }
+}
+
+size_t applyMemoryProtection(MemoryProtection const& protection, std::string const& procRoot) {
+  size_t failures = 0;
+  for (auto const& cgroup : protection.unlimited) {
+    if (::os::exists(cgroup)) {
+      failures += write(path::join(cgroup, "memory.high"), "max");
+    }
+  }
+  for (auto const& cgroup : protection.unprotected) {
+    if (::os::exists(cgroup)) {
+      failures += write(path::join(cgroup, "memory.low"), "0");
+    }
+  }
+  for (auto const& limit : protection.high) {
+    failures += write(path::join(limit.first, "memory.high"), stringify(limit.second));
+  }
+  for (auto const& limit : protection.low) {
+    failures += write(path::join(limit.first, "memory.low"), stringify(limit.second));
+  }
+  for (auto const& cgroup : protection.revocable) {
+    failures += adjustOomScores(cgroup, protection.oomScoreAdj, procRoot);
+  }
+  return failures;
+}
+
+} // namespace blue_yonder {
+} // namespace com {
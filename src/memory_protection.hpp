@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stout/try.hpp>
+
+#include <mesos/mesos.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+namespace os {
+struct MemInfo;
+}
+
+struct Configuration;
+
+/*
+ * The cgroup v2 settings that make the kernel reclaim and kill revocable
+ * tasks before non-revocable ones.
+ *
+ * The controller only acts once per correction interval. A fast allocation
+ * burst may reach the kernel OOM killer earlier, which does not distinguish
+ * revocable from non-revocable tasks. With these settings the kernel itself
+ * prefers revocable tasks without any polling latency:
+ *
+ * - `memory.high` throttles and reclaims revocable containers, either each
+ *   of them or their common parent, once they would push the host beyond
+ *   the memory threshold. It is never set below `memoryHighMin`, which
+ *   would stall the containers instead of reclaiming them.
+ * - `memory.low` protects the memory allocated to non-revocable containers
+ *   from reclaim.
+ * - A raised `oom_score_adj` makes the OOM killer pick revocable tasks first.
+ *
+ * Cgroups that were limited or protected by a previous plan but no longer
+ * are reset to `memory.high` max and `memory.low` 0, e.g. once protection
+ * is disabled at runtime.
+ *
+ * The plan is computed on the controller and applied on the I/O thread.
+ */
+struct MemoryProtection
+{
+  typedef std::pair<std::string, uint64_t> Limit; // cgroup, bytes
+
+  std::vector<Limit> high;
+  std::vector<Limit> low;
+  std::vector<std::string> revocable; // cgroups whose tasks are adjusted
+  int oomScoreAdj;
+
+  std::vector<std::string> unlimited; // cgroups whose `memory.high` is reset
+  std::vector<std::string> unprotected; // cgroups whose `memory.low` is reset
+};
+
+/*
+ * Derives the settings from the resource usage and the host memory. The
+ * slack between the used host memory and the memory threshold is split
+ * evenly among the revocable containers on top of their current usage.
+ * Beyond the threshold, each of them is instead limited to its usage minus
+ * its share of the excess, in proportion to its usage. If no memory
+ * threshold is set or the host memory could not be sampled, `memory.high`
+ * is left as it is.
+ */
+MemoryProtection planMemoryProtection(
+  mesos::ResourceUsage const& usage,
+  Try<os::MemInfo> const& memory,
+  Configuration const& config);
+
+/*
+ * Adds the resets of all cgroups that the `applied` plan limited or
+ * protected but `protection` does not. An empty plan resets everything.
+ */
+void planMemoryReset(MemoryProtection& protection, MemoryProtection const& applied);
+
+/*
+ * Writes the settings to the cgroup and proc file systems. Resets of
+ * cgroups that have been removed meanwhile are skipped. Continues on errors
+ * and returns the number of failed writes. This is blocking I/O and must be
+ * done on the I/O thread.
+ */
+size_t applyMemoryProtection(
+  MemoryProtection const& protection,
+  std::string const& procRoot = "/proc");
+
+} // namespace blue_yonder {
+} // namespace com {
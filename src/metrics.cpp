@@ -0,0 +1,312 @@
+#include "metrics.hpp"
+
+#include <process/metrics/metrics.hpp>
+
+#include "os.hpp"
+#include "policy.hpp"
+
+using process::metrics::add;
+using process::metrics::remove;
+
+using com::blue_yonder::ControllerMetrics;
+using com::blue_yonder::EstimatorMetrics;
+using com::blue_yonder::Metrics;
+using com::blue_yonder::Overloads;
+using com::blue_yonder::Signals;
+
+
+Metrics::Metrics(std::string const& prefix)
+  : load1min(prefix + "/load_1min"),
+    load5min(prefix + "/load_5min"),
+    load15min(prefix + "/load_15min"),
+    memTotalBytes(prefix + "/mem_total_bytes"),
+    memUsedBytes(prefix + "/mem_used_bytes"),
+    loadThresholdExceeded(prefix + "/load_threshold_exceeded"),
+    memThresholdExceeded(prefix + "/mem_threshold_exceeded"),
+    pgscanDirectRate(prefix + "/pgscan_direct_rate"),
+    pgstealRate(prefix + "/pgsteal_rate"),
+    allocstallRate(prefix + "/allocstall_rate"),
+    swapRate(prefix + "/swap_rate"),
+    reclaimThresholdExceeded(prefix + "/reclaim_threshold_exceeded"),
+    throttling(prefix + "/throttling"),
+    throttlingThresholdExceeded(prefix + "/throttling_threshold_exceeded"),
+    ioUtilization(prefix + "/io_utilization"),
+    ioQueueDepth(prefix + "/io_queue_depth"),
+    ioThresholdExceeded(prefix + "/io_threshold_exceeded"),
+    netRxUtilization(prefix + "/net_rx_utilization"),
+    netTxUtilization(prefix + "/net_tx_utilization"),
+    netThresholdExceeded(prefix + "/net_threshold_exceeded"),
+    runQueueDelay(prefix + "/runqueue_delay_ms"),
+    runQueueThresholdExceeded(prefix + "/runqueue_threshold_exceeded"),
+    cpuFrequencyPercent(prefix + "/cpu_frequency_percent"),
+    thermalThrottleEvents(prefix + "/thermal_throttle_events"),
+    cpuFrequencyThresholdReached(prefix + "/cpu_frequency_threshold_reached"),
+    sampleErrors(prefix + "/sample_errors"),
+    configWatchErrors(prefix + "/config_watch_errors"),
+    usageLatency(prefix + "/usage_latency", Hours(1)),
+    sampleLatency(prefix + "/sample_latency", Hours(1))
+{
+  add(load1min);
+  add(load5min);
+  add(load15min);
+  add(memTotalBytes);
+  add(memUsedBytes);
+  add(loadThresholdExceeded);
+  add(memThresholdExceeded);
+  add(pgscanDirectRate);
+  add(pgstealRate);
+  add(allocstallRate);
+  add(swapRate);
+  add(reclaimThresholdExceeded);
+  add(throttling);
+  add(throttlingThresholdExceeded);
+  add(ioUtilization);
+  add(ioQueueDepth);
+  add(ioThresholdExceeded);
+  add(netRxUtilization);
+  add(netTxUtilization);
+  add(netThresholdExceeded);
+  add(runQueueDelay);
+  add(runQueueThresholdExceeded);
+  add(cpuFrequencyPercent);
+  add(thermalThrottleEvents);
+  add(cpuFrequencyThresholdReached);
+  add(sampleErrors);
+  add(configWatchErrors);
+  add(usageLatency);
+  add(sampleLatency);
+}
+
+Metrics::~Metrics() {
+  remove(load1min);
+  remove(load5min);
+  remove(load15min);
+  remove(memTotalBytes);
+  remove(memUsedBytes);
+  remove(loadThresholdExceeded);
+  remove(memThresholdExceeded);
+  remove(pgscanDirectRate);
+  remove(pgstealRate);
+  remove(allocstallRate);
+  remove(swapRate);
+  remove(reclaimThresholdExceeded);
+  remove(throttling);
+  remove(throttlingThresholdExceeded);
+  remove(ioUtilization);
+  remove(ioQueueDepth);
+  remove(ioThresholdExceeded);
+  remove(netRxUtilization);
+  remove(netTxUtilization);
+  remove(netThresholdExceeded);
+  remove(runQueueDelay);
+  remove(runQueueThresholdExceeded);
+  remove(cpuFrequencyPercent);
+  remove(thermalThrottleEvents);
+  remove(cpuFrequencyThresholdReached);
+  remove(sampleErrors);
+  remove(configWatchErrors);
+  remove(usageLatency);
+  remove(sampleLatency);
+}
+
+void Metrics::sampled(Try<::os::Load> const& load, Try<os::MemInfo> const& memory) {
+  if (load.isSome()) {
+    load1min = load.get().one;
+    load5min = load.get().five;
+    load15min = load.get().fifteen;
+  } else {
+    ++sampleErrors;
+  }
+
+  if (memory.isSome()) {
+    memTotalBytes = memory.get().total.bytes();
+    memUsedBytes = (memory.get().total - memory.get().memAvailable).bytes();
+  } else {
+    ++sampleErrors;
+  }
+}
+
+void Metrics::evaluated(bool loadExceeded, bool memExceeded) {
+  loadThresholdExceeded = loadExceeded ? 1 : 0;
+  memThresholdExceeded = memExceeded ? 1 : 0;
+}
+
+void Metrics::sampledReclaim(
+    Try<Option<threshold::ReclaimRates>> const& rates,
+    bool exceeded)
+{
+  if (rates.isError()) {
+    ++sampleErrors;
+  } else if (rates.get().isSome()) {
+    pgscanDirectRate = rates.get().get().pgscanDirect;
+    pgstealRate = rates.get().get().pgsteal;
+    allocstallRate = rates.get().get().allocstall;
+    swapRate = rates.get().get().swap;
+  }
+  reclaimThresholdExceeded = exceeded ? 1 : 0;
+}
+
+void Metrics::evaluatedThrottling(Option<double> const& throttling, bool exceeded) {
+  if (throttling.isSome()) {
+    this->throttling = throttling.get();
+  }
+  throttlingThresholdExceeded = exceeded ? 1 : 0;
+}
+
+void Metrics::sampledDisk(Try<Option<threshold::DiskLoad>> const& load, bool exceeded) {
+  if (load.isError()) {
+    ++sampleErrors;
+  } else if (load.get().isSome()) {
+    ioUtilization = load.get().get().utilization;
+    ioQueueDepth = load.get().get().queueDepth;
+  }
+  ioThresholdExceeded = exceeded ? 1 : 0;
+}
+
+void Metrics::sampledNetwork(Try<Option<threshold::NetworkLoad>> const& load, bool exceeded) {
+  if (load.isError()) {
+    ++sampleErrors;
+  } else if (load.get().isSome()) {
+    netRxUtilization = load.get().get().rx;
+    netTxUtilization = load.get().get().tx;
+  }
+  netThresholdExceeded = exceeded ? 1 : 0;
+}
+
+void Metrics::sampledRunQueue(Try<Option<double>> const& delay, bool exceeded) {
+  if (delay.isError()) {
+    ++sampleErrors;
+  } else if (delay.get().isSome()) {
+    runQueueDelay = delay.get().get();
+  }
+  runQueueThresholdExceeded = exceeded ? 1 : 0;
+}
+
+void Metrics::sampledFrequency(
+    Try<Option<threshold::CpuFrequency>> const& frequency,
+    bool reached)
+{
+  if (frequency.isError()) {
+    ++sampleErrors;
+  } else if (frequency.get().isSome()) {
+    if (frequency.get().get().percent.isSome()) {
+      cpuFrequencyPercent = frequency.get().get().percent.get();
+    }
+    thermalThrottleEvents += frequency.get().get().throttleEvents;
+  }
+  cpuFrequencyThresholdReached = reached ? 1 : 0;
+}
+
+void Metrics::evaluated(Signals const& signals, Overloads const& overloads) {
+  sampled(signals.load, signals.memory);
+  evaluated(overloads.load, overloads.memory);
+  if (signals.reclaim.isSome()) {
+    sampledReclaim(signals.reclaim.get(), overloads.reclaim);
+  }
+  evaluatedThrottling(signals.throttling, overloads.throttling);
+  if (signals.disk.isSome()) {
+    sampledDisk(signals.disk.get(), overloads.io);
+  }
+  if (signals.network.isSome()) {
+    sampledNetwork(signals.network.get(), overloads.network);
+  }
+  if (signals.runQueueDelay.isSome()) {
+    sampledRunQueue(signals.runQueueDelay.get(), overloads.runQueue);
+  }
+  if (signals.frequency.isSome()) {
+    sampledFrequency(signals.frequency.get(), overloads.frequency);
+  }
+}
+
+
+EstimatorMetrics::EstimatorMetrics()
+  : Metrics("threshold_resource_estimator"),
+    offeredRevocableCpus("threshold_resource_estimator/offered_revocable_cpus"),
+    offeredRevocableMem("threshold_resource_estimator/offered_revocable_mem"),
+    offerFraction("threshold_resource_estimator/offer_fraction"),
+    headroomCpus("threshold_resource_estimator/headroom_cpus"),
+    headroomMem("threshold_resource_estimator/headroom_mem"),
+    shadowOfferedRevocableCpus("threshold_resource_estimator/shadow/offered_revocable_cpus"),
+    shadowOfferedRevocableMem("threshold_resource_estimator/shadow/offered_revocable_mem"),
+    shadowOfferDeltaCpus("threshold_resource_estimator/shadow/offer_delta_cpus"),
+    shadowOfferDeltaMem("threshold_resource_estimator/shadow/offer_delta_mem"),
+    shadowCutOffers("threshold_resource_estimator/shadow/cut_offers"),
+    shadowExtraOffers("threshold_resource_estimator/shadow/extra_offers"),
+    oversubscribableLatency("threshold_resource_estimator/oversubscribable_latency", Hours(1))
+{
+  add(offeredRevocableCpus);
+  add(offeredRevocableMem);
+  add(offerFraction);
+  add(headroomCpus);
+  add(headroomMem);
+  add(shadowOfferedRevocableCpus);
+  add(shadowOfferedRevocableMem);
+  add(shadowOfferDeltaCpus);
+  add(shadowOfferDeltaMem);
+  add(shadowCutOffers);
+  add(shadowExtraOffers);
+  add(oversubscribableLatency);
+}
+
+EstimatorMetrics::~EstimatorMetrics() {
+  remove(offeredRevocableCpus);
+  remove(offeredRevocableMem);
+  remove(offerFraction);
+  remove(headroomCpus);
+  remove(headroomMem);
+  remove(shadowOfferedRevocableCpus);
+  remove(shadowOfferedRevocableMem);
+  remove(shadowOfferDeltaCpus);
+  remove(shadowOfferDeltaMem);
+  remove(shadowCutOffers);
+  remove(shadowExtraOffers);
+  remove(oversubscribableLatency);
+}
+
+
+ControllerMetrics::ControllerMetrics()
+  : Metrics("threshold_qos_controller"),
+    memoryKills("threshold_qos_controller/kills/memory"),
+    loadKills("threshold_qos_controller/kills/load"),
+    throttlingKills("threshold_qos_controller/kills/throttling"),
+    ioKills("threshold_qos_controller/kills/io"),
+    networkKills("threshold_qos_controller/kills/network"),
+    runQueueKills("threshold_qos_controller/kills/runqueue"),
+    frequencyKills("threshold_qos_controller/kills/frequency"),
+    lostWorkSeconds("threshold_qos_controller/kills/lost_work_seconds"),
+    memoryProtectionErrors("threshold_qos_controller/memory_protection_errors"),
+    shadowExtraKills("threshold_qos_controller/shadow/extra_kills"),
+    shadowMissingKills("threshold_qos_controller/shadow/missing_kills"),
+    shadowOtherVictims("threshold_qos_controller/shadow/other_victims"),
+    correctionsLatency("threshold_qos_controller/corrections_latency", Hours(1))
+{
+  add(memoryKills);
+  add(loadKills);
+  add(throttlingKills);
+  add(ioKills);
+  add(networkKills);
+  add(runQueueKills);
+  add(frequencyKills);
+  add(lostWorkSeconds);
+  add(memoryProtectionErrors);
+  add(shadowExtraKills);
+  add(shadowMissingKills);
+  add(shadowOtherVictims);
+  add(correctionsLatency);
+}
+
+ControllerMetrics::~ControllerMetrics() {
+  remove(memoryKills);
+  remove(loadKills);
+  remove(throttlingKills);
+  remove(ioKills);
+  remove(networkKills);
+  remove(runQueueKills);
+  remove(frequencyKills);
+  remove(lostWorkSeconds);
+  remove(memoryProtectionErrors);
+  remove(shadowExtraKills);
+  remove(shadowMissingKills);
+  remove(shadowOtherVictims);
+  remove(correctionsLatency);
+}
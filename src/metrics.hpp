@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include <process/metrics/counter.hpp>
+#include <process/metrics/push_gauge.hpp>
+#include <process/metrics/timer.hpp>
+
+#include "threshold.hpp"
+
+namespace com {
+namespace blue_yonder {
+
+namespace os {
+struct MemInfo;
+}
+
+struct Overloads;
+struct Signals;
+
+/*
+ * Metrics shared by the estimator and the controller. They are registered
+ * with libprocess on construction and thus exposed via the agent's
+ * `/metrics/snapshot` endpoint, prefixed with the name of the module.
+ */
+struct Metrics
+{
+  explicit Metrics(std::string const& prefix);
+  virtual ~Metrics();
+
+  void sampled(Try<::os::Load> const&, Try<os::MemInfo> const&);
+  void evaluated(bool loadExceeded, bool memExceeded);
+  void sampledReclaim(Try<Option<threshold::ReclaimRates>> const&, bool exceeded);
+  void evaluatedThrottling(Option<double> const& throttling, bool exceeded);
+  void sampledDisk(Try<Option<threshold::DiskLoad>> const&, bool exceeded);
+  void sampledNetwork(Try<Option<threshold::NetworkLoad>> const&, bool exceeded);
+  void sampledRunQueue(Try<Option<double>> const& delay, bool exceeded);
+  void sampledFrequency(Try<Option<threshold::CpuFrequency>> const&, bool reached);
+
+  // All of the above for the signals of a decision
+  void evaluated(Signals const&, Overloads const&);
+
+  process::metrics::PushGauge load1min;
+  process::metrics::PushGauge load5min;
+  process::metrics::PushGauge load15min;
+  process::metrics::PushGauge memTotalBytes;
+  process::metrics::PushGauge memUsedBytes;
+
+  process::metrics::PushGauge loadThresholdExceeded;
+  process::metrics::PushGauge memThresholdExceeded;
+
+  process::metrics::PushGauge pgscanDirectRate;
+  process::metrics::PushGauge pgstealRate;
+  process::metrics::PushGauge allocstallRate;
+  process::metrics::PushGauge swapRate;
+  process::metrics::PushGauge reclaimThresholdExceeded;
+
+  process::metrics::PushGauge throttling;
+  process::metrics::PushGauge throttlingThresholdExceeded;
+
+  process::metrics::PushGauge ioUtilization;
+  process::metrics::PushGauge ioQueueDepth;
+  process::metrics::PushGauge ioThresholdExceeded;
+
+  process::metrics::PushGauge netRxUtilization;
+  process::metrics::PushGauge netTxUtilization;
+  process::metrics::PushGauge netThresholdExceeded;
+
+  process::metrics::PushGauge runQueueDelay;
+  process::metrics::PushGauge runQueueThresholdExceeded;
+
+  process::metrics::PushGauge cpuFrequencyPercent;
+  process::metrics::Counter thermalThrottleEvents;
+  process::metrics::PushGauge cpuFrequencyThresholdReached;
+
+  process::metrics::Counter sampleErrors;
+  process::metrics::Counter configWatchErrors;
+
+  process::metrics::Timer<Milliseconds> usageLatency;
+  process::metrics::Timer<Milliseconds> sampleLatency;
+};
+
+
+struct EstimatorMetrics : public Metrics
+{
+  EstimatorMetrics();
+  virtual ~EstimatorMetrics();
+
+  process::metrics::PushGauge offeredRevocableCpus;
+  process::metrics::PushGauge offeredRevocableMem;
+  process::metrics::PushGauge offerFraction;
+  process::metrics::PushGauge headroomCpus;
+  process::metrics::PushGauge headroomMem;
+
+  // What the shadow policy would have offered and how much more that is
+  process::metrics::PushGauge shadowOfferedRevocableCpus;
+  process::metrics::PushGauge shadowOfferedRevocableMem;
+  process::metrics::PushGauge shadowOfferDeltaCpus;
+  process::metrics::PushGauge shadowOfferDeltaMem;
+  process::metrics::Counter shadowCutOffers; // offers only the live policy made
+  process::metrics::Counter shadowExtraOffers; // offers only the shadow policy would have made
+
+  process::metrics::Timer<Milliseconds> oversubscribableLatency;
+};
+
+
+struct ControllerMetrics : public Metrics
+{
+  ControllerMetrics();
+  virtual ~ControllerMetrics();
+
+  process::metrics::Counter memoryKills;
+  process::metrics::Counter loadKills;
+  process::metrics::Counter throttlingKills;
+  process::metrics::Counter ioKills;
+  process::metrics::Counter networkKills;
+  process::metrics::Counter runQueueKills;
+  process::metrics::Counter frequencyKills;
+  process::metrics::Counter lostWorkSeconds; // since the victims started
+  process::metrics::Counter memoryProtectionErrors;
+
+  // Corrections in which the shadow policy would have decided differently
+  process::metrics::Counter shadowExtraKills;
+  process::metrics::Counter shadowMissingKills;
+  process::metrics::Counter shadowOtherVictims;
+
+  process::metrics::Timer<Milliseconds> correctionsLatency;
+};
+
+} // namespace blue_yonder {
+} // namespace com {
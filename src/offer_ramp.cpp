@@ -0,0 +1,68 @@
+#include "offer_ramp.hpp"
+
+#include <algorithm>
+
+#include "checkpoint.hpp"
+
+using mesos::Resources;
+
+namespace com {
+namespace blue_yonder {
+
+OfferRamp::OfferRamp(double increase, double decrease)
+  : increase{increase},
+    decrease{decrease},
+    current{0},
+    overloaded{false}
+{}
+
+double OfferRamp::update(bool overloaded) {
+  if (overloaded) {
+    if (!this->overloaded) {
+      current *= decrease;
+    }
+  } else {
+    current = std::min(1.0, current + increase);
+  }
+  this->overloaded = overloaded;
+  return current;
+}
+
+void OfferRamp::reconfigure(double increase, double decrease) {
+  this->increase = increase;
+  this->decrease = decrease;
+}
+
+void OfferRamp::restore(double fraction, bool overloaded) {
+  current = std::min(std::max(fraction, 0.0), 1.0);
+  this->overloaded = overloaded;
+}
+
+void OfferRamp::save(StateWriter& writer) const {
+  writer.write(current);
+  writer.write(overloaded);
+}
+
+bool OfferRamp::restore(StateReader& reader) {
+  double fraction;
+  bool wasOverloaded;
+  if (!reader.read(fraction) || !reader.read(wasOverloaded)) {
+    return false;
+  }
+  restore(fraction, wasOverloaded);
+  return true;
+}
+
+Resources scaled(Resources const& resources, double factor) {
+  Resources result;
+  for (mesos::Resource resource : resources) {
+    if (resource.type() == mesos::Value::SCALAR) {
+      resource.mutable_scalar()->set_value(resource.scalar().value() * factor);
+    }
+    result += resource;
+  }
+  return result;
+}
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <mesos/resources.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+class StateReader;
+class StateWriter;
+
+/*
+ * Additive-increase/multiplicative-decrease of the fraction of the
+ * revocable resources that are offered.
+ *
+ * Offering all revocable resources as soon as the thresholds clear makes
+ * frameworks launch a wave of revocable tasks, which often pushes the host
+ * right back into overload. Instead, the fraction is cut whenever a
+ * threshold is crossed and then grows step by step while all of them stay
+ * clear. It also starts from zero, so that a restarted agent is not
+ * flooded either.
+ */
+class OfferRamp
+{
+public:
+  OfferRamp(double increase, double decrease);
+
+  /*
+   * Returns the fraction to offer after an estimation. An overload only cuts
+   * the fraction when it starts, not for as long as it lasts.
+   */
+  double update(bool overloaded);
+
+  double fraction() const { return current; }
+
+  void reconfigure(double increase, double decrease);
+
+  // Continues from a checkpointed estimation
+  void restore(double fraction, bool overloaded);
+
+  /*
+   * Checkpoints the ramp on its own, for a policy whose fraction is not part
+   * of the checkpointed estimation, see `Checkpoint`. A failed restore leaves
+   * the ramp untouched.
+   */
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  double increase;
+  double decrease;
+  double current;
+  bool overloaded;
+};
+
+/*
+ * Returns the given resources with all scalar quantities scaled by the given
+ * factor. Ranges and sets, e.g. ports, are kept as they are.
+ */
+mesos::Resources scaled(mesos::Resources const& resources, double factor);
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -1,30 +1,115 @@
 #include "os.hpp"
 
+#include <chrono>
+#include <cstring>
 #include <fstream>
 
+#include <stout/numify.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
 #include <glog/logging.h>
 
-using com::blue_yonder::os::meminfo;
+using com::blue_yonder::os::CpuFreq;
+using com::blue_yonder::os::DiskCounters;
+using com::blue_yonder::os::DiskStats;
+using com::blue_yonder::os::InterfaceCounters;
+using com::blue_yonder::os::MemInfo;
+using com::blue_yonder::os::NetDev;
+using com::blue_yonder::os::SchedStat;
+using com::blue_yonder::os::VmStat;
+
+namespace proc = com::blue_yonder::proc;
+
+
+namespace {
+
+double monotonicSeconds() {
+  auto const now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::duration<double>>(now).count();
+}
+
+bool matches(proc::View const& identifier, char const* counter) {
+  auto const length = strlen(counter);
+  return identifier.startsWith(counter) &&
+    (identifier.size == length || identifier.data[length] == '_');
+}
+
+// Parses a value of /proc/meminfo, given in kB unless stated otherwise.
+Try<Bytes> parseBytes(proc::Fields& fields) {
+  proc::View value;
+  uint64_t parsed = 0;
+  if (!fields.next(value) || !proc::parseUint(value, parsed)) {
+    return Error("Invalid value '" + value.str() + "'");
+  }
+
+  proc::View unit;
+  if (!fields.next(unit)) {
+    return Bytes(parsed);
+  }
+  if (unit != "kB") {
+    return Error("Unknown unit '" + unit.str() + "'");
+  }
+  return Bytes(parsed * 1024);
+}
+
+// Reading the speed fails for interfaces that are down, and virtual ones
+// report -1.
+uint64_t linkSpeed(std::string const& interface) {
+  std::ifstream sys{"/sys/class/net/" + interface + "/speed"};
+  int64_t speed = 0;
+  if (!(sys >> speed) || speed <= 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(speed);
+}
+
+// Reads a single number from a file in /sys. None if the file does not
+// exist, e.g. because the driver does not provide it.
+Option<uint64_t> readUint(std::string const& path) {
+  std::ifstream sys{path};
+  uint64_t value = 0;
+  if (!(sys >> value)) {
+    return None();
+  }
+  return value;
+}
+
+} // namespace {
 
-Try<com::blue_yonder::os::MemInfo> com::blue_yonder::os::meminfo() {
-  std::ifstream proc{"/proc/meminfo"};
 
-  std::string identifier;
-  std::string bytes;
-  std::string unit;
+Try<MemInfo> com::blue_yonder::os::meminfo() {
+  // Each thread sampling the host keeps the file open and reuses its buffer
+  static thread_local proc::ProcFile file{"/proc/meminfo"};
+  auto const content = file.read();
+  if (content.isError()) {
+    return Error(content.error());
+  }
+  return parseMeminfo(content.get());
+}
 
+Try<MemInfo> com::blue_yonder::os::parseMeminfo(proc::View const& content) {
   Option<Bytes> total = None();
   Option<Bytes> memAvailable = None();
 
-  while (proc >> identifier >> bytes >> unit) {
+  proc::Lines lines{content};
+  proc::View line;
+  while (lines.next(line)) {
+    proc::Fields fields{line};
+    proc::View identifier;
+    if (!fields.next(identifier)) {
+      continue;
+    }
+
     if (identifier == "MemTotal:") {
-      auto const parsed = Bytes::parse(bytes + unit);
+      auto const parsed = parseBytes(fields);
       if (parsed.isError()) {
         return Error("Failed to parse MemTotal from /proc/meminfo: " + parsed.error());
       }
       total = parsed.get();
     } else if (identifier == "MemAvailable:") {
-      auto const parsed = Bytes::parse(bytes + unit);
+      auto const parsed = parseBytes(fields);
       if (parsed.isError()) {
         return Error("Failed to parse MemAvailable from /proc/meminfo: " + parsed.error());
       }
@@ -32,9 +117,6 @@ Try<com::blue_yonder::os::MemInfo> com::blue_yonder::os::meminfo() {
     }
   }
 
-  if (not proc.eof() and proc.fail()) {
-    return Error("Failed to read /proc/meminfo");
-  }
   if (not total.isSome()) {
     return Error("Could not find MemTotal in /proc/meminfo");
   }
@@ -44,3 +126,278 @@ Try<com::blue_yonder::os::MemInfo> com::blue_yonder::os::meminfo() {
 
   return MemInfo{total.get(), memAvailable.get()};
 }
+
+Try<VmStat> com::blue_yonder::os::vmstat() {
+  double const timestamp = monotonicSeconds();
+  static thread_local proc::ProcFile file{"/proc/vmstat"};
+  auto const content = file.read();
+  if (content.isError()) {
+    return Error(content.error());
+  }
+  return parseVmStat(content.get(), timestamp);
+}
+
+Try<VmStat> com::blue_yonder::os::parseVmStat(proc::View const& content, double timestamp) {
+  VmStat stat{timestamp, 0, 0, 0, 0, 0};
+  bool swap = false;
+
+  proc::Lines lines{content};
+  proc::View line;
+  while (lines.next(line)) {
+    proc::Fields fields{line};
+    proc::View identifier;
+    proc::View value;
+    if (!fields.next(identifier) || !fields.next(value)) {
+      continue;
+    }
+
+    // Skip all counters we are not interested in without parsing them
+    uint64_t* counter = nullptr;
+    if (matches(identifier, "pgscan_direct") && identifier != "pgscan_direct_throttle") {
+      counter = &stat.pgscanDirect;
+    } else if (matches(identifier, "pgsteal_kswapd") || matches(identifier, "pgsteal_direct")) {
+      counter = &stat.pgsteal;
+    } else if (matches(identifier, "allocstall")) {
+      counter = &stat.allocstall;
+    } else if (identifier == "pswpin") {
+      counter = &stat.pswpin;
+      swap = true;
+    } else if (identifier == "pswpout") {
+      counter = &stat.pswpout;
+    } else {
+      continue;
+    }
+
+    uint64_t parsed = 0;
+    if (!proc::parseUint(value, parsed)) {
+      return Error("Failed to parse " + identifier.str() + " from /proc/vmstat: "
+                   "Invalid value '" + value.str() + "'");
+    }
+    *counter += parsed;
+  }
+
+  if (not swap) {
+    return Error("Could not find pswpin in /proc/vmstat");
+  }
+
+  return stat;
+}
+
+Try<DiskStats> com::blue_yonder::os::diskstats() {
+  double const timestamp = monotonicSeconds();
+  static thread_local proc::ProcFile file{"/proc/diskstats"};
+  auto const content = file.read();
+  if (content.isError()) {
+    return Error(content.error());
+  }
+  return parseDiskStats(content.get(), timestamp);
+}
+
+Try<DiskStats> com::blue_yonder::os::parseDiskStats(proc::View const& content, double timestamp) {
+  DiskStats stats{timestamp, {}};
+
+  proc::Lines lines{content};
+  proc::View line;
+  while (lines.next(line)) {
+    proc::Fields fields{line};
+
+    // major minor name reads merged sectors ms writes merged sectors ms
+    // in_flight io_ticks time_in_queue ...
+    proc::View name;
+    bool valid = fields.skip(2) && fields.next(name);
+    uint64_t counters[11] = {};
+    for (auto& counter : counters) {
+      proc::View value;
+      valid = valid && fields.next(value) && proc::parseUint(value, counter);
+    }
+    if (!valid) {
+      return Error("Failed to parse /proc/diskstats line '" + line.str() + "'");
+    }
+
+    stats.devices[name.str()] = DiskCounters{counters[9], counters[10]};
+  }
+
+  return stats;
+}
+
+Try<NetDev> com::blue_yonder::os::netdev() {
+  double const timestamp = monotonicSeconds();
+  static thread_local proc::ProcFile file{"/proc/net/dev"};
+  auto const content = file.read();
+  if (content.isError()) {
+    return Error(content.error());
+  }
+
+  auto const parsed = parseNetDev(content.get(), timestamp);
+  if (parsed.isError()) {
+    return parsed;
+  }
+
+  NetDev stats = parsed.get();
+  for (auto& interface : stats.interfaces) {
+    interface.second.speed = linkSpeed(interface.first);
+  }
+  return stats;
+}
+
+Try<NetDev> com::blue_yonder::os::parseNetDev(proc::View const& content, double timestamp) {
+  NetDev stats{timestamp, {}};
+
+  // Skip the two header lines
+  proc::Lines lines{content};
+  proc::View line;
+  lines.next(line);
+  lines.next(line);
+
+  while (lines.next(line)) {
+    // The name is not necessarily separated from the first counter by a space
+    auto const* colon = static_cast<char const*>(memchr(line.data, ':', line.size));
+    if (colon == nullptr) {
+      return Error("Failed to parse /proc/net/dev line '" + line.str() + "'");
+    }
+    proc::Fields name{proc::View(line.data, colon - line.data)};
+    proc::Fields fields{proc::View(colon + 1, line.data + line.size - colon - 1)};
+
+    // 8 receive counters starting with bytes, followed by 8 transmit counters
+    proc::View interface;
+    bool valid = name.next(interface);
+    uint64_t counters[9] = {};
+    for (auto& counter : counters) {
+      proc::View value;
+      valid = valid && fields.next(value) && proc::parseUint(value, counter);
+    }
+    if (!valid) {
+      return Error("Failed to parse /proc/net/dev line '" + line.str() + "'");
+    }
+
+    stats.interfaces[interface.str()] = InterfaceCounters{counters[0], counters[8], 0};
+  }
+
+  return stats;
+}
+
+Try<SchedStat> com::blue_yonder::os::schedstat() {
+  static thread_local proc::ProcFile file{"/proc/schedstat"};
+  auto const content = file.read();
+  if (content.isError()) {
+    return Error(content.error());
+  }
+  return parseSchedStat(content.get());
+}
+
+Try<SchedStat> com::blue_yonder::os::parseSchedStat(proc::View const& content) {
+  SchedStat stat{0, 0};
+  bool cpus = false;
+  bool versioned = false;
+
+  proc::Lines lines{content};
+  proc::View line;
+  while (lines.next(line)) {
+    proc::Fields fields{line};
+    proc::View identifier;
+    if (!fields.next(identifier)) {
+      continue;
+    }
+
+    // Versions 16 and 17 only changed the domain lines
+    if (identifier == "version") {
+      proc::View value;
+      uint64_t number = 0;
+      if (!fields.next(value) || !proc::parseUint(value, number)) {
+        return Error("Failed to parse /proc/schedstat line '" + line.str() + "'");
+      }
+      if (number < 15 || number > 17) {
+        return Error("Unsupported /proc/schedstat version " + stringify(number));
+      }
+      versioned = true;
+      continue;
+    }
+    if (!identifier.startsWith("cpu")) {
+      continue;
+    }
+    if (!versioned) {
+      return Error("Missing version before the CPUs in /proc/schedstat");
+    }
+
+    // cpu<N> yld_count 0 sched_count sched_goidle ttwu_count ttwu_local
+    // rq_cpu_time run_delay pcount, as of version 15
+    uint64_t counters[9] = {};
+    bool valid = true;
+    for (auto& counter : counters) {
+      proc::View value;
+      valid = valid && fields.next(value) && proc::parseUint(value, counter);
+    }
+    if (!valid) {
+      return Error("Failed to parse /proc/schedstat line '" + line.str() + "'");
+    }
+
+    stat.runDelay += counters[7];
+    stat.timeslices += counters[8];
+    cpus = true;
+  }
+
+  if (not cpus) {
+    return Error("Could not find any CPU in /proc/schedstat");
+  }
+
+  return stat;
+}
+
+Try<CpuFreq> com::blue_yonder::os::cpufreq() {
+  std::string const root = "/sys/devices/system/cpu";
+
+  std::ifstream online{root + "/online"};
+  std::string list;
+  if (!std::getline(online, list)) {
+    return Error("Failed to read " + root + "/online");
+  }
+  auto const cpus = parseCpuList(list);
+  if (cpus.isError()) {
+    return Error("Failed to parse " + root + "/online: " + cpus.error());
+  }
+
+  if (cpus.get().empty()) {
+    return Error("Found no online CPU in " + root);
+  }
+
+  CpuFreq freq{0, 0, 0};
+  bool nominalKnown = true;
+  for (auto const cpu : cpus.get()) {
+    auto const path = root + "/cpu" + std::to_string(cpu);
+
+    auto const current = readUint(path + "/cpufreq/scaling_cur_freq");
+    if (current.isNone()) {
+      return Error("Failed to read " + path + "/cpufreq/scaling_cur_freq");
+    }
+    auto const nominal = readUint(path + "/cpufreq/base_frequency");
+    nominalKnown = nominalKnown && nominal.isSome();
+
+    freq.current += current.get();
+    freq.nominal += nominal.getOrElse(0);
+    freq.throttleEvents +=
+      readUint(path + "/thermal_throttle/core_throttle_count").getOrElse(0) +
+      readUint(path + "/thermal_throttle/package_throttle_count").getOrElse(0);
+  }
+
+  if (!nominalKnown) {
+    freq.nominal = 0;
+  }
+
+  return freq;
+}
+
+Try<std::vector<size_t>> com::blue_yonder::os::parseCpuList(std::string const& list) {
+  std::vector<size_t> cpus;
+  for (auto const& range : strings::tokenize(strings::trim(list), ",")) {
+    auto const bounds = strings::split(range, "-");
+    auto const first = numify<size_t>(bounds[0]);
+    auto const last = numify<size_t>(bounds.size() == 2 ? bounds[1] : bounds[0]);
+    if (bounds.size() > 2 || first.isError() || last.isError() || first.get() > last.get()) {
+      return Error("Invalid CPU range '" + range + "'");
+    }
+    for (size_t cpu = first.get(); cpu <= last.get(); ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
@@ -1,6 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
 #include <stout/bytes.hpp>
+#include <stout/try.hpp>
+
+#include "proc_parser.hpp"
 
 namespace com {
 namespace blue_yonder {
@@ -14,6 +22,104 @@ struct MemInfo
 
 Try<MemInfo> meminfo();
 
+/*
+ * Cumulative reclaim and swap counters from /proc/vmstat. Counters split up
+ * per zone or reclaim context are summed up.
+ */
+struct VmStat
+{
+  double timestamp; // seconds on a monotonic clock
+  uint64_t pgscanDirect; // pages scanned by direct reclaim
+  uint64_t pgsteal; // pages reclaimed by kswapd and direct reclaim
+  uint64_t allocstall; // allocations that entered direct reclaim
+  uint64_t pswpin;
+  uint64_t pswpout;
+};
+
+Try<VmStat> vmstat();
+
+/*
+ * Cumulative I/O counters of a block device from /proc/diskstats.
+ */
+struct DiskCounters
+{
+  uint64_t ioTicks; // milliseconds spent doing I/O
+  uint64_t timeInQueue; // milliseconds spent doing I/O, weighted by the requests in flight
+};
+
+struct DiskStats
+{
+  double timestamp; // seconds on a monotonic clock
+  std::map<std::string, DiskCounters> devices;
+};
+
+Try<DiskStats> diskstats();
+
+/*
+ * Cumulative traffic counters of a network interface from /proc/net/dev
+ * along with its link speed from /sys/class/net/<interface>/speed.
+ */
+struct InterfaceCounters
+{
+  uint64_t rxBytes;
+  uint64_t txBytes;
+  uint64_t speed; // in Mbit/s, 0 if unknown (e.g. loopback, virtual or down)
+};
+
+struct NetDev
+{
+  double timestamp; // seconds on a monotonic clock
+  std::map<std::string, InterfaceCounters> interfaces;
+};
+
+Try<NetDev> netdev();
+
+/*
+ * Cumulative run queue statistics from /proc/schedstat, summed up over all
+ * CPUs. Only versions 15 to 17 of its format are supported, whose CPU lines
+ * are the same.
+ */
+struct SchedStat
+{
+  uint64_t runDelay; // nanoseconds tasks spent waiting on a run queue
+  uint64_t timeslices; // run on any CPU
+};
+
+Try<SchedStat> schedstat();
+
+/*
+ * Frequencies and thermal throttling counters of all online CPUs from
+ * /sys/devices/system/cpu. The nominal frequency of a CPU is its
+ * `base_frequency`. It is 0 if any CPU does not report one: `cpuinfo_max_freq`
+ * is the turbo frequency on most drivers and would make a CPU running at its
+ * base frequency look slowed down. Throttling counters are 0 if the kernel
+ * does not provide them, e.g. on AMD CPUs or in virtual machines.
+ */
+struct CpuFreq
+{
+  uint64_t current; // kHz, summed up over all CPUs
+  uint64_t nominal; // kHz, summed up over all CPUs, 0 if unknown
+  uint64_t throttleEvents; // core and package throttling, summed up over all CPUs
+};
+
+Try<CpuFreq> cpufreq();
+
+/*
+ * Parse the content of the respective files. The link speeds of the network
+ * interfaces are left at 0. Exposed for testing and benchmarking.
+ */
+Try<MemInfo> parseMeminfo(proc::View const& content);
+Try<VmStat> parseVmStat(proc::View const& content, double timestamp);
+Try<DiskStats> parseDiskStats(proc::View const& content, double timestamp);
+Try<NetDev> parseNetDev(proc::View const& content, double timestamp);
+Try<SchedStat> parseSchedStat(proc::View const& content);
+
+/*
+ * Parses a CPU list such as /sys/devices/system/cpu/online, e.g. `0-3,8,10-11`.
+ * Exposed for testing.
+ */
+Try<std::vector<size_t>> parseCpuList(std::string const& list);
+
 } // os {
 } // blue_yonder {
 } // com {
@@ -0,0 +1,121 @@
+#include "policy.hpp"
+
+#include "checkpoint.hpp"
+#include "decision_trace.hpp"
+#include "samplers.hpp"
+
+using com::blue_yonder::Configuration;
+using com::blue_yonder::DecisionRecord;
+using com::blue_yonder::HostSample;
+using com::blue_yonder::Overloads;
+using com::blue_yonder::Signals;
+using com::blue_yonder::SignalState;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+
+namespace rules = com::blue_yonder::rules;
+namespace threshold = com::blue_yonder::threshold;
+
+static_assert(
+  com::blue_yonder::IsSignal<threshold::ReclaimSignal>::value &&
+  com::blue_yonder::IsSignal<threshold::DiskSignal>::value &&
+  com::blue_yonder::IsSignal<threshold::NetworkSignal>::value &&
+  com::blue_yonder::IsSignal<threshold::RunQueueSignal>::value &&
+  com::blue_yonder::IsSignal<threshold::FrequencySignal>::value,
+  "The signal state can only checkpoint signals");
+
+
+Signals SignalState::update(
+    HostSample const& sample,
+    Option<double> const& throttling,
+    Configuration const& config)
+{
+  Signals signals{
+    sample.load, sample.memory, None(), throttling, None(), None(), None(), None()};
+  if (sample.vmstat.isSome()) {
+    signals.reclaim = reclaim.update(sample.vmstat.get());
+  }
+  if (sample.diskstats.isSome()) {
+    signals.disk = disk.update(sample.diskstats.get(), config.ioDevices);
+  }
+  if (sample.netdev.isSome()) {
+    signals.network = network.update(sample.netdev.get(), config.netInterfaces);
+  }
+  if (sample.schedstat.isSome()) {
+    signals.runQueueDelay = runQueue.update(sample.schedstat.get());
+  }
+  if (sample.cpufreq.isSome()) {
+    signals.frequency = frequency.update(sample.cpufreq.get());
+  }
+  return signals;
+}
+
+void SignalState::save(StateWriter& writer) const {
+  reclaim.save(writer);
+  disk.save(writer);
+  network.save(writer);
+  runQueue.save(writer);
+  frequency.save(writer);
+}
+
+bool SignalState::restore(StateReader& reader) {
+  SignalState restored;
+  if (!restored.reclaim.restore(reader) ||
+      !restored.disk.restore(reader) ||
+      !restored.network.restore(reader) ||
+      !restored.runQueue.restore(reader) ||
+      !restored.frequency.restore(reader)) {
+    return false;
+  }
+  *this = restored;
+  return true;
+}
+
+bool Overloads::any() const {
+  return load || memory || reclaim || throttling || io || network || runQueue || frequency;
+}
+
+Overloads com::blue_yonder::evaluate(Signals const& signals, Configuration const& config) {
+  static_assert(
+    rules::Overload::size * sizeof(bool) == sizeof(Overloads),
+    "Every flag of the overloads needs a rule of the policy");
+  return rules::Overload::evaluate(signals, config);
+}
+
+void com::blue_yonder::annotate(
+    DecisionRecord& record,
+    Signals const& signals,
+    Overloads const& overloads,
+    Configuration const& config)
+{
+  record.flags |= (overloads.load ? DecisionRecord::LOAD_EXCEEDED : 0);
+  record.flags |= (overloads.memory ? DecisionRecord::MEM_EXCEEDED : 0);
+
+  if (signals.reclaim.isSome()) {
+    record.setReclaim(signals.reclaim.get(), config.reclaimThreshold);
+    record.flags |= (overloads.reclaim ? DecisionRecord::RECLAIM_EXCEEDED : 0);
+  }
+
+  record.setThrottling(signals.throttling, config.throttleRatioThreshold);
+  record.flags |= (overloads.throttling ? DecisionRecord::THROTTLING_EXCEEDED : 0);
+
+  if (signals.disk.isSome()) {
+    record.setDisk(signals.disk.get(), config.ioUtilThreshold, config.ioQueueDepthThreshold);
+    record.flags |= (overloads.io ? DecisionRecord::IO_EXCEEDED : 0);
+  }
+
+  if (signals.network.isSome()) {
+    record.setNetwork(signals.network.get(), config.netRxThreshold, config.netTxThreshold);
+    record.flags |= (overloads.network ? DecisionRecord::NET_EXCEEDED : 0);
+  }
+
+  if (signals.runQueueDelay.isSome()) {
+    record.setRunQueue(signals.runQueueDelay.get(), config.runQueueDelayThreshold);
+    record.flags |= (overloads.runQueue ? DecisionRecord::RUNQUEUE_EXCEEDED : 0);
+  }
+
+  if (signals.frequency.isSome()) {
+    record.setFrequency(signals.frequency.get(), config.cpuFrequencyThreshold);
+    record.flags |= (overloads.frequency ? DecisionRecord::FREQUENCY_EXCEEDED : 0);
+  }
+}
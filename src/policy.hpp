@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include "config.hpp"
+#include "os.hpp"
+#include "threshold.hpp"
+
+namespace com {
+namespace blue_yonder {
+
+struct DecisionRecord;
+struct HostSample;
+class StateReader;
+class StateWriter;
+
+/*
+ * The signals a single estimation or correction is based on. Stateful
+ * signals are derived once per decision, so that the live and the shadow
+ * policy see the very same values. Optional signals are None if they are not
+ * sampled.
+ */
+struct Signals
+{
+  Try<::os::Load> load;
+  Try<os::MemInfo> memory;
+  Option<Try<Option<threshold::ReclaimRates>>> reclaim;
+  Option<double> throttling; // of non-revocable executors
+  Option<Try<Option<threshold::DiskLoad>>> disk;
+  Option<Try<Option<threshold::NetworkLoad>>> network;
+  Option<Try<Option<double>>> runQueueDelay; // milliseconds per timeslice
+  Option<Try<Option<threshold::CpuFrequency>>> frequency;
+};
+
+/*
+ * Derives the signals of a decision from consecutive host samples. It holds
+ * the state of the stateful signals, so each module needs its own.
+ */
+class SignalState
+{
+public:
+  /*
+   * Devices and interfaces are selected by the given configuration. The
+   * throttling of non-revocable executors is derived from the resource usage
+   * rather than the host sample.
+   */
+  Signals update(
+    HostSample const& sample,
+    Option<double> const& throttling,
+    Configuration const& config);
+
+  // Checkpoints the previous samples, see `Checkpoint`. A failed restore
+  // leaves the state untouched.
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  threshold::ReclaimSignal reclaim;
+  threshold::DiskSignal disk;
+  threshold::NetworkSignal network;
+  threshold::RunQueueSignal runQueue;
+  threshold::FrequencySignal frequency;
+};
+
+// The thresholds of a configuration that are reached.
+struct Overloads
+{
+  bool load;
+  bool memory;
+  bool reclaim;
+  bool throttling;
+  bool io;
+  bool network;
+  bool runQueue;
+  bool frequency;
+
+  bool any() const;
+};
+
+/*
+ * A stateful signal derives its values from consecutive samples, see
+ * `SignalState`. Next to an `update()` taking its sample, its type provides
+ *
+ *   void save(StateWriter&) const;
+ *   bool restore(StateReader&);
+ *
+ * to be checkpointed with the module.
+ */
+template <typename T, typename = void>
+struct IsSignal : std::false_type {};
+
+template <typename T>
+struct IsSignal<T, decltype(
+    void(std::declval<T const&>().save(std::declval<StateWriter&>())),
+    void(static_cast<bool>(std::declval<T&>().restore(std::declval<StateReader&>()))))>
+  : std::true_type {};
+
+/*
+ * Threshold rules decide whether the signals of a decision reach a threshold
+ * of a configuration. A rule is a type with a single static member function
+ *
+ *   static bool reached(Signals const&, Configuration const&);
+ *
+ * Rules that make up a `Policy` also name the flag of the `Overloads` they set
+ *
+ *   static bool& flag(Overloads&);
+ *
+ * Rules are combined at compile time, so that evaluating a policy boils down
+ * to inlined calls of the threshold functions. Optional signals only reach
+ * their thresholds if the configuration samples them, as they may have been
+ * sampled for the shadow policy alone.
+ *
+ * Only the evaluation is generic. A new signal still needs its sample in
+ * `HostSample`, its value in `Signals`, its flag in `Overloads` and its
+ * fields in `DecisionRecord`, and the controller has to choose a victim for
+ * it. Its rule then joins `Overload`, which fails to compile while a flag has
+ * no rule.
+ */
+namespace rules {
+
+template <typename T, typename = void>
+struct IsRule : std::false_type {};
+
+template <typename T>
+struct IsRule<T, decltype(void(static_cast<bool>(
+    T::reached(std::declval<Signals const&>(), std::declval<Configuration const&>()))))>
+  : std::true_type {};
+
+struct Load
+{
+  static bool& flag(Overloads& overloads) { return overloads.load; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return threshold::loadExceedsThreshold(signals.load, config.loadThreshold);
+  }
+};
+
+struct Memory
+{
+  static bool& flag(Overloads& overloads) { return overloads.memory; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return threshold::memExceedsThreshold(signals.memory, config.memThreshold);
+  }
+};
+
+struct Reclaim
+{
+  static bool& flag(Overloads& overloads) { return overloads.reclaim; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return config.samplesVmStat() && signals.reclaim.isSome() &&
+      threshold::reclaimExceedsThreshold(signals.reclaim.get(), config.reclaimThreshold);
+  }
+};
+
+struct Throttling
+{
+  static bool& flag(Overloads& overloads) { return overloads.throttling; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return threshold::throttlingExceedsThreshold(signals.throttling, config.throttleRatioThreshold);
+  }
+};
+
+struct Io
+{
+  static bool& flag(Overloads& overloads) { return overloads.io; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return config.samplesDiskStats() && signals.disk.isSome() &&
+      threshold::diskExceedsThreshold(
+        signals.disk.get(), config.ioUtilThreshold, config.ioQueueDepthThreshold);
+  }
+};
+
+struct Network
+{
+  static bool& flag(Overloads& overloads) { return overloads.network; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return config.samplesNetDev() && signals.network.isSome() &&
+      threshold::networkExceedsThreshold(
+        signals.network.get(), config.netRxThreshold, config.netTxThreshold);
+  }
+};
+
+struct RunQueue
+{
+  static bool& flag(Overloads& overloads) { return overloads.runQueue; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return config.samplesSchedStat() && signals.runQueueDelay.isSome() &&
+      threshold::runQueueDelayExceedsThreshold(
+        signals.runQueueDelay.get(), config.runQueueDelayThreshold);
+  }
+};
+
+struct Frequency
+{
+  static bool& flag(Overloads& overloads) { return overloads.frequency; }
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return config.samplesCpuFreq() && signals.frequency.isSome() &&
+      threshold::frequencyBelowThreshold(signals.frequency.get(), config.cpuFrequencyThreshold);
+  }
+};
+
+// Reached if any of the rules is. Stops at the first one reached.
+template <typename... Rules>
+struct AnyOf;
+
+template <>
+struct AnyOf<>
+{
+  static bool reached(Signals const&, Configuration const&) { return false; }
+};
+
+template <typename Rule, typename... Rules>
+struct AnyOf<Rule, Rules...>
+{
+  static_assert(IsRule<Rule>::value, "A rule needs a static reached(Signals, Configuration)");
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return Rule::reached(signals, config) || AnyOf<Rules...>::reached(signals, config);
+  }
+};
+
+// Reached if all of the rules are. Stops at the first one not reached.
+template <typename... Rules>
+struct AllOf;
+
+template <>
+struct AllOf<>
+{
+  static bool reached(Signals const&, Configuration const&) { return true; }
+};
+
+template <typename Rule, typename... Rules>
+struct AllOf<Rule, Rules...>
+{
+  static_assert(IsRule<Rule>::value, "A rule needs a static reached(Signals, Configuration)");
+
+  static bool reached(Signals const& signals, Configuration const& config) {
+    return Rule::reached(signals, config) && AllOf<Rules...>::reached(signals, config);
+  }
+};
+
+/*
+ * A policy is reached if any of its rules is, like `AnyOf`. Evaluating it
+ * sets the flag of each of its rules, leaving the flags of other rules unset.
+ */
+template <typename... Rules>
+struct Policy : AnyOf<Rules...>
+{
+  static constexpr size_t size = sizeof...(Rules);
+
+  // The policy with further rules
+  template <typename... More>
+  using With = Policy<Rules..., More...>;
+
+  static Overloads evaluate(Signals const& signals, Configuration const& config) {
+    Overloads overloads{};
+    set<Rules...>(overloads, signals, config);
+    return overloads;
+  }
+
+private:
+  template <typename... Empty>
+  static typename std::enable_if<sizeof...(Empty) == 0>::type set(
+    Overloads&, Signals const&, Configuration const&) {}
+
+  template <typename Rule, typename... Rest>
+  static void set(Overloads& overloads, Signals const& signals, Configuration const& config) {
+    Rule::flag(overloads) = Rule::reached(signals, config);
+    set<Rest...>(overloads, signals, config);
+  }
+};
+
+// The thresholds on the state of the host, i.e. all but the throttling of
+// executors which depends on the resource usage
+typedef Policy<Load, Memory, Reclaim, Io, Network, RunQueue, Frequency> HostOverload;
+
+// Any reached threshold stops the offers of revocable resources. Both modules
+// evaluate it for the live and the shadow policy.
+typedef HostOverload::With<Throttling> Overload;
+
+} // namespace rules {
+
+// Evaluates `rules::Overload`, i.e. every threshold of the configuration.
+Overloads evaluate(Signals const& signals, Configuration const& config);
+
+/*
+ * Adds the given signals, their thresholds and which of them are reached to
+ * the record of a decision.
+ */
+void annotate(
+  DecisionRecord& record,
+  Signals const& signals,
+  Overloads const& overloads,
+  Configuration const& config);
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -0,0 +1,169 @@
+#include "proc_parser.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <stout/error.hpp>
+
+namespace com {
+namespace blue_yonder {
+namespace proc {
+
+namespace detail {
+
+char const* findNewlineScalar(char const* begin, char const* end) {
+  for (char const* current = begin; current != end; ++current) {
+    if (*current == '\n') {
+      return current;
+    }
+  }
+  return end;
+}
+
+#if defined(__x86_64__)
+
+// SSE2 is part of the x86-64 baseline, so it needs no runtime check.
+char const* findNewlineSse2(char const* begin, char const* end) {
+  __m128i const newline = _mm_set1_epi8('\n');
+  char const* current = begin;
+  for (; end - current >= 16; current += 16) {
+    __m128i const chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(current));
+    int const mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+    if (mask != 0) {
+      return current + __builtin_ctz(mask);
+    }
+  }
+  return findNewlineScalar(current, end);
+}
+
+__attribute__((target("avx2")))
+char const* findNewlineAvx2(char const* begin, char const* end) {
+  __m256i const newline = _mm256_set1_epi8('\n');
+  char const* current = begin;
+  for (; end - current >= 32; current += 32) {
+    __m256i const chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(current));
+    unsigned const mask =
+      static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+    if (mask != 0) {
+      return current + __builtin_ctz(mask);
+    }
+  }
+  return findNewlineSse2(current, end);
+}
+
+bool supportsAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+} // namespace detail {
+
+
+namespace {
+
+typedef char const* (*FindNewline)(char const*, char const*);
+
+FindNewline selectFindNewline() {
+#if defined(__x86_64__)
+  return detail::supportsAvx2() ? detail::findNewlineAvx2 : detail::findNewlineSse2;
+#else
+  return detail::findNewlineScalar;
+#endif
+}
+
+} // namespace {
+
+
+char const* findNewline(char const* begin, char const* end) {
+  static FindNewline const implementation = selectFindNewline();
+  return implementation(begin, end);
+}
+
+bool parseUint(View const& field, uint64_t& value) {
+  if (field.empty()) {
+    return false;
+  }
+
+  // Up to 19 digits always fit into 64 bits, only longer numbers need to be
+  // checked for overflow.
+  uint64_t result = 0;
+  size_t const unchecked = std::min<size_t>(field.size, 19);
+  for (size_t i = 0; i < unchecked; ++i) {
+    unsigned const digit = static_cast<unsigned char>(field.data[i]) - '0';
+    if (digit > 9) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  for (size_t i = unchecked; i < field.size; ++i) {
+    unsigned const digit = static_cast<unsigned char>(field.data[i]) - '0';
+    if (digit > 9 || result > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+
+  value = result;
+  return true;
+}
+
+
+ProcFile::ProcFile(std::string const& path)
+  : location{path},
+    fd{-1},
+    buffer(4096)
+{}
+
+ProcFile::~ProcFile() {
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+Try<View> ProcFile::read() {
+  if (fd < 0) {
+    fd = ::open(location.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return ErrnoError("Failed to open " + location);
+    }
+  }
+
+  // Files in /proc are generated on each read from offset 0. We grow the
+  // buffer until it fits the whole content.
+  size_t size = 0;
+  while (true) {
+    if (size == buffer.size()) {
+      buffer.resize(2 * buffer.size());
+    }
+    ssize_t const length = ::pread(fd, buffer.data() + size, buffer.size() - size, size);
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      auto const error = ErrnoError("Failed to read " + location);
+      ::close(fd);
+      fd = -1;
+      return error;
+    }
+    if (length == 0) {
+      break;
+    }
+    size += static_cast<size_t>(length);
+  }
+
+  return View(buffer.data(), size);
+}
+
+} // namespace proc {
+} // namespace blue_yonder {
+} // namespace com {
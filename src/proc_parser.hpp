@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <stout/try.hpp>
+
+namespace com {
+namespace blue_yonder {
+namespace proc {
+
+/*
+ * A non-owning view of characters, e.g. of a line or a field of a file read
+ * by `ProcFile`. It is only valid until the file is read again.
+ */
+struct View
+{
+  View() : data{nullptr}, size{0} {}
+  View(char const* data, size_t size) : data{data}, size{size} {}
+  explicit View(std::string const& value) : data{value.data()}, size{value.size()} {}
+
+  bool empty() const { return size == 0; }
+
+  bool operator==(char const* literal) const {
+    return strlen(literal) == size && memcmp(data, literal, size) == 0;
+  }
+
+  bool operator!=(char const* literal) const { return !(*this == literal); }
+
+  bool startsWith(char const* prefix) const {
+    auto const length = strlen(prefix);
+    return length <= size && memcmp(data, prefix, length) == 0;
+  }
+
+  std::string str() const { return std::string(data, size); }
+
+  char const* data;
+  size_t size;
+};
+
+/*
+ * Returns the first newline in [begin, end), or `end` if there is none.
+ *
+ * Uses AVX2 or SSE2 on x86-64, depending on the CPU, and a scalar loop
+ * elsewhere.
+ */
+char const* findNewline(char const* begin, char const* end);
+
+/*
+ * Parses a decimal unsigned integer. Fails on empty fields, any character
+ * other than a digit, and on overflow.
+ */
+bool parseUint(View const& field, uint64_t& value);
+
+/*
+ * Splits the content of a file into lines. The newlines are not part of the
+ * lines, and there is no empty line after a trailing newline.
+ */
+class Lines
+{
+public:
+  explicit Lines(View const& content)
+    : current{content.data}, end{content.data + content.size} {}
+
+  bool next(View& line) {
+    if (current == end) {
+      return false;
+    }
+    char const* const newline = findNewline(current, end);
+    line = View(current, newline - current);
+    current = newline == end ? end : newline + 1;
+    return true;
+  }
+
+private:
+  char const* current;
+  char const* end;
+};
+
+/*
+ * Splits a line into fields separated by any number of spaces and tabs.
+ *
+ * Fields in /proc are short, so a scalar loop beats setting up vector
+ * registers for them.
+ */
+class Fields
+{
+public:
+  explicit Fields(View const& line)
+    : current{line.data}, end{line.data + line.size} {}
+
+  bool next(View& field) {
+    while (current != end && isBlank(*current)) {
+      ++current;
+    }
+    if (current == end) {
+      return false;
+    }
+    char const* const start = current;
+    while (current != end && !isBlank(*current)) {
+      ++current;
+    }
+    field = View(start, current - start);
+    return true;
+  }
+
+  // Skips the given number of fields. Returns false if there are fewer.
+  bool skip(size_t count) {
+    View ignored;
+    for (size_t i = 0; i < count; ++i) {
+      if (!next(ignored)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  static bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+  char const* current;
+  char const* end;
+};
+
+/*
+ * A file in /proc that is read repeatedly. The file stays open and its
+ * content is read into a buffer that is reused across reads, so that
+ * sampling neither allocates nor opens the file once the buffer has grown
+ * to fit the content.
+ *
+ * A `ProcFile` must only be used by a single thread at a time.
+ */
+class ProcFile
+{
+public:
+  explicit ProcFile(std::string const& path);
+  ~ProcFile();
+
+  /*
+   * Returns the current content of the file. The view is valid until the
+   * next read.
+   */
+  Try<View> read();
+
+  std::string const& path() const { return location; }
+
+private:
+  ProcFile(ProcFile const&) = delete;
+  ProcFile& operator=(ProcFile const&) = delete;
+
+  std::string const location;
+  int fd;
+  std::vector<char> buffer;
+};
+
+// The individual implementations of `findNewline`, exposed for testing
+namespace detail {
+
+char const* findNewlineScalar(char const* begin, char const* end);
+
+#if defined(__x86_64__)
+char const* findNewlineSse2(char const* begin, char const* end);
+char const* findNewlineAvx2(char const* begin, char const* end);
+bool supportsAvx2();
+#endif
+
+} // namespace detail {
+
+} // namespace proc {
+} // namespace blue_yonder {
+} // namespace com {
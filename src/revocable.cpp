@@ -0,0 +1,61 @@
+#include "revocable.hpp"
+
+#include <algorithm>
+
+#include <stout/numify.hpp>
+
+using mesos::Resource;
+using mesos::ResourceUsage;
+
+namespace com {
+namespace blue_yonder {
+
+bool isRevocable(ResourceUsage::Executor const& executor) {
+  return std::any_of(
+    executor.allocated().begin(),
+    executor.allocated().end(),
+    [](Resource const& resource) { return resource.has_revocable(); });
+}
+
+void RevocableExecutors::update(ResourceUsage const& usage) {
+  revocable.clear();
+  allocatedRevocable = mesos::Resources();
+
+  for (auto const& executor : usage.executors()) {
+    if (!isRevocable(executor)) {
+      continue;
+    }
+    revocable.push_back(&executor);
+    for (auto const& resource : executor.allocated()) {
+      if (resource.has_revocable()) {
+        allocatedRevocable += resource;
+      }
+    }
+  }
+  allocatedRevocable.unallocate();
+}
+
+ResourceUsage::Executor const* mostGreedyRevocable(RevocableExecutors const& executors) {
+  ResourceUsage::Executor const* greediest = nullptr;
+  for (auto const* executor : executors.executors()) {
+    if (greediest == nullptr ||
+        executor->statistics().mem_total_bytes() > greediest->statistics().mem_total_bytes()) {
+      greediest = executor;
+    }
+  }
+  return greediest;
+}
+
+double priorityOf(mesos::ExecutorInfo const& executor, std::string const& label) {
+  for (auto const& candidate : executor.labels().labels()) {
+    if (candidate.key() != label || !candidate.has_value()) {
+      continue;
+    }
+    auto const priority = numify<double>(candidate.value());
+    return priority.isSome() && priority.get() >= 0 ? priority.get() : 0;
+  }
+  return 0;
+}
+
+} // namespace blue_yonder {
+} // namespace com {
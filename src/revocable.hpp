@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <stout/option.hpp>
+
+#include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
+
+namespace com {
+namespace blue_yonder {
+
+// Returns true if any of the resources allocated to the executor is revocable.
+bool isRevocable(mesos::ResourceUsage::Executor const& executor);
+
+/*
+ * The revocable executors of a resource usage snapshot.
+ *
+ * Estimator and controller classify the executors once per snapshot rather
+ * than converting their allocations to `Resources` whenever they need to
+ * know. The executor buffer is reused across snapshots. Summing up the
+ * allocations only allocates per kind of resource, regardless of the number
+ * of executors.
+ *
+ * The executors point into the snapshot passed to `update`, which must
+ * outlive any use of them.
+ */
+class RevocableExecutors
+{
+public:
+  void update(mesos::ResourceUsage const& usage);
+
+  // In the order of the snapshot
+  std::vector<mesos::ResourceUsage::Executor const*> const& executors() const {
+    return revocable;
+  }
+
+  // The sum of all revocable resources allocated, without allocation info
+  mesos::Resources const& allocated() const { return allocatedRevocable; }
+
+private:
+  std::vector<mesos::ResourceUsage::Executor const*> revocable;
+  mesos::Resources allocatedRevocable;
+};
+
+// Returns the revocable executor using the most memory, or nullptr if there is none.
+mesos::ResourceUsage::Executor const* mostGreedyRevocable(RevocableExecutors const& executors);
+
+/*
+ * Returns the revocable executor with the highest usage of some resource, or
+ * nullptr if there is none. Executors without a usage yet are only chosen if
+ * there is no other one.
+ */
+template <typename UsageOf>
+mesos::ResourceUsage::Executor const* heaviestRevocable(
+    RevocableExecutors const& executors,
+    UsageOf const& usageOf)
+{
+  mesos::ResourceUsage::Executor const* heaviest = nullptr;
+  double heaviestUsage = -1;
+  for (auto const* executor : executors.executors()) {
+    Option<double> const usage = usageOf(executor->executor_info());
+    double const used = usage.getOrElse(0);
+    if (used > heaviestUsage) {
+      heaviest = executor;
+      heaviestUsage = used;
+    }
+  }
+  return heaviest;
+}
+
+/*
+ * Returns the revocable executor whose memory usage grows the most, weighted
+ * by its size, or nullptr if none of them grows. A large executor with a
+ * stable usage is thus spared in favor of a smaller one that keeps growing.
+ */
+template <typename GrowthOf>
+mesos::ResourceUsage::Executor const* fastestGrowingRevocable(
+    RevocableExecutors const& executors,
+    GrowthOf const& growthOf)
+{
+  mesos::ResourceUsage::Executor const* fastest = nullptr;
+  double fastestScore = 0;
+  for (auto const* executor : executors.executors()) {
+    double const growth = growthOf(executor->executor_info()).getOrElse(0);
+    double const score = growth * executor->statistics().mem_total_bytes();
+    if (growth > 0 && score > fastestScore) {
+      fastest = executor;
+      fastestScore = score;
+    }
+  }
+  return fastest;
+}
+
+/*
+ * Returns the revocable executor whose kill loses the least work among those
+ * that free at least `required` of some resource, or nullptr if none does.
+ * Among kills of the same cost, the one that frees the most is chosen.
+ */
+template <typename FreedBy, typename CostOf>
+mesos::ResourceUsage::Executor const* cheapestRevocable(
+    RevocableExecutors const& executors,
+    double required,
+    FreedBy const& freedBy,
+    CostOf const& costOf)
+{
+  mesos::ResourceUsage::Executor const* cheapest = nullptr;
+  double cheapestCost = 0;
+  double cheapestFreed = 0;
+  for (auto const* executor : executors.executors()) {
+    double const freed = freedBy(*executor);
+    if (freed <= 0 || freed < required) {
+      continue;
+    }
+    double const cost = costOf(*executor);
+    if (cheapest == nullptr || cost < cheapestCost ||
+        (cost == cheapestCost && freed > cheapestFreed)) {
+      cheapest = executor;
+      cheapestCost = cost;
+      cheapestFreed = freed;
+    }
+  }
+  return cheapest;
+}
+
+/*
+ * Returns the most any revocable executor would free of some resource, or 0
+ * if there is none.
+ */
+template <typename FreedBy>
+double mostFreed(RevocableExecutors const& executors, FreedBy const& freedBy) {
+  double most = 0;
+  for (auto const* executor : executors.executors()) {
+    most = std::max(most, freedBy(*executor));
+  }
+  return most;
+}
+
+/*
+ * Returns the priority given in the label of the executor with the given
+ * key, or 0 if there is no such label or its value is not a non-negative
+ * number.
+ */
+double priorityOf(mesos::ExecutorInfo const& executor, std::string const& label);
+
+// Returns the first revocable executor of the snapshot, or nullptr if there is none.
+inline mesos::ResourceUsage::Executor const* firstRevocable(RevocableExecutors const& executors) {
+  return executors.executors().empty() ? nullptr : executors.executors().front();
+}
+
+} // namespace blue_yonder {
+} // namespace com {
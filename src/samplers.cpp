@@ -0,0 +1,88 @@
+#include "samplers.hpp"
+
+#include <stout/stringify.hpp>
+
+#include "config.hpp"
+#include "io_thread.hpp"
+
+using process::Future;
+
+using com::blue_yonder::Configuration;
+using com::blue_yonder::HostSample;
+using com::blue_yonder::Samplers;
+
+
+namespace {
+
+// Whether the live or the shadow policy needs the signal
+bool samples(Configuration const& config, bool (Configuration::*signal)() const) {
+  return (config.*signal)() || (config.shadow.get() != nullptr && (*config.shadow.*signal)());
+}
+
+} // namespace {
+
+
+Samplers::Samplers()
+  : Samplers(::os::loadavg, os::meminfo)
+{}
+
+Samplers::Samplers(
+    std::function<Try<::os::Load>()> const& load,
+    std::function<Try<os::MemInfo>()> const& memory)
+  : load{load},
+    memory{memory},
+    vmstat{os::vmstat},
+    diskstats{os::diskstats},
+    netdev{os::netdev},
+    schedstat{os::schedstat},
+    cpufreq{os::cpufreq}
+{}
+
+HostSample com::blue_yonder::sampleHost(Samplers const& samplers, Configuration const& config) {
+  return HostSample{
+    samplers.load(),
+    samplers.memory(),
+    samples(config, &Configuration::samplesVmStat)
+      ? Option<Try<os::VmStat>>(samplers.vmstat()) : None(),
+    samples(config, &Configuration::samplesDiskStats)
+      ? Option<Try<os::DiskStats>>(samplers.diskstats()) : None(),
+    samples(config, &Configuration::samplesNetDev)
+      ? Option<Try<os::NetDev>>(samplers.netdev()) : None(),
+    samples(config, &Configuration::samplesSchedStat)
+      ? Option<Try<os::SchedStat>>(samplers.schedstat()) : None(),
+    samples(config, &Configuration::samplesCpuFreq)
+      ? Option<Try<os::CpuFreq>>(samplers.cpufreq()) : None(),
+    false};
+}
+
+HostSample com::blue_yonder::failedSample(Configuration const& config, std::string const& error) {
+  return HostSample{
+    Error(error),
+    Error(error),
+    samples(config, &Configuration::samplesVmStat)
+      ? Option<Try<os::VmStat>>(Error(error)) : None(),
+    samples(config, &Configuration::samplesDiskStats)
+      ? Option<Try<os::DiskStats>>(Error(error)) : None(),
+    samples(config, &Configuration::samplesNetDev)
+      ? Option<Try<os::NetDev>>(Error(error)) : None(),
+    samples(config, &Configuration::samplesSchedStat)
+      ? Option<Try<os::SchedStat>>(Error(error)) : None(),
+    samples(config, &Configuration::samplesCpuFreq)
+      ? Option<Try<os::CpuFreq>>(Error(error)) : None(),
+    true};
+}
+
+Future<HostSample> com::blue_yonder::sampleHost(
+    IOThread& io,
+    Samplers const& samplers,
+    Configuration const& config)
+{
+  auto const timeout = config.sampleTimeout;
+  return io.run<HostSample>([samplers, config]() { return sampleHost(samplers, config); })
+    .after(timeout, [config, timeout](Future<HostSample> const&) {
+      return Future<HostSample>(failedSample(config, "Timed out after " + stringify(timeout)));
+    })
+    .repair([config](Future<HostSample> const& failed) {
+      return Future<HostSample>(failedSample(config, failed.failure()));
+    });
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include <process/future.hpp>
+
+#include "os.hpp"
+
+namespace com {
+namespace blue_yonder {
+
+struct Configuration;
+class IOThread;
+
+/*
+ * The functions used by the modules to sample the host. They are invoked on
+ * the I/O thread. Tests and the replay tool substitute them with fakes.
+ */
+struct Samplers
+{
+  // Samples the actual host
+  Samplers();
+
+  // Substitutes load and memory, all other signals sample the actual host
+  Samplers(
+    std::function<Try<::os::Load>()> const& load,
+    std::function<Try<os::MemInfo>()> const& memory);
+
+  std::function<Try<::os::Load>()> load;
+  std::function<Try<os::MemInfo>()> memory;
+  std::function<Try<os::VmStat>()> vmstat;
+  std::function<Try<os::DiskStats>()> diskstats;
+  std::function<Try<os::NetDev>()> netdev;
+  std::function<Try<os::SchedStat>()> schedstat;
+  std::function<Try<os::CpuFreq>()> cpufreq;
+};
+
+/*
+ * A single sample of all signals of interest. Optional signals are None if
+ * none of their thresholds has been configured.
+ */
+struct HostSample
+{
+  Try<::os::Load> load;
+  Try<os::MemInfo> memory;
+  Option<Try<os::VmStat>> vmstat;
+  Option<Try<os::DiskStats>> diskstats;
+  Option<Try<os::NetDev>> netdev;
+  Option<Try<os::SchedStat>> schedstat;
+  Option<Try<os::CpuFreq>> cpufreq;
+
+  // Whether the host could not be sampled at all, see `failedSample`. False
+  // if omitted from an aggregate initialization.
+  bool incomplete;
+};
+
+/*
+ * Samples all signals required by the given configuration. This is blocking
+ * I/O and must be done on the I/O thread.
+ */
+HostSample sampleHost(Samplers const& samplers, Configuration const& config);
+
+/*
+ * An incomplete sample in which every signal required by the given
+ * configuration failed with the given error. Decisions are taken on it if
+ * sampling the host did not complete in time or was rejected by the I/O
+ * thread. Unlike a failed read of a single signal, this says nothing about
+ * the host, so the controller does not kill on it.
+ */
+HostSample failedSample(Configuration const& config, std::string const& error);
+
+/*
+ * Samples the host on the given I/O thread. If that fails or does not
+ * complete within the sample timeout of the configuration, the sample is
+ * taken as failed, so that the decision is not held up by a hanging read.
+ */
+process::Future<HostSample> sampleHost(
+  IOThread& io,
+  Samplers const& samplers,
+  Configuration const& config);
+
+} // namespace blue_yonder {
+} // namespace com {
@@ -1,9 +1,13 @@
 #include "threshold.hpp"
 
+#include <algorithm>
+
 #include <stout/os.hpp>
+#include <stout/strings.hpp>
 
 #include <glog/logging.h>
 
+#include "checkpoint.hpp"
 #include "os.hpp"
 
 
@@ -12,15 +16,13 @@ namespace blue_yonder {
 namespace threshold {
 
 /*
- * Returns true if the current memory usage (not including buffers and caches)
+ * Returns true if the sampled memory usage (not including buffers and caches)
  * exceeds the given threshold.
  */
 bool memExceedsThreshold(
-    std::function<Try<os::MemInfo>()> const& memory,
+    Try<os::MemInfo> const& memoryInfo,
     Bytes const& memThreshold)
 {
-  auto const memoryInfo = memory();
-
   if (memoryInfo.isError()) {
     LOG(ERROR) << "Failed to fetch memory information: " << memoryInfo.error()
                << ". Assuming memory threshold to be exceeded";
@@ -38,7 +40,7 @@ bool memExceedsThreshold(
 }
 
 /*
- * Returns true if the current load has reached one of the given thresholds.
+ * Returns true if the sampled load has reached one of the given thresholds.
  *
  * We only consider the 15m load threshold to be reached if also the respective
  * shorter load intervals have reached the same threshold. This ensures that we
@@ -48,11 +50,9 @@ bool memExceedsThreshold(
  * threshold.
  */
 bool loadExceedsThreshold(
-    std::function<Try<::os::Load>()> const& load,
+    Try<::os::Load> const& currentLoad,
     ::os::Load const& threshold)
 {
-  Try<::os::Load> const currentLoad = load();
-
   if (currentLoad.isError()) {
     LOG(ERROR) << "Failed to fetch system load: " + currentLoad.error()
                << ". Assuming load thresholds to be exceeded";
@@ -82,6 +82,489 @@ bool loadExceedsThreshold(
   return false;
 }
 
+namespace {
+
+// Counters only reset on reboot. Should they do anyway, we assume no activity.
+double rate(uint64_t previous, uint64_t current, double seconds) {
+  return current > previous ? (current - previous) / seconds : 0;
+}
+
+} // namespace {
+
+/*
+ * Returns the reclaim and swap rates between two samples of /proc/vmstat, or
+ * None if no time has passed between them.
+ */
+Option<ReclaimRates> reclaimRates(os::VmStat const& previous, os::VmStat const& current) {
+  double const seconds = current.timestamp - previous.timestamp;
+  if (seconds <= 0) {
+    return None();
+  }
+
+  return ReclaimRates{
+    rate(previous.pgscanDirect, current.pgscanDirect, seconds),
+    rate(previous.pgsteal, current.pgsteal, seconds),
+    rate(previous.allocstall, current.allocstall, seconds),
+    rate(previous.pswpin + previous.pswpout, current.pswpin + current.pswpout, seconds)};
+}
+
+Try<Option<ReclaimRates>> ReclaimSignal::update(Try<os::VmStat> const& sample) {
+  if (sample.isError()) {
+    previous = None();
+    return Error(sample.error());
+  }
+
+  Option<ReclaimRates> rates = None();
+  if (previous.isSome()) {
+    rates = reclaimRates(previous.get(), sample.get());
+  }
+  previous = sample.get();
+  return rates;
+}
+
+void ReclaimSignal::save(StateWriter& writer) const {
+  writer.write(previous);
+}
+
+bool ReclaimSignal::restore(StateReader& reader) {
+  Option<os::VmStat> restored;
+  if (!reader.read(restored)) {
+    return false;
+  }
+  previous = restored;
+  return true;
+}
+
+/*
+ * Returns true if the reclaim or swap activity since the previous sample has
+ * reached one of the given thresholds.
+ *
+ * Direct reclaim and swapping stall the allocating tasks. They typically set
+ * in well before the available memory reaches the memory threshold, e.g. if
+ * the page cache of production tasks is thrashed.
+ */
+bool reclaimExceedsThreshold(
+    Try<Option<ReclaimRates>> const& rates,
+    ReclaimRates const& threshold)
+{
+  if (rates.isError()) {
+    LOG(ERROR) << "Failed to fetch reclaim statistics: " << rates.error()
+               << ". Assuming reclaim thresholds to be exceeded";
+    return true;
+  }
+
+  // We need two samples to compute rates
+  if (rates.get().isNone()) {
+    return false;
+  }
+  auto const& current = rates.get().get();
+
+  if (current.pgscanDirect >= threshold.pgscanDirect) {
+    LOG(INFO) << "Direct page scan rate " << current.pgscanDirect
+              << " reached threshold " << threshold.pgscanDirect;
+    return true;
+  }
+  if (current.pgsteal >= threshold.pgsteal) {
+    LOG(INFO) << "Page steal rate " << current.pgsteal
+              << " reached threshold " << threshold.pgsteal;
+    return true;
+  }
+  if (current.allocstall >= threshold.allocstall) {
+    LOG(INFO) << "Allocation stall rate " << current.allocstall
+              << " reached threshold " << threshold.allocstall;
+    return true;
+  }
+  if (current.swap >= threshold.swap) {
+    LOG(INFO) << "Swap rate " << current.swap
+              << " reached threshold " << threshold.swap;
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Returns true if the fraction of CFS periods in which non-revocable
+ * executors have been throttled has reached the given threshold.
+ *
+ * Revocable tasks run with minimal CPU shares. Yet, they can still keep
+ * production tasks from using their full quota within a CFS period, even if
+ * the load average does not indicate any overload.
+ */
+bool throttlingExceedsThreshold(Option<double> const& throttling, double threshold) {
+  // Without any CFS periods there is nothing to be throttled
+  if (throttling.isNone()) {
+    return false;
+  }
+
+  if (throttling.get() >= threshold) {
+    LOG(INFO) << "Throttling ratio of non-revocable executors " << throttling.get()
+              << " reached threshold " << threshold;
+    return true;
+  }
+  return false;
+}
+
+namespace {
+
+bool selected(std::string const& device, std::set<std::string> const& devices) {
+  if (devices.empty()) {
+    return !strings::startsWith(device, "loop") && !strings::startsWith(device, "ram");
+  }
+  return devices.count(device) > 0;
+}
+
+} // namespace {
+
+Try<Option<DiskLoad>> DiskSignal::update(
+    Try<os::DiskStats> const& sample,
+    std::set<std::string> const& devices)
+{
+  if (sample.isError()) {
+    previous = None();
+    return Error(sample.error());
+  }
+
+  Option<DiskLoad> load = None();
+  if (previous.isSome()) {
+    double const milliseconds = 1000 * (sample.get().timestamp - previous.get().timestamp);
+    if (milliseconds > 0) {
+      DiskLoad busiest{"", 0, 0};
+      for (auto const& device : sample.get().devices) {
+        auto const before = previous.get().devices.find(device.first);
+        if (!selected(device.first, devices) || before == previous.get().devices.end()) {
+          continue;
+        }
+        double const utilization =
+          rate(before->second.ioTicks, device.second.ioTicks, milliseconds);
+        if (utilization > busiest.utilization || busiest.device.empty()) {
+          busiest.device = device.first;
+          busiest.utilization = utilization;
+        }
+        busiest.queueDepth = std::max(
+          busiest.queueDepth,
+          rate(before->second.timeInQueue, device.second.timeInQueue, milliseconds));
+      }
+      if (!busiest.device.empty()) {
+        load = busiest;
+      }
+    }
+  }
+
+  previous = sample.get();
+  return load;
+}
+
+void DiskSignal::save(StateWriter& writer) const {
+  writer.write(previous.isSome());
+  if (previous.isSome()) {
+    writer.write(previous.get().timestamp);
+    writer.write(previous.get().devices);
+  }
+}
+
+bool DiskSignal::restore(StateReader& reader) {
+  bool some;
+  if (!reader.read(some)) {
+    return false;
+  }
+  if (!some) {
+    previous = None();
+    return true;
+  }
+  os::DiskStats restored;
+  if (!reader.read(restored.timestamp) || !reader.read(restored.devices)) {
+    return false;
+  }
+  previous = restored;
+  return true;
+}
+
+/*
+ * Returns true if the utilization or the average queue depth of any of the
+ * sampled block devices has reached the given thresholds.
+ *
+ * Neither load nor memory reliably reflect saturated disks. Tasks waiting
+ * for I/O only count towards the load if they are in uninterruptible sleep.
+ */
+bool diskExceedsThreshold(
+    Try<Option<DiskLoad>> const& load,
+    double utilizationThreshold,
+    double queueDepthThreshold)
+{
+  if (load.isError()) {
+    LOG(ERROR) << "Failed to fetch disk statistics: " << load.error()
+               << ". Assuming I/O thresholds to be exceeded";
+    return true;
+  }
+
+  // We need two samples to compute the load
+  if (load.get().isNone()) {
+    return false;
+  }
+  auto const& current = load.get().get();
+
+  if (current.utilization >= utilizationThreshold) {
+    LOG(INFO) << "Utilization " << current.utilization << " of device " << current.device
+              << " reached threshold " << utilizationThreshold;
+    return true;
+  }
+  if (current.queueDepth >= queueDepthThreshold) {
+    LOG(INFO) << "Average I/O queue depth " << current.queueDepth
+              << " reached threshold " << queueDepthThreshold;
+    return true;
+  }
+  return false;
+}
+
+Try<Option<NetworkLoad>> NetworkSignal::update(
+    Try<os::NetDev> const& sample,
+    std::set<std::string> const& interfaces)
+{
+  if (sample.isError()) {
+    previous = None();
+    return Error(sample.error());
+  }
+
+  Option<NetworkLoad> load = None();
+  if (previous.isSome()) {
+    double const seconds = sample.get().timestamp - previous.get().timestamp;
+    if (seconds > 0) {
+      NetworkLoad busiest{"", 0, 0};
+      double busiestUtilization = -1;
+      for (auto const& interface : sample.get().interfaces) {
+        auto const before = previous.get().interfaces.find(interface.first);
+        if ((!interfaces.empty() && interfaces.count(interface.first) == 0) ||
+            interface.second.speed == 0 ||
+            before == previous.get().interfaces.end()) {
+          continue;
+        }
+        double const bytesPerSecond = interface.second.speed * 1000.0 * 1000.0 / 8;
+        double const rx =
+          rate(before->second.rxBytes, interface.second.rxBytes, seconds) / bytesPerSecond;
+        double const tx =
+          rate(before->second.txBytes, interface.second.txBytes, seconds) / bytesPerSecond;
+        if (std::max(rx, tx) > busiestUtilization) {
+          busiest.interface = interface.first;
+          busiestUtilization = std::max(rx, tx);
+        }
+        busiest.rx = std::max(busiest.rx, rx);
+        busiest.tx = std::max(busiest.tx, tx);
+      }
+      if (!busiest.interface.empty()) {
+        load = busiest;
+      }
+    }
+  }
+
+  previous = sample.get();
+  return load;
+}
+
+void NetworkSignal::save(StateWriter& writer) const {
+  writer.write(previous.isSome());
+  if (previous.isSome()) {
+    writer.write(previous.get().timestamp);
+    writer.write(previous.get().interfaces);
+  }
+}
+
+bool NetworkSignal::restore(StateReader& reader) {
+  bool some;
+  if (!reader.read(some)) {
+    return false;
+  }
+  if (!some) {
+    previous = None();
+    return true;
+  }
+  os::NetDev restored;
+  if (!reader.read(restored.timestamp) || !reader.read(restored.interfaces)) {
+    return false;
+  }
+  previous = restored;
+  return true;
+}
+
+/*
+ * Returns true if the receive or transmit rate of any of the sampled network
+ * interfaces has reached the given fraction of its link speed.
+ *
+ * A saturated link adds latency to production services even though it hardly
+ * shows in load or memory.
+ */
+bool networkExceedsThreshold(
+    Try<Option<NetworkLoad>> const& load,
+    double rxThreshold,
+    double txThreshold)
+{
+  if (load.isError()) {
+    LOG(ERROR) << "Failed to fetch network statistics: " << load.error()
+               << ". Assuming network thresholds to be exceeded";
+    return true;
+  }
+
+  // We need two samples to compute the load
+  if (load.get().isNone()) {
+    return false;
+  }
+  auto const& current = load.get().get();
+
+  if (current.rx >= rxThreshold) {
+    LOG(INFO) << "Network receive utilization " << current.rx
+              << " reached threshold " << rxThreshold;
+    return true;
+  }
+  if (current.tx >= txThreshold) {
+    LOG(INFO) << "Network transmit utilization " << current.tx
+              << " reached threshold " << txThreshold;
+    return true;
+  }
+  return false;
+}
+
+Try<Option<double>> RunQueueSignal::update(Try<os::SchedStat> const& sample) {
+  if (sample.isError()) {
+    previous = None();
+    return Error(sample.error());
+  }
+
+  Option<double> delay = None();
+  if (previous.isSome()) {
+    // Without any timeslices run, nobody had to wait. As with the other
+    // counters, a reset is taken as no activity.
+    auto const& before = previous.get();
+    auto const& after = sample.get();
+    delay = after.timeslices > before.timeslices && after.runDelay > before.runDelay
+      ? (after.runDelay - before.runDelay) / 1000000.0 / (after.timeslices - before.timeslices)
+      : 0.0;
+  }
+  previous = sample.get();
+  return delay;
+}
+
+void RunQueueSignal::save(StateWriter& writer) const {
+  writer.write(previous);
+}
+
+bool RunQueueSignal::restore(StateReader& reader) {
+  Option<os::SchedStat> restored;
+  if (!reader.read(restored)) {
+    return false;
+  }
+  previous = restored;
+  return true;
+}
+
+/*
+ * Returns true if tasks waited on a run queue for the given milliseconds per
+ * timeslice on average since the previous sample.
+ *
+ * The load average counts the runnable tasks, not how long they wait. The
+ * latter is what hurts latency-sensitive production tasks. It rises as soon
+ * as revocable tasks compete for the same CPUs, even with a moderate load.
+ */
+bool runQueueDelayExceedsThreshold(Try<Option<double>> const& delay, double threshold) {
+  if (delay.isError()) {
+    LOG(ERROR) << "Failed to fetch scheduler statistics: " << delay.error()
+               << ". Assuming run queue delay threshold to be exceeded";
+    return true;
+  }
+
+  // We need two samples to compute the delay
+  if (delay.get().isNone()) {
+    return false;
+  }
+
+  if (delay.get().get() >= threshold) {
+    LOG(INFO) << "Average run queue delay of " << delay.get().get()
+              << "ms reached threshold " << threshold << "ms";
+    return true;
+  }
+  return false;
+}
+
+namespace {
+
+Option<double> percentOfNominal(os::CpuFreq const& sample) {
+  if (sample.nominal == 0) {
+    return None();
+  }
+  return 100.0 * sample.current / sample.nominal;
+}
+
+} // namespace {
+
+Try<Option<CpuFrequency>> FrequencySignal::update(Try<os::CpuFreq> const& sample) {
+  if (sample.isError()) {
+    previous = None();
+    return Error(sample.error());
+  }
+
+  Option<CpuFrequency> frequency = None();
+  if (previous.isSome()) {
+    auto const& before = previous.get();
+    auto const& after = sample.get();
+    auto const percentBefore = percentOfNominal(before);
+    auto const percentAfter = percentOfNominal(after);
+    frequency = CpuFrequency{
+      percentBefore.isSome() && percentAfter.isSome()
+        ? Option<double>(std::max(percentBefore.get(), percentAfter.get()))
+        : None(),
+      after.throttleEvents > before.throttleEvents
+        ? after.throttleEvents - before.throttleEvents : 0};
+  }
+  previous = sample.get();
+  return frequency;
+}
+
+void FrequencySignal::save(StateWriter& writer) const {
+  writer.write(previous);
+}
+
+bool FrequencySignal::restore(StateReader& reader) {
+  Option<os::CpuFreq> restored;
+  if (!reader.read(restored)) {
+    return false;
+  }
+  previous = restored;
+  return true;
+}
+
+/*
+ * Returns true if the CPUs ran at or below the given percentage of their
+ * nominal frequency in two consecutive samples, or if they have been
+ * thermally throttled since the previous sample. Without a nominal
+ * frequency only the throttling counts.
+ *
+ * Revocable tasks keeping all cores busy lower the turbo frequency of the
+ * whole package and may make it overheat. Production tasks then run slower
+ * while the load average does not change at all.
+ */
+bool frequencyBelowThreshold(Try<Option<CpuFrequency>> const& frequency, double threshold) {
+  if (frequency.isError()) {
+    LOG(ERROR) << "Failed to fetch CPU frequencies: " << frequency.error()
+               << ". Assuming CPU frequency threshold to be reached";
+    return true;
+  }
+
+  // We need two samples to tell a sustained loss from a dip
+  if (frequency.get().isNone()) {
+    return false;
+  }
+  auto const& current = frequency.get().get();
+
+  if (current.percent.isSome() && current.percent.get() <= threshold) {
+    LOG(INFO) << "CPU frequency at " << current.percent.get()
+              << "% of nominal reached threshold " << threshold << "%";
+    return true;
+  }
+  if (current.throttleEvents > 0) {
+    LOG(INFO) << "CPUs have been thermally throttled " << current.throttleEvents << " times";
+    return true;
+  }
+  return false;
+}
+
 } // namespace threshold {
 } // namespace blue_yonder {
 } // namespace com {
@@ -1,20 +1,208 @@
 #pragma once
 
+#include <cstdint>
+#include <set>
+#include <string>
+
 #include <stout/bytes.hpp>
+#include <stout/option.hpp>
 #include <stout/os.hpp>
 
 namespace com {
 namespace blue_yonder {
 
+class StateReader;
+class StateWriter;
+
 namespace os {
 struct MemInfo;
+struct VmStat;
+struct DiskStats;
+struct NetDev;
+struct SchedStat;
+struct CpuFreq;
 }
 
 namespace threshold {
 
-bool memExceedsThreshold(std::function<Try<os::MemInfo>()> const&, Bytes const&);
+bool memExceedsThreshold(Try<os::MemInfo> const&, Bytes const&);
+
+bool loadExceedsThreshold(Try<::os::Load> const&, ::os::Load const&);
+
+/*
+ * Reclaim and swap activity in pages or events per second.
+ */
+struct ReclaimRates
+{
+  double pgscanDirect;
+  double pgsteal;
+  double allocstall;
+  double swap; // pages swapped in and out
+};
+
+Option<ReclaimRates> reclaimRates(os::VmStat const& previous, os::VmStat const& current);
+
+/*
+ * Derives reclaim and swap rates from consecutive samples of /proc/vmstat.
+ */
+class ReclaimSignal
+{
+public:
+  /*
+   * Returns the rates since the previous sample or None if there is no
+   * previous sample to compare with.
+   */
+  Try<Option<ReclaimRates>> update(Try<os::VmStat> const& sample);
+
+  // Checkpoints the previous sample, see `Checkpoint`. A failed restore
+  // leaves the signal untouched.
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  Option<os::VmStat> previous;
+};
+
+bool reclaimExceedsThreshold(Try<Option<ReclaimRates>> const&, ReclaimRates const&);
+
+bool throttlingExceedsThreshold(Option<double> const& throttling, double threshold);
+
+/*
+ * Saturation of the busiest block device.
+ */
+struct DiskLoad
+{
+  std::string device; // with the highest utilization
+  double utilization; // fraction of time spent doing I/O
+  double queueDepth; // average number of requests in flight, of any device
+};
+
+/*
+ * Derives the disk load from consecutive samples of /proc/diskstats.
+ */
+class DiskSignal
+{
+public:
+  /*
+   * Returns the load of the given devices since the previous sample, or of
+   * all but loop and ram devices if none are given. Returns None if there is
+   * no previous sample to compare with.
+   */
+  Try<Option<DiskLoad>> update(
+    Try<os::DiskStats> const& sample,
+    std::set<std::string> const& devices);
+
+  // Checkpointing, like `ReclaimSignal`
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  Option<os::DiskStats> previous;
+};
+
+bool diskExceedsThreshold(
+  Try<Option<DiskLoad>> const& load,
+  double utilizationThreshold,
+  double queueDepthThreshold);
+
+/*
+ * Utilization of the busiest network interfaces as fractions of their link
+ * speed.
+ */
+struct NetworkLoad
+{
+  std::string interface; // with the highest utilization in either direction
+  double rx; // highest receive utilization of any interface
+  double tx; // highest transmit utilization of any interface
+};
+
+/*
+ * Derives the network load from consecutive samples of /proc/net/dev.
+ */
+class NetworkSignal
+{
+public:
+  /*
+   * Returns the load of the given interfaces since the previous sample, or of
+   * all interfaces with a known link speed if none are given. Interfaces
+   * without a known link speed are ignored. Returns None if there is no
+   * previous sample to compare with.
+   */
+  Try<Option<NetworkLoad>> update(
+    Try<os::NetDev> const& sample,
+    std::set<std::string> const& interfaces);
+
+  // Checkpointing, like `ReclaimSignal`
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  Option<os::NetDev> previous;
+};
+
+bool networkExceedsThreshold(
+  Try<Option<NetworkLoad>> const& load,
+  double rxThreshold,
+  double txThreshold);
+
+/*
+ * Derives the average time tasks waited on a run queue before they ran, in
+ * milliseconds per timeslice, from consecutive samples of /proc/schedstat.
+ */
+class RunQueueSignal
+{
+public:
+  /*
+   * Returns the average delay since the previous sample or None if there is
+   * no previous sample to compare with.
+   */
+  Try<Option<double>> update(Try<os::SchedStat> const& sample);
+
+  // Checkpointing, like `ReclaimSignal`
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  Option<os::SchedStat> previous;
+};
+
+bool runQueueDelayExceedsThreshold(Try<Option<double>> const& delay, double threshold);
+
+/*
+ * Frequency of all CPUs relative to their nominal one and the thermal
+ * throttling since the previous sample.
+ */
+struct CpuFrequency
+{
+  // Of the nominal frequency, the higher of the last two samples. None if
+  // the nominal frequency is unknown in either of them.
+  Option<double> percent;
+  uint64_t throttleEvents;
+};
+
+/*
+ * Derives the CPU frequency from consecutive samples of
+ * /sys/devices/system/cpu. A single sample only reflects the frequency at
+ * that moment, so a loss only counts if it lasts from one sample to the next.
+ */
+class FrequencySignal
+{
+public:
+  /*
+   * Returns the frequency and throttling since the previous sample or None
+   * if there is no previous sample to compare with.
+   */
+  Try<Option<CpuFrequency>> update(Try<os::CpuFreq> const& sample);
+
+  // Checkpointing, like `ReclaimSignal`
+  void save(StateWriter& writer) const;
+  bool restore(StateReader& reader);
+
+private:
+  Option<os::CpuFreq> previous;
+};
 
-bool loadExceedsThreshold(std::function<Try<::os::Load>()> const&, ::os::Load const&);
+bool frequencyBelowThreshold(Try<Option<CpuFrequency>> const& frequency, double threshold);
 
 } // namespace threshold {
 } // namespace blue_yonder {
@@ -1,19 +1,38 @@
 #include "threshold_qos_controller.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <limits>
 #include <list>
+#include <tuple>
 
 #include <stout/os.hpp>
+#include <stout/path.hpp>
 
 #include <glog/logging.h>
 
+#include <process/clock.hpp>
+#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
+#include <process/help.hpp>
+#include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/process.hpp>
 
+#include "checkpoint.hpp"
+#include "config.hpp"
+#include "config_watcher.hpp"
+#include "executor_statistics.hpp"
+#include "decision_trace.hpp"
+#include "host_state_export.hpp"
+#include "io_thread.hpp"
+#include "memory_protection.hpp"
+#include "metrics.hpp"
 #include "os.hpp"
+#include "policy.hpp"
+#include "revocable.hpp"
+#include "samplers.hpp"
 #include "threshold.hpp"
 
 using std::list;
@@ -21,61 +40,372 @@ using std::list;
 using process::dispatch;
 using process::Failure;
 using process::Future;
+using process::Owned;
 using process::Process;
+using process::HELP;
+using process::TLDR;
+using process::DESCRIPTION;
+
+namespace http = process::http;
 
 using mesos::Resources;
 using mesos::ResourceUsage;
 using mesos::slave::QoSController;
 using mesos::slave::QoSCorrection;
 
+using com::blue_yonder::Checkpoint;
+using com::blue_yonder::Configuration;
+using com::blue_yonder::ConfigWatcher;
+using com::blue_yonder::ExecutorStatistics;
+using com::blue_yonder::HostStateExport;
+using com::blue_yonder::DecisionRecord;
+using com::blue_yonder::Overloads;
+using com::blue_yonder::RevocableExecutors;
+using com::blue_yonder::Signals;
+using com::blue_yonder::SignalState;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
 using com::blue_yonder::ThresholdQoSController;
 using com::blue_yonder::ThresholdQoSControllerProcess;
 
 using ::os::Load;
 
 
+namespace {
+
+// Where the decision trace is dumped to on SIGUSR2, if at all
+Option<std::string> traceDumpPath(Configuration const& config, std::string const& name) {
+  if (!config.traceDump) {
+    return None();
+  }
+  return path::join(config.stateDir.get(), name);
+}
+
+// Version of the decision state checkpointed across restarts of the agent:
+// the last correction, followed by the state of the signals and the
+// executors. Any change to its layout, including the one of `DecisionRecord`,
+// must bump it.
+uint32_t const STATE_VERSION = 9;
+
+// The minimum time between two saves of the decision state. The state is lost
+// for at most that long when the agent goes down.
+Duration const CHECKPOINT_INTERVAL = Seconds(10);
+
+// The executor a policy kills and why, if any
+struct Kill
+{
+  DecisionRecord::Action action;
+  ResourceUsage::Executor const* victim;
+};
+
+} // namespace {
+
+
 class ThresholdQoSControllerProcess : public Process<ThresholdQoSControllerProcess>
 {
 public:
   ThresholdQoSControllerProcess(
     std::function<Future<ResourceUsage>()> const&,
-    std::function<Try<Load>()> const&,
-    std::function<Try<os::MemInfo>()> const&,
-    Load const&,
-    Bytes const&);
+    Samplers const&,
+    Configuration const&);
   Future<list<QoSCorrection>> corrections();
 
+protected:
+  virtual void initialize() override;
+  virtual void finalize() override;
+
 private:
-  Future<list<QoSCorrection>> _corrections(ResourceUsage const& usage);
+  Future<http::Response> traceEndpoint(http::Request const&);
+
+  void reload();
+  void watchFailed();
+  void reconfigure(Try<Configuration> const& reloaded);
 
+  void restore();
+  void share();
+  void persist(DecisionRecord const& record);
+  void saved(Future<Try<Nothing>> const& result);
+
+  void protect(ResourceUsage const& usage, Try<os::MemInfo> const& memory);
+  void _protect(size_t failures);
+
+  Future<list<QoSCorrection>> _corrections(
+    ResourceUsage const& usage,
+    HostSample const& sample);
+
+  // Chooses the victim for the given signals and overloads of a
+  // configuration among the executors of the current resource usage.
+  Kill choose(Signals const& signals, Overloads const& overloads, Configuration const& config);
+
+  // The work lost by killing the executor, in seconds weighted by priority
+  double lostWork(ResourceUsage::Executor const& executor, Configuration const& config) const;
+
+  IOThread io;
+  ControllerMetrics metrics;
+  DecisionTrace decisions;
   std::function<Future<ResourceUsage>()> const usage;
-  std::function<Try<Load>()> const load;
-  std::function<Try<os::MemInfo>()> const memory;
-  Load const loadThreshold;
-  Bytes const memThreshold;
+  Samplers const samplers;
+  Configuration config;
+  SignalState signalState;
+  ExecutorStatistics executors;
+  RevocableExecutors revocable;
+  MemoryProtection protection; // last planned, to reset what a new plan no longer covers
+  Owned<ConfigWatcher> watcher;
+  Owned<Checkpoint> checkpoint;
+  std::string state; // serialized for the checkpoint, reused across decisions
+  bool saving; // whether a save is pending on the I/O thread
+  Option<double> lastSaved;
+  Owned<HostStateExport> shared;
 };
 
 
 ThresholdQoSControllerProcess::ThresholdQoSControllerProcess(
   std::function<Future<ResourceUsage>()> const& usage,
-  std::function<Try<Load>()> const& load,
-  std::function<Try<os::MemInfo>()> const& memory,
-  Load const& loadThreshold,
-  Bytes const& memThreshold)
+  Samplers const& samplers,
+  Configuration const& config)
   : ProcessBase(process::ID::generate("threshold-qos-controller")),
+    decisions(traceDumpPath(config, "threshold-qos-controller.trace"), io),
     usage{usage},
-    load{load},
-    memory{memory},
-    loadThreshold(loadThreshold),
-    memThreshold(memThreshold)
+    samplers(samplers),
+    config(config),
+    protection(),
+    saving{false}
 {}
 
+void ThresholdQoSControllerProcess::initialize() {
+  route(
+    "/trace",
+    HELP(
+      TLDR("Binary trace of the most recent corrections."),
+      DESCRIPTION(
+        "Returns a `DecisionTrace` header followed by the recorded",
+        "`DecisionRecord`s, oldest first.")),
+    &Self::traceEndpoint);
+
+  if (config.configFile.isSome()) {
+    auto const pid = self();
+    watcher.reset(new ConfigWatcher(
+      config.configFile.get(),
+      [pid]() { dispatch(pid, &ThresholdQoSControllerProcess::reload); },
+      [pid]() { dispatch(pid, &ThresholdQoSControllerProcess::watchFailed); }));
+  }
+
+  if (config.stateDir.isSome()) {
+    restore();
+  }
+
+  if (config.shmExport) {
+    share();
+  }
+}
+
+void ThresholdQoSControllerProcess::finalize() {
+  watcher.reset();
+}
+
+void ThresholdQoSControllerProcess::watchFailed() {
+  ++metrics.configWatchErrors;
+}
+
+void ThresholdQoSControllerProcess::reload() {
+  // Reading the file is blocking I/O and therefore done on the I/O thread.
+  auto const parameters = config.parameters;
+  io.run<Try<Configuration>>([parameters]() { return parseConfiguration(parameters); })
+    .onReady(process::defer(self(), &Self::reconfigure, std::placeholders::_1));
+}
+
+void ThresholdQoSControllerProcess::reconfigure(Try<Configuration> const& reloaded) {
+  if (reloaded.isError()) {
+    LOG(ERROR) << "Failed to reload ThresholdQoSController configuration: "
+               << reloaded.error() << ". Keeping the current configuration";
+    return;
+  }
+
+  // As we are the only ones accessing the configuration, swapping it here
+  // takes effect atomically between two corrections.
+  config = reloaded.get();
+
+  LOG(INFO) << "Reloaded ThresholdQoSController configuration. " << config;
+}
+
+void ThresholdQoSControllerProcess::restore() {
+  auto const path = path::join(config.stateDir.get(), "threshold-qos-controller.state");
+  auto const opened = Checkpoint::open(path, STATE_VERSION);
+  if (opened.isError()) {
+    LOG(ERROR) << "Failed to open ThresholdQoSController state: " << opened.error()
+               << ". Continuing without checkpointing";
+    return;
+  }
+  checkpoint = opened.get();
+
+  auto const restored = checkpoint->restore(config.stateMaxAge);
+  if (restored.isNone()) {
+    LOG(INFO) << "No recent ThresholdQoSController state found in " << path;
+    return;
+  }
+
+  StateReader reader(restored.get());
+  DecisionRecord last;
+  if (!reader.read(last)) {
+    LOG(WARNING) << "Ignoring truncated ThresholdQoSController state in " << path;
+    return;
+  }
+
+  decisions.record(last);
+  metrics.evaluated(last.flags & DecisionRecord::LOAD_EXCEEDED, last.flags & DecisionRecord::MEM_EXCEEDED);
+
+  // Each part is either restored completely or not at all, so a malformed
+  // one at worst leaves the later ones at their initial state.
+  if (!signalState.restore(reader) ||
+      !executors.restore(reader) ||
+      !reader.done()) {
+    LOG(WARNING) << "Ignoring malformed parts of the ThresholdQoSController state in " << path;
+  }
+
+  LOG(INFO) << "Restored ThresholdQoSController state of "
+            << process::Clock::now().secs() - last.timestamp << " seconds ago";
+}
+
+void ThresholdQoSControllerProcess::share() {
+  auto const opened = HostStateExport::open(com::blue_yonder::HOST_STATE_CONTROLLER, config.shmMode);
+  if (opened.isError()) {
+    LOG(ERROR) << "Failed to export ThresholdQoSController host state: " << opened.error()
+               << ". Continuing without shared memory export";
+    return;
+  }
+  shared = opened.get();
+
+  LOG(INFO) << "Exporting ThresholdQoSController host state to shared memory segment "
+            << shared->name();
+}
+
+void ThresholdQoSControllerProcess::persist(DecisionRecord const& record) {
+  decisions.record(record);
+  if (shared.get() != nullptr) {
+    shared->publish(record);
+  }
+
+  // The state is serialized here but saved on the I/O thread, at most once
+  // per interval and one save at a time, so that neither the copy into the
+  // mapping nor a slow disk delays decisions.
+  double const now = process::Clock::now().secs();
+  if (checkpoint.get() == nullptr || saving ||
+      (lastSaved.isSome() && now - lastSaved.get() < CHECKPOINT_INTERVAL.secs())) {
+    return;
+  }
+
+  StateWriter writer(state);
+  writer.write(record);
+  signalState.save(writer);
+  executors.save(writer);
+
+  saving = true;
+  lastSaved = now;
+  auto const target = checkpoint;
+  auto const serialized = state;
+  io.run<Try<Nothing>>([target, serialized]() { return target->save(serialized); })
+    .onAny(process::defer(self(), &Self::saved, std::placeholders::_1));
+}
+
+void ThresholdQoSControllerProcess::saved(Future<Try<Nothing>> const& result) {
+  saving = false;
+  if (!result.isReady()) {
+    LOG(ERROR) << "Failed to checkpoint ThresholdQoSController state: "
+               << (result.isFailed() ? result.failure() : "discarded");
+  } else if (result.get().isError()) {
+    LOG(ERROR) << "Failed to checkpoint ThresholdQoSController state: " << result.get().error();
+  }
+}
+
+void ThresholdQoSControllerProcess::protect(
+    ResourceUsage const& usage,
+    Try<os::MemInfo> const& memory)
+{
+  auto next = config.memoryProtection
+    ? planMemoryProtection(usage, memory, config)
+    : MemoryProtection();
+
+  // Without a sample of the host memory, `memory.high` is left as it is
+  // rather than reset.
+  bool const keepHigh = config.memoryProtection && memory.isError();
+  if (keepHigh) {
+    next.high.swap(protection.high);
+  }
+  planMemoryReset(next, protection);
+  if (keepHigh) {
+    next.high.swap(protection.high);
+  } else {
+    protection.high = next.high;
+  }
+  protection.low = next.low;
+
+  // Writing to the cgroup and proc file systems is blocking I/O and
+  // therefore done on the I/O thread.
+  io.run<size_t>([next]() { return applyMemoryProtection(next); })
+    .onReady(process::defer(self(), &Self::_protect, std::placeholders::_1));
+}
+
+void ThresholdQoSControllerProcess::_protect(size_t failures) {
+  metrics.memoryProtectionErrors += failures;
+}
+
+Future<http::Response> ThresholdQoSControllerProcess::traceEndpoint(http::Request const&) {
+  http::OK response(decisions.serialize());
+  response.headers["Content-Type"] = "application/octet-stream";
+  return response;
+}
+
 Future<list<QoSCorrection>> ThresholdQoSControllerProcess::corrections() {
-  return usage().then(process::defer(self(), &Self::_corrections, std::placeholders::_1));
+  // Host metrics are sampled on the I/O thread, concurrently with the agent
+  // collecting the resource usage. Both are awaited rather than collected,
+  // which would copy the resource usage with all of its executors.
+  auto const samples = process::await(
+    metrics.usageLatency.time(usage()),
+    metrics.sampleLatency.time(sampleHost(io, samplers, config)));
+
+  return metrics.correctionsLatency.time(samples.then(process::defer(
+    self(),
+    [this](std::tuple<Future<ResourceUsage>, Future<HostSample>> const& samples)
+        -> Future<list<QoSCorrection>> {
+      auto const& usage = std::get<0>(samples);
+      auto const& sample = std::get<1>(samples);
+      if (!usage.isReady()) {
+        return Failure(
+          "Failed to get the resource usage: " +
+          (usage.isFailed() ? usage.failure() : "discarded"));
+      }
+      if (!sample.isReady()) {
+        return Failure("Failed to sample the host: discarded");
+      }
+      return _corrections(usage.get(), sample.get());
+    })));
 }
 
 namespace {
 
+// The memory to free for the host to get below the memory threshold, if any
+double memoryExcess(
+    Try<com::blue_yonder::os::MemInfo> const& memory,
+    Configuration const& config)
+{
+  if (memory.isError()) {
+    return 0;
+  }
+  auto const used = memory.get().total - memory.get().memAvailable;
+  if (used <= config.memThreshold) {
+    return 0;
+  }
+  return static_cast<double>((used - config.memThreshold).bytes());
+}
+
+// The CPUs to free for the 1 minute load to get below its threshold, if any
+double loadExcess(Try<Load> const& load, Configuration const& config) {
+  if (load.isError()) {
+    return 0;
+  }
+  return std::max(load.get().one - config.loadThreshold.one, 0.0);
+}
+
 QoSCorrection killCorrection(ResourceUsage::Executor const& executor) {
   QoSCorrection correction;
   correction.set_type(mesos::slave::QoSCorrection_Type_KILL);
@@ -86,17 +416,120 @@ QoSCorrection killCorrection(ResourceUsage::Executor const& executor) {
   return correction;
 }
 
-bool mostGreedyRevocable(ResourceUsage::Executor const& a, ResourceUsage::Executor const& b) {
-  auto const memA =
-    Resources(a.allocated()).revocable().empty() ? 0 : a.statistics().mem_total_bytes();
-  auto const memB =
-    Resources(b.allocated()).revocable().empty() ? 0 : b.statistics().mem_total_bytes();
-  return (memA < memB);
+} // namespace {
+
+Future<list<QoSCorrection>> ThresholdQoSControllerProcess::_corrections(
+    ResourceUsage const& usage,
+    HostSample const& sample)
+{
+  revocable.update(usage);
+  executors.update(usage);
+
+  auto const signals = signalState.update(sample, executors.nonRevocableThrottling(), config);
+  auto const overloads = evaluate(signals, config);
+  metrics.evaluated(signals, overloads);
+
+  auto record = DecisionRecord::make(
+    DecisionRecord::CORRECTION,
+    sample.load,
+    sample.memory,
+    config.loadThreshold,
+    config.memThreshold,
+    usage.executors_size());
+  annotate(record, signals, overloads, config);
+
+  // Let the kernel prefer revocable tasks when reclaiming memory or killing
+  // tasks until the next correction. Once protection is disabled, the
+  // settings of previous corrections are reset.
+  if (config.memoryProtection || !protection.high.empty() || !protection.low.empty()) {
+    protect(usage, sample.memory);
+  }
+
+  // Without a sample, e.g. while reads of /proc hang, we know nothing about
+  // the host. Killing a revocable task on every correction until the reads
+  // complete again would throw away work without any evidence of overload.
+  if (sample.incomplete) {
+    record.flags |= DecisionRecord::SAMPLE_INCOMPLETE;
+    persist(record);
+    return list<QoSCorrection>();
+  }
+
+  auto const kill = choose(signals, overloads, config);
+
+  // The shadow policy decides on the same snapshot, but only its divergence
+  // from the live policy is recorded.
+  if (config.shadow.get() != nullptr) {
+    auto const& shadowConfig = *config.shadow;
+    auto const shadow = choose(signals, evaluate(signals, shadowConfig), shadowConfig);
+    if (kill.victim == nullptr && shadow.victim != nullptr) {
+      ++metrics.shadowExtraKills;
+    } else if (kill.victim != nullptr && shadow.victim == nullptr) {
+      ++metrics.shadowMissingKills;
+    } else if (kill.victim != shadow.victim) {
+      ++metrics.shadowOtherVictims;
+    }
+  }
+
+  if (kill.victim == nullptr) {
+    persist(record);
+    return list<QoSCorrection>();
+  }
+
+  switch (kill.action) {
+    case DecisionRecord::KILL_MEMORY: ++metrics.memoryKills; break;
+    case DecisionRecord::KILL_THROTTLING: ++metrics.throttlingKills; break;
+    case DecisionRecord::KILL_RUNQUEUE: ++metrics.runQueueKills; break;
+    case DecisionRecord::KILL_FREQUENCY: ++metrics.frequencyKills; break;
+    case DecisionRecord::KILL_IO: ++metrics.ioKills; break;
+    case DecisionRecord::KILL_NETWORK: ++metrics.networkKills; break;
+    case DecisionRecord::KILL_LOAD: ++metrics.loadKills; break;
+    default: break;
+  }
+
+  metrics.lostWorkSeconds +=
+    static_cast<int64_t>(executors.age(kill.victim->executor_info()).getOrElse(0));
+
+  record.action = kill.action;
+  record.setVictim(kill.victim->executor_info());
+  record.setResources(Resources(kill.victim->allocated()));
+  persist(record);
+  return list<QoSCorrection>{killCorrection(*kill.victim)};
 }
 
-} // namespace {
+Kill ThresholdQoSControllerProcess::choose(
+    Signals const& signals,
+    Overloads const& overloads,
+    Configuration const& config)
+{
+  // Rather than going by the usage of the overloaded resource alone, each
+  // kill below may instead throw away as little work as possible. Among the
+  // revocable executors that free enough of that resource, we then kill the
+  // one that started most recently, weighted by its priority. If none frees
+  // enough, we fall back to the usage.
+  //
+  // CPU, I/O and network have no amount that is enough by itself. An
+  // executor that just started and is almost idle would then be killed over
+  // and over while the heavy one keeps overloading the host. It has to free
+  // at least a share of what the heaviest executor would, on load overload
+  // in addition to the excess load.
+  bool const minimizeLostWork = config.victimSelection == Configuration::LOST_WORK;
+  auto const cost = [this, &config](ResourceUsage::Executor const& executor) {
+    return lostWork(executor, config);
+  };
+  auto const cpus = [this](ResourceUsage::Executor const& executor) {
+    return executors.cpuUsage(executor.executor_info()).getOrElse(0);
+  };
+  auto const disk = [this](ResourceUsage::Executor const& executor) {
+    return executors.diskUsage(executor.executor_info()).getOrElse(0);
+  };
+  auto const network = [this](ResourceUsage::Executor const& executor) {
+    return executors.networkUsage(executor.executor_info()).getOrElse(0);
+  };
+  auto const required = [this, &config](
+      std::function<double(ResourceUsage::Executor const&)> const& freedBy) {
+    return config.lostWorkMinShare * mostFreed(revocable, freedBy);
+  };
 
-Future<list<QoSCorrection>> ThresholdQoSControllerProcess::_corrections(ResourceUsage const& usage) {
   // We assume all tasks are run in cgroups so that a single task cannot
   // overload the entire host. The host memory may only be exceeded due to the
   // existence of revocable tasks.
@@ -108,14 +541,95 @@ Future<list<QoSCorrection>> ThresholdQoSControllerProcess::_corrections(Resource
   // end. (This could be changed if Mesos adopts the oom.victim cgroup)
   //
   // If there are revocable tasks, we kill the one that has the largest memory
-  // footprint.
-  if (threshold::memExceedsThreshold(memory, memThreshold)) {
-    auto const most_greedy =
-      std::max_element(usage.executors().begin(), usage.executors().end(), mostGreedyRevocable);
-
-    if (usage.executors().end() != most_greedy &&
-        !Resources(most_greedy->allocated()).revocable().empty()) {
-      return list<QoSCorrection>{killCorrection(*most_greedy)};
+  // footprint. As that may well be a stable one, we can rather kill the one
+  // whose footprint keeps growing, weighted by its size. Only if none grows,
+  // we fall back to the largest one.
+  //
+  // The same holds for direct reclaim and swap storms. They stall production
+  // tasks long before the host runs out of memory.
+  if (overloads.memory || overloads.reclaim) {
+    if (minimizeLostWork) {
+      auto const cheapest = cheapestRevocable(
+        revocable,
+        memoryExcess(signals.memory, config),
+        [](ResourceUsage::Executor const& executor) {
+          return static_cast<double>(executor.statistics().mem_total_bytes());
+        },
+        cost);
+      if (cheapest != nullptr) {
+        return Kill{DecisionRecord::KILL_MEMORY, cheapest};
+      }
+    }
+
+    if (config.memoryVictim == Configuration::GROWTH) {
+      auto const window = config.memoryGrowthWindow;
+      auto const fastest = fastestGrowingRevocable(
+        revocable,
+        [this, window](mesos::ExecutorInfo const& executor) {
+          return executors.memoryGrowth(executor, window);
+        });
+      if (fastest != nullptr) {
+        return Kill{DecisionRecord::KILL_MEMORY, fastest};
+      }
+    }
+
+    auto const most_greedy = mostGreedyRevocable(revocable);
+    if (most_greedy != nullptr) {
+      return Kill{DecisionRecord::KILL_MEMORY, most_greedy};
+    }
+  }
+
+  // Revocable tasks run with minimal CPU shares. Yet, they can push production
+  // tasks into CFS throttling even if the load is below its thresholds. They
+  // can just as well keep production tasks waiting on busy run queues, lower
+  // the turbo frequency shared by all cores, or make the CPUs overheat. In
+  // all these cases we kill the revocable executor that used the most CPU
+  // time since the previous correction.
+  if (overloads.throttling || overloads.runQueue || overloads.frequency) {
+    auto const cheapest =
+      minimizeLostWork ? cheapestRevocable(revocable, required(cpus), cpus, cost) : nullptr;
+    auto const heaviest = cheapest != nullptr
+      ? cheapest
+      : heaviestRevocable(revocable, [this](mesos::ExecutorInfo const& executor) {
+          return executors.cpuUsage(executor);
+        });
+    if (heaviest != nullptr) {
+      auto const action = overloads.throttling
+        ? DecisionRecord::KILL_THROTTLING
+        : overloads.runQueue ? DecisionRecord::KILL_RUNQUEUE : DecisionRecord::KILL_FREQUENCY;
+      return Kill{action, heaviest};
+    }
+  }
+
+  // Revocable tasks saturating local disks hurt co-located production tasks
+  // without raising the load. We kill the revocable executor that read and
+  // wrote the most bytes since the previous correction.
+  if (overloads.io) {
+    auto const cheapest =
+      minimizeLostWork ? cheapestRevocable(revocable, required(disk), disk, cost) : nullptr;
+    auto const heaviest = cheapest != nullptr
+      ? cheapest
+      : heaviestRevocable(revocable, [this](mesos::ExecutorInfo const& executor) {
+          return executors.diskUsage(executor);
+        });
+    if (heaviest != nullptr) {
+      return Kill{DecisionRecord::KILL_IO, heaviest};
+    }
+  }
+
+  // The same holds for saturated network links. The agent only reports the
+  // traffic of executors with the `network/port_mapping` isolator. Without
+  // it, we fall back to the first revocable executor.
+  if (overloads.network) {
+    auto const cheapest =
+      minimizeLostWork ? cheapestRevocable(revocable, required(network), network, cost) : nullptr;
+    auto const heaviest = cheapest != nullptr
+      ? cheapest
+      : heaviestRevocable(revocable, [this](mesos::ExecutorInfo const& executor) {
+          return executors.networkUsage(executor);
+        });
+    if (heaviest != nullptr) {
+      return Kill{DecisionRecord::KILL_NETWORK, heaviest};
     }
   }
 
@@ -131,27 +645,34 @@ Future<list<QoSCorrection>> ThresholdQoSControllerProcess::_corrections(Resource
   // Killing a random tasks rather than the one that is using the most cpu time
   // is a simplificiation. Otherwise we would have to make this QoSController
   // stateful in order to measure which revocable task is using the most CPU time.
-  if (threshold::loadExceedsThreshold(load, loadThreshold)) {
-    foreach (ResourceUsage::Executor const& executor, usage.executors()) {
-      if (!Resources(executor.allocated()).revocable().empty()) {
-        return list<QoSCorrection>{killCorrection(executor)};
-      }
+  if (overloads.load) {
+    auto const cheapest = minimizeLostWork
+      ? cheapestRevocable(
+          revocable, std::max(loadExcess(signals.load, config), required(cpus)), cpus, cost)
+      : nullptr;
+    auto const first = cheapest != nullptr ? cheapest : firstRevocable(revocable);
+    if (first != nullptr) {
+      return Kill{DecisionRecord::KILL_LOAD, first};
     }
   }
-  return list<QoSCorrection>();
+
+  return Kill{DecisionRecord::NONE, nullptr};
+}
+
+double ThresholdQoSControllerProcess::lostWork(
+    ResourceUsage::Executor const& executor,
+    Configuration const& config) const
+{
+  auto const& info = executor.executor_info();
+  return executors.age(info).getOrElse(0) * (1 + priorityOf(info, config.priorityLabel));
 }
 
 
 ThresholdQoSController::ThresholdQoSController(
-  std::function<Try<Load>()> const& load,
-  std::function<Try<os::MemInfo>()> const& memory,
-  mesos::Resources const& totalRevocable,
-  Load const& loadThreshold,
-  Bytes const& memThreshold)
-  : load{load},
-    memory{memory},
-    loadThreshold(loadThreshold),
-    memThreshold(memThreshold)
+  Samplers const& samplers,
+  Configuration const& config)
+  : samplers(samplers),
+    config(config)
 {}
 
 Try<Nothing> ThresholdQoSController::initialize(std::function<Future<ResourceUsage>()> const& usage) {
@@ -159,16 +680,12 @@ Try<Nothing> ThresholdQoSController::initialize(std::function<Future<ResourceUsa
     return Error("ThresholdQoSController has already been initialized");
   }
 
-  LOG(INFO) << "Initializing ThresholdQoSController. Load thresholds: "
-            << loadThreshold.one << " " << loadThreshold.five << " " << loadThreshold.fifteen << " "
-            << "Memory threshold: " << memThreshold;
+  LOG(INFO) << "Initializing ThresholdQoSController. " << config;
 
   process.reset(new ThresholdQoSControllerProcess(
     usage,
-    load,
-    memory,
-    loadThreshold,
-    memThreshold));
+    samplers,
+    config));
   spawn(process.get());
 
   return Nothing();
@@ -7,36 +7,28 @@
 
 #include <mesos/module/qos_controller.hpp>
 
+#include "config.hpp"
+#include "samplers.hpp"
+
 namespace com {
 namespace blue_yonder {
 
-namespace os {
-
-struct MemInfo;
-
-} // namespace os {
-
 class ThresholdQoSControllerProcess;
 
 class ThresholdQoSController : public mesos::slave::QoSController
 {
 public:
   ThresholdQoSController(
-    std::function<Try<::os::Load>()> const& load,
-    std::function<Try<os::MemInfo>()> const& memory,
-    mesos::Resources const& totalRevocable,
-    ::os::Load const& loadThreshold,
-    Bytes const& memThreshold);
+    Samplers const& samplers,
+    Configuration const& config);
   virtual Try<Nothing> initialize(const std::function<process::Future<mesos::ResourceUsage>()>&) final;
   virtual process::Future<std::list<mesos::slave::QoSCorrection>> corrections() final;
   virtual ~ThresholdQoSController();
 
 private:
   process::Owned<ThresholdQoSControllerProcess> process;
-  std::function<Try<::os::Load>()> const load;
-  std::function<Try<os::MemInfo>()> const memory;
-  ::os::Load const loadThreshold;
-  Bytes const memThreshold;
+  Samplers const samplers;
+  Configuration const config;
 };
 
 } // namespace blue_yonder {
@@ -1,42 +1,75 @@
 #include "threshold_resource_estimator.hpp"
 
 #include <limits>
+#include <tuple>
 
 #include <stout/os.hpp>
+#include <stout/path.hpp>
 
 #include <glog/logging.h>
 
+#include <process/clock.hpp>
+#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
+#include <process/help.hpp>
+#include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/process.hpp>
 
+#include "checkpoint.hpp"
+#include "config.hpp"
+#include "config_watcher.hpp"
+#include "executor_statistics.hpp"
+#include "decision_trace.hpp"
+#include "headroom.hpp"
+#include "host_state_export.hpp"
+#include "io_thread.hpp"
+#include "metrics.hpp"
+#include "offer_ramp.hpp"
 #include "os.hpp"
+#include "policy.hpp"
+#include "revocable.hpp"
+#include "samplers.hpp"
 #include "threshold.hpp"
 
 using process::dispatch;
 using process::Failure;
 using process::Future;
+using process::Owned;
 using process::Process;
+using process::HELP;
+using process::TLDR;
+using process::DESCRIPTION;
+
+namespace http = process::http;
 
 using mesos::Resource;
 using mesos::Resources;
 using mesos::ResourceUsage;
 
+using com::blue_yonder::Checkpoint;
+using com::blue_yonder::Configuration;
+using com::blue_yonder::ConfigWatcher;
+using com::blue_yonder::ExecutorStatistics;
+using com::blue_yonder::HostStateExport;
+using com::blue_yonder::DecisionRecord;
+using com::blue_yonder::Headroom;
+using com::blue_yonder::OfferRamp;
+using com::blue_yonder::RevocableExecutors;
+using com::blue_yonder::SignalState;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
 using com::blue_yonder::ThresholdResourceEstimator;
 using com::blue_yonder::ThresholdResourceEstimatorProcess;
 
+namespace rules = com::blue_yonder::rules;
+
 using ::os::Load;
 
 
 namespace {
 
-Resources unallocated(const Resources& resources) {
-  Resources result = resources;
-  result.unallocate();
-  return result;
-}
-
 Resources makeRevocable(Resources const& any) {
   Resources revocable;
   for (mesos::Resource resource : any) {
@@ -46,6 +79,29 @@ Resources makeRevocable(Resources const& any) {
   return revocable;
 }
 
+// The shadow policy if there is one, the live policy otherwise
+Configuration const& shadowOf(Configuration const& config) {
+  return config.shadow.get() != nullptr ? *config.shadow : config;
+}
+
+// Where the decision trace is dumped to on SIGUSR2, if at all
+Option<std::string> traceDumpPath(Configuration const& config, std::string const& name) {
+  if (!config.traceDump) {
+    return None();
+  }
+  return path::join(config.stateDir.get(), name);
+}
+
+// Version of the decision state checkpointed across restarts of the agent:
+// the last estimation, followed by the state of the signals, the headroom, the
+// ramp of the shadow policy and the executors. Any change to its layout,
+// including the one of `DecisionRecord`, must bump it.
+uint32_t const STATE_VERSION = 10;
+
+// The minimum time between two saves of the decision state. The state is lost
+// for at most that long when the agent goes down.
+Duration const CHECKPOINT_INTERVAL = Seconds(10);
+
 } // namespace {
 
 
@@ -54,72 +110,362 @@ class ThresholdResourceEstimatorProcess : public Process<ThresholdResourceEstima
 public:
   ThresholdResourceEstimatorProcess(
     std::function<Future<ResourceUsage>()> const&,
-    std::function<Try<Load>()> const&,
-    std::function<Try<os::MemInfo>()> const&,
-    Resources const&,
-    Load const&,
-    Bytes const&);
+    Samplers const&,
+    Configuration const&);
   Future<Resources> oversubscribable();
 
-private:
-  Future<Resources> calcUnusedResources(ResourceUsage const& usage);
+protected:
+  virtual void initialize() override;
+  virtual void finalize() override;
 
+private:
+  Future<http::Response> traceEndpoint(http::Request const&);
+
+  void reload();
+  void watchFailed();
+  void reconfigure(Try<Configuration> const& reloaded);
+
+  void restore();
+  void share();
+  void persist(DecisionRecord const& record);
+  void saved(Future<Try<Nothing>> const& result);
+
+  Future<Resources> calcUnusedResources(
+    ResourceUsage const& usage,
+    HostSample const& sample);
+
+  // The revocable resources to offer under the given configuration if none
+  // of its thresholds is reached
+  Resources offerable(
+    Resources const& total,
+    Configuration const& config,
+    double fraction,
+    ResourceUsage const& usage) const;
+
+  IOThread io;
+  EstimatorMetrics metrics;
+  DecisionTrace decisions;
   std::function<Future<ResourceUsage>()> const usage;
-  std::function<Try<Load>()> const load;
-  std::function<Try<os::MemInfo>()> const memory;
-  Resources const totalRevocable;
-  Load const loadThreshold;
-  Bytes const memThreshold;
+  Samplers const samplers;
+  Configuration config;
+  Resources totalRevocable;
+  Resources shadowTotalRevocable;
+  OfferRamp ramp;
+  OfferRamp shadowRamp;
+  SignalState signalState;
+  ExecutorStatistics executors;
+  RevocableExecutors revocable;
+  Headroom headroom;
+  Owned<ConfigWatcher> watcher;
+  Owned<Checkpoint> checkpoint;
+  std::string state; // serialized for the checkpoint, reused across decisions
+  bool saving; // whether a save is pending on the I/O thread
+  Option<double> lastSaved;
+  Owned<HostStateExport> shared;
 };
 
 
 ThresholdResourceEstimatorProcess::ThresholdResourceEstimatorProcess(
   std::function<Future<ResourceUsage>()> const& usage,
-  std::function<Try<Load>()> const& load,
-  std::function<Try<os::MemInfo>()> const& memory,
-  Resources const& totalRevocable,
-  Load const& loadThreshold,
-  Bytes const& memThreshold)
+  Samplers const& samplers,
+  Configuration const& config)
   : ProcessBase(process::ID::generate("threshold-resource-estimator")),
+    decisions(traceDumpPath(config, "threshold-resource-estimator.trace"), io),
     usage{usage},
-    load{load},
-    memory{memory},
-    totalRevocable{totalRevocable},
-    loadThreshold(loadThreshold),
-    memThreshold(memThreshold)
+    samplers(samplers),
+    config(config),
+    totalRevocable{makeRevocable(config.resources)},
+    shadowTotalRevocable{makeRevocable(shadowOf(config).resources)},
+    ramp{config.offerRampIncrease, config.offerRampDecrease},
+    shadowRamp{shadowOf(config).offerRampIncrease, shadowOf(config).offerRampDecrease},
+    headroom{config.headroomWindow},
+    saving{false}
 {}
 
+void ThresholdResourceEstimatorProcess::initialize() {
+  route(
+    "/trace",
+    HELP(
+      TLDR("Binary trace of the most recent estimations."),
+      DESCRIPTION(
+        "Returns a `DecisionTrace` header followed by the recorded",
+        "`DecisionRecord`s, oldest first.")),
+    &Self::traceEndpoint);
+
+  if (config.configFile.isSome()) {
+    auto const pid = self();
+    watcher.reset(new ConfigWatcher(
+      config.configFile.get(),
+      [pid]() { dispatch(pid, &ThresholdResourceEstimatorProcess::reload); },
+      [pid]() { dispatch(pid, &ThresholdResourceEstimatorProcess::watchFailed); }));
+  }
+
+  if (config.stateDir.isSome()) {
+    restore();
+  }
+
+  if (config.shmExport) {
+    share();
+  }
+}
+
+void ThresholdResourceEstimatorProcess::finalize() {
+  watcher.reset();
+}
+
+void ThresholdResourceEstimatorProcess::watchFailed() {
+  ++metrics.configWatchErrors;
+}
+
+void ThresholdResourceEstimatorProcess::reload() {
+  // Reading the file is blocking I/O and therefore done on the I/O thread.
+  auto const parameters = config.parameters;
+  io.run<Try<Configuration>>([parameters]() { return parseConfiguration(parameters); })
+    .onReady(process::defer(self(), &Self::reconfigure, std::placeholders::_1));
+}
+
+void ThresholdResourceEstimatorProcess::reconfigure(Try<Configuration> const& reloaded) {
+  if (reloaded.isError()) {
+    LOG(ERROR) << "Failed to reload ThresholdResourceEstimator configuration: "
+               << reloaded.error() << ". Keeping the current configuration";
+    return;
+  }
+
+  // As we are the only ones accessing the configuration, swapping it here
+  // takes effect atomically between two estimations.
+  config = reloaded.get();
+  totalRevocable = makeRevocable(config.resources);
+  shadowTotalRevocable = makeRevocable(shadowOf(config).resources);
+  ramp.reconfigure(config.offerRampIncrease, config.offerRampDecrease);
+  shadowRamp.reconfigure(shadowOf(config).offerRampIncrease, shadowOf(config).offerRampDecrease);
+  headroom.resize(config.headroomWindow);
+
+  LOG(INFO) << "Reloaded ThresholdResourceEstimator configuration. " << config;
+}
+
+void ThresholdResourceEstimatorProcess::restore() {
+  auto const path = path::join(config.stateDir.get(), "threshold-resource-estimator.state");
+  auto const opened = Checkpoint::open(path, STATE_VERSION);
+  if (opened.isError()) {
+    LOG(ERROR) << "Failed to open ThresholdResourceEstimator state: " << opened.error()
+               << ". Continuing without checkpointing";
+    return;
+  }
+  checkpoint = opened.get();
+
+  auto const restored = checkpoint->restore(config.stateMaxAge);
+  if (restored.isNone()) {
+    LOG(INFO) << "No recent ThresholdResourceEstimator state found in " << path;
+    return;
+  }
+
+  StateReader reader(restored.get());
+  DecisionRecord last;
+  if (!reader.read(last)) {
+    LOG(WARNING) << "Ignoring truncated ThresholdResourceEstimator state in " << path;
+    return;
+  }
+
+  decisions.record(last);
+  metrics.evaluated(last.flags & DecisionRecord::LOAD_EXCEEDED, last.flags & DecisionRecord::MEM_EXCEEDED);
+  metrics.offeredRevocableCpus = last.cpus;
+  metrics.offeredRevocableMem = Bytes(last.memBytes).megabytes();
+  ramp.restore(last.offerFraction, last.action != DecisionRecord::OFFER);
+  metrics.offerFraction = ramp.fraction();
+
+  // Each part is either restored completely or not at all, so a malformed
+  // one at worst leaves the later ones at their initial state.
+  if (!signalState.restore(reader) ||
+      !headroom.restore(reader) ||
+      !shadowRamp.restore(reader) ||
+      !executors.restore(reader) ||
+      !reader.done()) {
+    LOG(WARNING) << "Ignoring malformed parts of the ThresholdResourceEstimator state in " << path;
+  }
+
+  LOG(INFO) << "Restored ThresholdResourceEstimator state of "
+            << process::Clock::now().secs() - last.timestamp << " seconds ago";
+}
+
+void ThresholdResourceEstimatorProcess::share() {
+  auto const opened = HostStateExport::open(com::blue_yonder::HOST_STATE_ESTIMATOR, config.shmMode);
+  if (opened.isError()) {
+    LOG(ERROR) << "Failed to export ThresholdResourceEstimator host state: " << opened.error()
+               << ". Continuing without shared memory export";
+    return;
+  }
+  shared = opened.get();
+
+  LOG(INFO) << "Exporting ThresholdResourceEstimator host state to shared memory segment "
+            << shared->name();
+}
+
+void ThresholdResourceEstimatorProcess::persist(DecisionRecord const& record) {
+  decisions.record(record);
+  if (shared.get() != nullptr) {
+    shared->publish(record);
+  }
+
+  // The state is serialized here but saved on the I/O thread, at most once
+  // per interval and one save at a time, so that neither the copy into the
+  // mapping nor a slow disk delays decisions.
+  double const now = process::Clock::now().secs();
+  if (checkpoint.get() == nullptr || saving ||
+      (lastSaved.isSome() && now - lastSaved.get() < CHECKPOINT_INTERVAL.secs())) {
+    return;
+  }
+
+  StateWriter writer(state);
+  writer.write(record);
+  signalState.save(writer);
+  headroom.save(writer);
+  shadowRamp.save(writer);
+  executors.save(writer);
+
+  saving = true;
+  lastSaved = now;
+  auto const target = checkpoint;
+  auto const serialized = state;
+  io.run<Try<Nothing>>([target, serialized]() { return target->save(serialized); })
+    .onAny(process::defer(self(), &Self::saved, std::placeholders::_1));
+}
+
+void ThresholdResourceEstimatorProcess::saved(Future<Try<Nothing>> const& result) {
+  saving = false;
+  if (!result.isReady()) {
+    LOG(ERROR) << "Failed to checkpoint ThresholdResourceEstimator state: "
+               << (result.isFailed() ? result.failure() : "discarded");
+  } else if (result.get().isError()) {
+    LOG(ERROR) << "Failed to checkpoint ThresholdResourceEstimator state: " << result.get().error();
+  }
+}
+
+Future<http::Response> ThresholdResourceEstimatorProcess::traceEndpoint(http::Request const&) {
+  http::OK response(decisions.serialize());
+  response.headers["Content-Type"] = "application/octet-stream";
+  return response;
+}
+
 Future<Resources> ThresholdResourceEstimatorProcess::oversubscribable() {
-  return usage().then(process::defer(self(), &Self::calcUnusedResources, std::placeholders::_1));
+  // Host metrics are sampled on the I/O thread, concurrently with the agent
+  // collecting the resource usage. Both are awaited rather than collected,
+  // which would copy the resource usage with all of its executors.
+  auto const samples = process::await(
+    metrics.usageLatency.time(usage()),
+    metrics.sampleLatency.time(sampleHost(io, samplers, config)));
+
+  return metrics.oversubscribableLatency.time(samples.then(process::defer(
+    self(),
+    [this](std::tuple<Future<ResourceUsage>, Future<HostSample>> const& samples)
+        -> Future<Resources> {
+      auto const& usage = std::get<0>(samples);
+      auto const& sample = std::get<1>(samples);
+      if (!usage.isReady()) {
+        return Failure(
+          "Failed to get the resource usage: " +
+          (usage.isFailed() ? usage.failure() : "discarded"));
+      }
+      if (!sample.isReady()) {
+        return Failure("Failed to sample the host: discarded");
+      }
+      return calcUnusedResources(usage.get(), sample.get());
+    })));
 }
 
-Future<Resources> ThresholdResourceEstimatorProcess::calcUnusedResources(ResourceUsage const& usage) {
-  bool cpuOverload = threshold::loadExceedsThreshold(load, loadThreshold);
-  bool memOverload = threshold::memExceedsThreshold(memory, memThreshold);
+Future<Resources> ThresholdResourceEstimatorProcess::calcUnusedResources(
+    ResourceUsage const& usage,
+    HostSample const& sample)
+{
+  revocable.update(usage);
+  executors.update(usage);
+  headroom.update(usage, executors);
+
+  auto const signals = signalState.update(sample, executors.nonRevocableThrottling(), config);
+  auto const overloads = evaluate(signals, config);
+  metrics.evaluated(signals, overloads);
+
+  auto record = DecisionRecord::make(
+    DecisionRecord::ESTIMATION,
+    sample.load,
+    sample.memory,
+    config.loadThreshold,
+    config.memThreshold,
+    usage.executors_size());
+  annotate(record, signals, overloads, config);
+  if (sample.incomplete) {
+    record.flags |= DecisionRecord::SAMPLE_INCOMPLETE;
+  }
+
+  // Rather than offering everything again right after an overload, offers
+  // grow gradually. With the default increase they are restored at once.
+  record.offerFraction = ramp.update(overloads.any());
+  metrics.offerFraction = record.offerFraction;
+
+  Resources offered;
+  if (!overloads.any()) {
+    if (config.headroomPercentile.isSome()) {
+      auto const percentile = config.headroomPercentile.get();
+      metrics.headroomCpus = headroom.reservedCpus(percentile, config.headroomMargin).getOrElse(0);
+      metrics.headroomMem =
+        headroom.reservedMem(percentile, config.headroomMargin).getOrElse(Bytes(0)).megabytes();
+    }
+
+    offered = offerable(totalRevocable, config, record.offerFraction, usage);
+    record.action = DecisionRecord::OFFER;
+    record.setResources(offered);
+  }
 
-  if (cpuOverload or memOverload) {
-    return Resources();
+  metrics.offeredRevocableCpus = offered.cpus().getOrElse(0);
+  metrics.offeredRevocableMem = offered.mem().getOrElse(Bytes(0)).megabytes();
+
+  // The shadow policy estimates on the same snapshot, but only its
+  // divergence from the live policy is recorded.
+  if (config.shadow.get() != nullptr) {
+    auto const& shadow = *config.shadow;
+    bool const shadowOverload = rules::Overload::reached(signals, shadow);
+    double const shadowFraction = shadowRamp.update(shadowOverload);
+    Resources const shadowOffered =
+      shadowOverload ? Resources() : offerable(shadowTotalRevocable, shadow, shadowFraction, usage);
+
+    double const shadowCpus = shadowOffered.cpus().getOrElse(0);
+    double const shadowMem = shadowOffered.mem().getOrElse(Bytes(0)).megabytes();
+    metrics.shadowOfferedRevocableCpus = shadowCpus;
+    metrics.shadowOfferedRevocableMem = shadowMem;
+    metrics.shadowOfferDeltaCpus = shadowCpus - offered.cpus().getOrElse(0);
+    metrics.shadowOfferDeltaMem = shadowMem - offered.mem().getOrElse(Bytes(0)).megabytes();
+    if (overloads.any() && !shadowOverload) {
+      ++metrics.shadowExtraOffers;
+    } else if (!overloads.any() && shadowOverload) {
+      ++metrics.shadowCutOffers;
+    }
   }
 
-  Resources allocatedRevocable;
-  for (auto const& executor : usage.executors()) {
-    allocatedRevocable += Resources(executor.allocated()).revocable();
+  persist(record);
+  return offered;
+}
+
+Resources ThresholdResourceEstimatorProcess::offerable(
+    Resources const& total,
+    Configuration const& config,
+    double fraction,
+    ResourceUsage const& usage) const
+{
+  // Only offer what is left once the peaks of non-revocable executors are
+  // taken care of.
+  Resources resources = scaled(total, fraction);
+  if (config.headroomPercentile.isSome()) {
+    resources = headroom.limit(
+      resources, usage, config.headroomPercentile.get(), config.headroomMargin);
   }
-  return totalRevocable - unallocated(allocatedRevocable);
+  return resources - revocable.allocated();
 }
 
 
 ThresholdResourceEstimator::ThresholdResourceEstimator(
-  std::function<Try<Load>()> const& load,
-  std::function<Try<os::MemInfo>()> const& memory,
-  Resources const& totalRevocable,
-  Load const& loadThreshold,
-  Bytes const& memThreshold)
-  : load{load},
-    memory{memory},
-    totalRevocable{makeRevocable(totalRevocable)},
-    loadThreshold(loadThreshold),
-    memThreshold(memThreshold)
+  Samplers const& samplers,
+  Configuration const& config)
+  : samplers(samplers),
+    config(config)
 {}
 
 Try<Nothing> ThresholdResourceEstimator::initialize(
@@ -129,17 +475,12 @@ Try<Nothing> ThresholdResourceEstimator::initialize(
     return Error("ThresholdResourceEstimator has already been initialized");
   }
 
-  LOG(INFO) << "Initializing ThresholdResourceEstimator. Load thresholds: " << loadThreshold.one
-            << " " << loadThreshold.five << " " << loadThreshold.fifteen << " "
-            << "Memory threshold: " << memThreshold;
+  LOG(INFO) << "Initializing ThresholdResourceEstimator. " << config;
 
   process.reset(new ThresholdResourceEstimatorProcess(
     usage,
-    load,
-    memory,
-    totalRevocable,
-    loadThreshold,
-    memThreshold));
+    samplers,
+    config));
   spawn(process.get());
 
   return Nothing();
@@ -7,37 +7,28 @@
 
 #include <mesos/module/resource_estimator.hpp>
 
+#include "config.hpp"
+#include "samplers.hpp"
+
 namespace com {
 namespace blue_yonder {
 
-namespace os {
-
-struct MemInfo;
-
-} // namespace os {
-
 class ThresholdResourceEstimatorProcess;
 
 class ThresholdResourceEstimator : public mesos::slave::ResourceEstimator
 {
 public:
   ThresholdResourceEstimator(
-    std::function<Try<::os::Load>()> const& load,
-    std::function<Try<os::MemInfo>()> const& memory,
-    mesos::Resources const& totalRevocable,
-    ::os::Load const& loadThreshold,
-    Bytes const& memThreshold);
+    Samplers const& samplers,
+    Configuration const& config);
   virtual Try<Nothing> initialize(const std::function<process::Future<mesos::ResourceUsage>()>&) final;
   virtual process::Future<mesos::Resources> oversubscribable() final;
   virtual ~ThresholdResourceEstimator();
 
 private:
   process::Owned<ThresholdResourceEstimatorProcess> process;
-  std::function<Try<::os::Load>()> const load;
-  std::function<Try<os::MemInfo>()> const memory;
-  mesos::Resources const totalRevocable;
-  ::os::Load const loadThreshold;
-  Bytes const memThreshold;
+  Samplers const samplers;
+  Configuration const config;
 };
 
 } // namespace blue_yonder {
@@ -0,0 +1,173 @@
+#include "checkpoint.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+#include <process/clock.hpp>
+
+#include <gtest/gtest.h>
+
+using process::Clock;
+
+using com::blue_yonder::Checkpoint;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+
+namespace {
+
+struct State
+{
+  double ewma;
+  uint64_t samples;
+};
+
+std::string serialize(State const& state) {
+  std::string buffer;
+  StateWriter writer(buffer);
+  writer.write(state);
+  return buffer;
+}
+
+State deserialize(std::string const& buffer) {
+  State state;
+  StateReader reader(buffer);
+  EXPECT_TRUE(reader.read(state));
+  EXPECT_TRUE(reader.done());
+  return state;
+}
+
+struct CheckpointTests : public ::testing::Test
+{
+  std::string directory;
+  std::string path;
+
+  virtual void SetUp() {
+    directory = os::mkdtemp().get();
+    path = path::join(directory, "state", "test.state");
+  }
+
+  virtual void TearDown() {
+    Clock::resume();
+    os::rmdir(directory);
+  }
+};
+
+TEST_F(CheckpointTests, test_restore_nothing) {
+  auto const checkpoint = Checkpoint::open(path, 1).get();
+  EXPECT_TRUE(checkpoint->restore(Minutes(5)).isNone());
+}
+
+TEST_F(CheckpointTests, test_only_readable_by_owner) {
+  // Left behind by an earlier version
+  ASSERT_TRUE(os::mkdir(path::join(directory, "state")).isSome());
+  ASSERT_TRUE(os::write(path, "").isSome());
+  ASSERT_EQ(0, ::chmod(path.c_str(), 0644));
+
+  Checkpoint::open(path, 1).get();
+  struct stat status;
+  ASSERT_EQ(0, ::stat(path.c_str(), &status));
+  EXPECT_EQ(0600u, status.st_mode & 0777);
+}
+
+TEST_F(CheckpointTests, test_restore_across_reopen) {
+  ASSERT_TRUE(Checkpoint::open(path, 1).get()->save(serialize(State{2.5, 42})).isSome());
+
+  auto const restored = Checkpoint::open(path, 1).get()->restore(Minutes(5));
+  ASSERT_TRUE(restored.isSome());
+  EXPECT_EQ(2.5, deserialize(restored.get()).ewma);
+  EXPECT_EQ(42u, deserialize(restored.get()).samples);
+}
+
+TEST_F(CheckpointTests, test_grows_and_shrinks) {
+  auto const checkpoint = Checkpoint::open(path, 1).get();
+  std::string const large(1024 * 1024, 'x');
+  ASSERT_TRUE(checkpoint->save(large).isSome());
+  EXPECT_EQ(large, Checkpoint::open(path, 1).get()->restore(Minutes(5)).get());
+
+  ASSERT_TRUE(checkpoint->save(serialize(State{2.5, 42})).isSome());
+  EXPECT_EQ(42u, deserialize(Checkpoint::open(path, 1).get()->restore(Minutes(5)).get()).samples);
+}
+
+TEST_F(CheckpointTests, test_ignores_other_version) {
+  Checkpoint::open(path, 1).get()->save(serialize(State{2.5, 42}));
+  EXPECT_TRUE(Checkpoint::open(path, 2).get()->restore(Minutes(5)).isNone());
+}
+
+TEST_F(CheckpointTests, test_ignores_outdated) {
+  Clock::pause();
+  Checkpoint::open(path, 1).get()->save(serialize(State{2.5, 42}));
+  Clock::advance(Minutes(6));
+  EXPECT_TRUE(Checkpoint::open(path, 1).get()->restore(Minutes(5)).isNone());
+  EXPECT_TRUE(Checkpoint::open(path, 1).get()->restore(Minutes(10)).isSome());
+}
+
+TEST_F(CheckpointTests, test_ignores_corrupted) {
+  Checkpoint::open(path, 1).get()->save(serialize(State{2.5, 42}));
+
+  auto content = os::read(path).get();
+  content[sizeof(Checkpoint::Header)] ^= 0xff;
+  os::write(path, content);
+
+  EXPECT_TRUE(Checkpoint::open(path, 1).get()->restore(Minutes(5)).isNone());
+}
+
+TEST_F(CheckpointTests, test_ignores_truncated) {
+  Checkpoint::open(path, 1).get()->save(serialize(State{2.5, 42}));
+
+  auto const content = os::read(path).get();
+  os::write(path, content.substr(0, content.size() - 1));
+
+  EXPECT_TRUE(Checkpoint::open(path, 1).get()->restore(Minutes(5)).isNone());
+}
+
+TEST(StateTests, test_round_trip) {
+  std::string buffer;
+  StateWriter writer(buffer);
+  writer.write(State{2.5, 42});
+  writer.write(std::string("executor"));
+  writer.write(Option<double>(0.25));
+  writer.write(Option<double>(None()));
+  writer.write(std::map<std::string, State>{{"sda", State{1, 2}}, {"sdb", State{3, 4}}});
+
+  StateReader reader(buffer);
+  State state;
+  std::string name;
+  Option<double> some;
+  Option<double> none = 1.0;
+  std::map<std::string, State> map;
+  ASSERT_TRUE(reader.read(state));
+  ASSERT_TRUE(reader.read(name));
+  ASSERT_TRUE(reader.read(some));
+  ASSERT_TRUE(reader.read(none));
+  ASSERT_TRUE(reader.read(map));
+  EXPECT_TRUE(reader.done());
+
+  EXPECT_EQ(42u, state.samples);
+  EXPECT_EQ("executor", name);
+  EXPECT_EQ(0.25, some.get());
+  EXPECT_TRUE(none.isNone());
+  ASSERT_EQ(2u, map.size());
+  EXPECT_EQ(4u, map["sdb"].samples);
+
+  // Nothing is read beyond the end
+  EXPECT_FALSE(reader.read(state));
+}
+
+TEST(StateTests, test_truncated) {
+  std::string buffer;
+  StateWriter writer(buffer);
+  writer.write(std::string("executor"));
+
+  std::string const truncated = buffer.substr(0, buffer.size() - 1);
+  StateReader reader(truncated);
+  std::string name;
+  EXPECT_FALSE(reader.read(name));
+}
+
+} // namespace {
@@ -0,0 +1,371 @@
+#include "config.hpp"
+
+#include <limits>
+#include <set>
+#include <string>
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::Configuration;
+using com::blue_yonder::parseConfiguration;
+using com::blue_yonder::readConfigFile;
+
+namespace {
+
+mesos::Parameters makeParameters(std::vector<std::pair<std::string, std::string>> const& values) {
+  mesos::Parameters parameters;
+  for (auto const& value : values) {
+    auto* parameter = parameters.add_parameter();
+    parameter->set_key(value.first);
+    parameter->set_value(value.second);
+  }
+  return parameters;
+}
+
+struct ConfigFileTests : public ::testing::Test
+{
+  std::string directory;
+  std::string path;
+
+  virtual void SetUp() {
+    directory = os::mkdtemp().get();
+    path = path::join(directory, "thresholds.json");
+  }
+
+  virtual void TearDown() {
+    os::rmdir(directory);
+  }
+};
+
+TEST(ConfigurationTests, test_defaults) {
+  auto const config = parseConfiguration(makeParameters({})).get();
+  EXPECT_TRUE(config.resources.empty());
+  EXPECT_EQ(std::numeric_limits<double>::max(), config.loadThreshold.one);
+  EXPECT_EQ(std::numeric_limits<double>::max(), config.loadThreshold.five);
+  EXPECT_EQ(std::numeric_limits<double>::max(), config.loadThreshold.fifteen);
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), config.memThreshold.bytes());
+  EXPECT_TRUE(config.configFile.isNone());
+  EXPECT_TRUE(config.stateDir.isNone());
+  EXPECT_EQ(Minutes(5), config.stateMaxAge);
+}
+
+TEST(ConfigurationTests, test_parse_reclaim) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_FALSE(defaults.samplesVmStat());
+
+  auto const config = parseConfiguration(makeParameters({
+    {"pgscan_direct_threshold", "1000"},
+    {"swap_threshold", "50"}})).get();
+  EXPECT_TRUE(config.samplesVmStat());
+  EXPECT_EQ(1000, config.reclaimThreshold.pgscanDirect);
+  EXPECT_EQ(std::numeric_limits<double>::max(), config.reclaimThreshold.pgsteal);
+  EXPECT_EQ(50, config.reclaimThreshold.swap);
+}
+
+TEST(ConfigurationTests, test_parse_io) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_FALSE(defaults.samplesDiskStats());
+  EXPECT_TRUE(defaults.ioDevices.empty());
+
+  auto const config = parseConfiguration(makeParameters({
+    {"io_util_threshold", "0.9"},
+    {"io_devices", "sda, nvme0n1"}})).get();
+  EXPECT_TRUE(config.samplesDiskStats());
+  EXPECT_EQ(0.9, config.ioUtilThreshold);
+  EXPECT_EQ(std::numeric_limits<double>::max(), config.ioQueueDepthThreshold);
+  EXPECT_EQ((std::set<std::string>{"nvme0n1", "sda"}), config.ioDevices);
+}
+
+TEST(ConfigurationTests, test_parse_network) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_FALSE(defaults.samplesNetDev());
+
+  auto const config = parseConfiguration(makeParameters({
+    {"net_tx_threshold", "0.8"},
+    {"net_interfaces", "eth0,bond0"}})).get();
+  EXPECT_TRUE(config.samplesNetDev());
+  EXPECT_EQ(std::numeric_limits<double>::max(), config.netRxThreshold);
+  EXPECT_EQ(0.8, config.netTxThreshold);
+  EXPECT_EQ((std::set<std::string>{"bond0", "eth0"}), config.netInterfaces);
+}
+
+TEST(ConfigurationTests, test_parse_runqueue_delay) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_FALSE(defaults.samplesSchedStat());
+
+  auto const config = parseConfiguration(makeParameters({
+    {"runqueue_delay_threshold", "2.5"}})).get();
+  EXPECT_TRUE(config.samplesSchedStat());
+  EXPECT_EQ(2.5, config.runQueueDelayThreshold);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"runqueue_delay_threshold", "-1"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_cpu_frequency) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_FALSE(defaults.samplesCpuFreq());
+
+  auto const config = parseConfiguration(makeParameters({
+    {"cpu_frequency_threshold", "85"}})).get();
+  EXPECT_TRUE(config.samplesCpuFreq());
+  EXPECT_EQ(85, config.cpuFrequencyThreshold);
+
+  // Turbo frequencies may well be protected
+  EXPECT_EQ(120, parseConfiguration(makeParameters({
+    {"cpu_frequency_threshold", "120"}})).get().cpuFrequencyThreshold);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"cpu_frequency_threshold", "0"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"cpu_frequency_threshold", "-10"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_offer_ramp) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_FALSE(defaults.rampsOffers());
+
+  auto const config = parseConfiguration(makeParameters({
+    {"offer_ramp_increase", "0.1"},
+    {"offer_ramp_decrease", "0.25"}})).get();
+  EXPECT_TRUE(config.rampsOffers());
+  EXPECT_EQ(0.1, config.offerRampIncrease);
+  EXPECT_EQ(0.25, config.offerRampDecrease);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"offer_ramp_increase", "0"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"offer_ramp_decrease", "2"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_headroom) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_TRUE(defaults.headroomPercentile.isNone());
+
+  auto const config = parseConfiguration(makeParameters({
+    {"headroom_percentile", "0.99"},
+    {"headroom_margin", "0.2"},
+    {"headroom_window", "720"}})).get();
+  EXPECT_EQ(0.99, config.headroomPercentile.get());
+  EXPECT_EQ(0.2, config.headroomMargin);
+  EXPECT_EQ(720u, config.headroomWindow);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"headroom_percentile", "99"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"headroom_window", "0"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_memory_victim) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_EQ(Configuration::LARGEST, defaults.memoryVictim);
+  EXPECT_EQ(8u, defaults.memoryGrowthWindow);
+
+  auto const config = parseConfiguration(makeParameters({
+    {"memory_victim", "growth"},
+    {"memory_growth_window", "4"}})).get();
+  EXPECT_EQ(Configuration::GROWTH, config.memoryVictim);
+  EXPECT_EQ(4u, config.memoryGrowthWindow);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"memory_victim", "random"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"memory_growth_window", "1"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"memory_growth_window", "32"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_victim_selection) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_EQ(Configuration::USAGE, defaults.victimSelection);
+  EXPECT_EQ("priority", defaults.priorityLabel);
+  EXPECT_EQ(0.5, defaults.lostWorkMinShare);
+
+  auto const config = parseConfiguration(makeParameters({
+    {"victim_selection", "lost_work"},
+    {"priority_label", "tier"},
+    {"lost_work_min_share", "0.25"}})).get();
+  EXPECT_EQ(Configuration::LOST_WORK, config.victimSelection);
+  EXPECT_EQ("tier", config.priorityLabel);
+  EXPECT_EQ(0.25, config.lostWorkMinShare);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"victim_selection", "oldest"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"lost_work_min_share", "1.5"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"lost_work_min_share", "-0.1"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_memory_protection) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_FALSE(defaults.memoryProtection);
+  EXPECT_EQ("/sys/fs/cgroup/mesos", defaults.cgroupRoot);
+  EXPECT_EQ(Megabytes(64), defaults.memoryHighMin);
+  EXPECT_EQ(1000, defaults.oomScoreAdj);
+
+  auto const config = parseConfiguration(makeParameters({
+    {"memory_protection", "true"},
+    {"revocable_cgroup", "/sys/fs/cgroup/revocable"},
+    {"memory_high_min", "128"},
+    {"oom_score_adj", "500"}})).get();
+  EXPECT_TRUE(config.memoryProtection);
+  EXPECT_EQ("/sys/fs/cgroup/revocable", config.revocableCgroup.get());
+  EXPECT_EQ(Megabytes(128), config.memoryHighMin);
+  EXPECT_EQ(500, config.oomScoreAdj);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"memory_protection", "yes"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"memory_high_min", "-1"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"oom_score_adj", "1001"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_shadow) {
+  auto const defaults = parseConfiguration(makeParameters({})).get();
+  EXPECT_TRUE(defaults.shadow.get() == nullptr);
+
+  auto const config = parseConfiguration(makeParameters({
+    {"load_threshold_1min", "64"},
+    {"mem_threshold", "2048"},
+    {"shadow_load_threshold_1min", "96"}})).get();
+  EXPECT_EQ(64, config.loadThreshold.one);
+  ASSERT_TRUE(config.shadow.get() != nullptr);
+  EXPECT_EQ(96, config.shadow->loadThreshold.one);
+  EXPECT_EQ(Bytes::parse("2048MB").get(), config.shadow->memThreshold);
+  EXPECT_TRUE(config.shadow->shadow.get() == nullptr);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shadow_mem_threshold", "lots"}})).isError());
+
+  // Shared with the live policy
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shadow_io_devices", "sda"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shadow_net_interfaces", "eth0"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shadow_sample_timeout", "1secs"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({
+    {"shadow_state_dir", "/var/lib/mesos/threshold"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shadow_shm_export", "true"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({
+    {"shadow_shadow_mem_threshold", "1024"}})).isError());
+}
+
+TEST_F(ConfigFileTests, test_file_overrides_shadow) {
+  os::write(path, R"({"shadow_mem_threshold": "1024"})");
+
+  auto const config = parseConfiguration(makeParameters({
+    {"mem_threshold", "2048"},
+    {"config_file", path}})).get();
+  EXPECT_EQ(Bytes::parse("2048MB").get(), config.memThreshold);
+  ASSERT_TRUE(config.shadow.get() != nullptr);
+  EXPECT_EQ(Bytes::parse("1024MB").get(), config.shadow->memThreshold);
+}
+
+TEST(ConfigurationTests, test_parse_state) {
+  auto const config = parseConfiguration(makeParameters({
+    {"state_dir", "/var/lib/mesos/threshold"},
+    {"state_max_age", "30secs"}})).get();
+  EXPECT_EQ("/var/lib/mesos/threshold", config.stateDir.get());
+  EXPECT_EQ(Seconds(30), config.stateMaxAge);
+}
+
+TEST(ConfigurationTests, test_parse_trace_dump) {
+  EXPECT_FALSE(parseConfiguration(makeParameters({})).get().traceDump);
+
+  auto const config = parseConfiguration(makeParameters({
+    {"state_dir", "/var/lib/mesos/threshold"},
+    {"trace_dump", "true"}})).get();
+  EXPECT_TRUE(config.traceDump);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"trace_dump", "true"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({
+    {"state_dir", "/var/lib/mesos/threshold"},
+    {"trace_dump", "yes"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_shm_mode) {
+  EXPECT_EQ(0600u, parseConfiguration(makeParameters({})).get().shmMode);
+  EXPECT_EQ(0640u, parseConfiguration(makeParameters({{"shm_mode", "0640"}})).get().shmMode);
+  EXPECT_EQ(0644u, parseConfiguration(makeParameters({{"shm_mode", "644"}})).get().shmMode);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shm_mode", ""}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shm_mode", "rw-r-----"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shm_mode", "0680"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shm_mode", "0750"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shm_mode", "0440"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"shm_mode", "10600"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse_sample_timeout) {
+  EXPECT_EQ(Seconds(5), parseConfiguration(makeParameters({})).get().sampleTimeout);
+
+  auto const config = parseConfiguration(makeParameters({{"sample_timeout", "500ms"}})).get();
+  EXPECT_EQ(Milliseconds(500), config.sampleTimeout);
+
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"sample_timeout", "0secs"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"sample_timeout", "soon"}})).isError());
+}
+
+TEST(ConfigurationTests, test_parse) {
+  auto const config = parseConfiguration(makeParameters({
+    {"resources", "cpus:16;mem:96000"},
+    {"load_threshold_1min", "64"},
+    {"load_threshold_5min", "48"},
+    {"load_threshold_15min", "32"},
+    {"mem_threshold", "200000"}})).get();
+  EXPECT_EQ(16, config.resources.cpus().get());
+  EXPECT_EQ(64, config.loadThreshold.one);
+  EXPECT_EQ(48, config.loadThreshold.five);
+  EXPECT_EQ(32, config.loadThreshold.fifteen);
+  EXPECT_EQ(Bytes::parse("200000MB").get(), config.memThreshold);
+  EXPECT_EQ(5, config.parameters.parameter_size());
+}
+
+TEST(ConfigurationTests, test_invalid) {
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"resources", "cpus:"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"load_threshold_1min", "high"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"load_threshold_5min", "-1"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"mem_threshold", "lots"}})).isError());
+  EXPECT_TRUE(parseConfiguration(makeParameters({{"state_max_age", "forever"}})).isError());
+}
+
+TEST_F(ConfigFileTests, test_file_overrides_parameters) {
+  os::write(path, R"({"load_threshold_1min": "8", "mem_threshold": "1024"})");
+
+  auto const config = parseConfiguration(makeParameters({
+    {"load_threshold_1min", "64"},
+    {"load_threshold_5min", "48"},
+    {"config_file", path}})).get();
+  EXPECT_EQ(8, config.loadThreshold.one);
+  EXPECT_EQ(48, config.loadThreshold.five);
+  EXPECT_EQ(Bytes::parse("1024MB").get(), config.memThreshold);
+  EXPECT_EQ(path, config.configFile.get());
+}
+
+TEST_F(ConfigFileTests, test_file_rejects_startup_parameters) {
+  auto const parameters = makeParameters({{"config_file", path}});
+
+  os::write(path, R"({"config_file": "/somewhere/else.json"})");
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+
+  os::write(path, R"({"state_dir": "/var/lib/mesos/threshold"})");
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+
+  os::write(path, R"({"shm_export": "true"})");
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+
+  os::write(path, R"({"shm_mode": "0640"})");
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+
+  os::write(path, R"({"shadow_state_max_age": "1mins"})");
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+
+  // read on every correction
+  os::write(path, R"({"memory_protection": "true", "cgroup_root": "/sys/fs/cgroup/other"})");
+  auto const config = parseConfiguration(parameters).get();
+  EXPECT_TRUE(config.memoryProtection);
+  EXPECT_EQ("/sys/fs/cgroup/other", config.cgroupRoot);
+}
+
+TEST_F(ConfigFileTests, test_invalid_file) {
+  auto const parameters = makeParameters({{"config_file", path}});
+  EXPECT_TRUE(parseConfiguration(parameters).isError()); // missing
+
+  os::write(path, "{");
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+
+  os::write(path, R"({"load_threshold_1min": 8})");
+  EXPECT_TRUE(readConfigFile(path).isError());
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+
+  os::write(path, R"({"load_threshold_1min": "-8"})");
+  EXPECT_TRUE(parseConfiguration(parameters).isError());
+}
+
+} // namespace {
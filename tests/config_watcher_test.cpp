@@ -0,0 +1,120 @@
+#include "config_watcher.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::ConfigWatcher;
+
+namespace {
+
+struct ConfigWatcherTests : public ::testing::Test
+{
+  std::string directory;
+  std::string path;
+  std::atomic<int> changes;
+  std::atomic<int> failures;
+
+  virtual void SetUp() {
+    directory = os::mkdtemp().get();
+    path = path::join(directory, "thresholds.json");
+    changes = 0;
+    failures = 0;
+  }
+
+  virtual void TearDown() {
+    os::rmdir(directory);
+  }
+
+  // Waits up to 10 seconds for the given number of changes.
+  bool awaitChanges(int expected) {
+    for (int i = 0; i < 1000 && changes < expected; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return changes >= expected;
+  }
+
+  // Waits up to 10 seconds for the given number of failures.
+  bool awaitFailures(int expected) {
+    for (int i = 0; i < 1000 && failures < expected; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return failures >= expected;
+  }
+};
+
+TEST_F(ConfigWatcherTests, test_write) {
+  os::write(path, "{}");
+  ConfigWatcher watcher(path, [this]() { ++changes; });
+
+  os::write(path, R"({"mem_threshold": "1024"})");
+  EXPECT_TRUE(awaitChanges(1));
+}
+
+TEST_F(ConfigWatcherTests, test_rename) {
+  ConfigWatcher watcher(path, [this]() { ++changes; });
+
+  auto const temporary = path::join(directory, "thresholds.json.tmp");
+  os::write(temporary, R"({"mem_threshold": "1024"})");
+  os::rename(temporary, path);
+  EXPECT_TRUE(awaitChanges(1));
+}
+
+TEST_F(ConfigWatcherTests, test_ignores_other_files) {
+  ConfigWatcher watcher(path, [this]() { ++changes; });
+
+  os::write(path::join(directory, "unrelated.json"), "{}");
+  os::write(path, "{}");
+  EXPECT_TRUE(awaitChanges(1));
+
+  // give any spurious notification a chance to arrive
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(1, changes);
+}
+
+TEST_F(ConfigWatcherTests, test_retries_missing_directory) {
+  auto const subdirectory = path::join(directory, "config");
+  path = path::join(subdirectory, "thresholds.json");
+  ConfigWatcher watcher(
+    path,
+    [this]() { ++changes; },
+    [this]() { ++failures; },
+    Milliseconds(10));
+  EXPECT_TRUE(awaitFailures(2));
+  EXPECT_EQ(0, changes);
+
+  // picks up the file written before the watch was established
+  os::mkdir(subdirectory);
+  os::write(path, "{}");
+  EXPECT_TRUE(awaitChanges(1));
+
+  auto const failed = failures.load();
+  os::write(path, R"({"mem_threshold": "1024"})");
+  EXPECT_TRUE(awaitChanges(2));
+  EXPECT_EQ(failed, failures);
+}
+
+TEST_F(ConfigWatcherTests, test_retries_removed_directory) {
+  auto const subdirectory = path::join(directory, "config");
+  path = path::join(subdirectory, "thresholds.json");
+  os::mkdir(subdirectory);
+  ConfigWatcher watcher(
+    path,
+    [this]() { ++changes; },
+    [this]() { ++failures; },
+    Milliseconds(10));
+
+  os::rmdir(subdirectory);
+  EXPECT_TRUE(awaitFailures(1));
+
+  os::mkdir(subdirectory);
+  os::write(path, "{}");
+  EXPECT_TRUE(awaitChanges(1));
+}
+
+} // namespace {
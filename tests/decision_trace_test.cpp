@@ -0,0 +1,168 @@
+#include "decision_trace.hpp"
+
+#include <csignal>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+#include <gtest/gtest.h>
+
+#include "io_thread.hpp"
+#include "os.hpp"
+
+using com::blue_yonder::DecisionRecord;
+using com::blue_yonder::DecisionTrace;
+using com::blue_yonder::IOThread;
+using com::blue_yonder::os::MemInfo;
+
+namespace {
+
+// Stands in for a SIGUSR2 handler installed before the trace's
+int previousHandlerCalls = 0;
+
+void previousHandler(int) {
+  ++previousHandlerCalls;
+}
+
+void installPreviousHandler() {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = previousHandler;
+  sigemptyset(&action.sa_mask);
+  ASSERT_EQ(0, sigaction(SIGUSR2, &action, nullptr));
+}
+
+DecisionRecord makeRecord(double load) {
+  return DecisionRecord::make(
+    DecisionRecord::CORRECTION,
+    os::Load{load, 0, 0},
+    MemInfo{Bytes::parse("1GB").get(), Bytes::parse("512MB").get()},
+    os::Load{4, 3, 2},
+    Bytes::parse("384MB").get(),
+    3);
+}
+
+DecisionTrace::Header parseHeader(std::string const& data) {
+  DecisionTrace::Header header;
+  memcpy(&header, data.data(), sizeof(header));
+  return header;
+}
+
+DecisionRecord parseRecord(std::string const& data, size_t index) {
+  DecisionRecord record;
+  memcpy(&record, data.data() + sizeof(DecisionTrace::Header) + index * sizeof(record), sizeof(record));
+  return record;
+}
+
+TEST(DecisionRecordTests, test_make) {
+  auto const record = makeRecord(1.5);
+  EXPECT_EQ(DecisionRecord::CORRECTION, record.kind);
+  EXPECT_EQ(DecisionRecord::NONE, record.action);
+  EXPECT_EQ(0, record.flags);
+  EXPECT_EQ(1.5, record.load[0]);
+  EXPECT_EQ(4, record.loadThreshold[0]);
+  EXPECT_EQ(1024u * 1024 * 1024, record.memTotalBytes);
+  EXPECT_EQ(512u * 1024 * 1024, record.memAvailableBytes);
+  EXPECT_EQ(384u * 1024 * 1024, record.memThresholdBytes);
+  EXPECT_EQ(3u, record.executors);
+}
+
+TEST(DecisionRecordTests, test_make_with_errors) {
+  auto const record = DecisionRecord::make(
+    DecisionRecord::ESTIMATION,
+    Error("Injected by Test"),
+    Error("Injected by Test"),
+    os::Load{4, 3, 2},
+    Bytes::parse("384MB").get(),
+    0);
+  EXPECT_EQ(DecisionRecord::LOAD_ERROR | DecisionRecord::MEM_ERROR, record.flags);
+}
+
+TEST(DecisionRecordTests, test_set_victim_truncates) {
+  mesos::ExecutorInfo executor;
+  executor.mutable_framework_id()->set_value("framework");
+  executor.mutable_executor_id()->set_value(std::string(200, 'x'));
+
+  auto record = makeRecord(0);
+  record.setVictim(executor);
+  EXPECT_EQ("framework", std::string(record.frameworkId));
+  EXPECT_EQ(std::string(sizeof(record.executorId) - 1, 'x'), std::string(record.executorId));
+}
+
+TEST(DecisionTraceTests, test_empty) {
+  IOThread io;
+  DecisionTrace trace(None(), io, 4);
+  auto const data = trace.serialize();
+
+  ASSERT_EQ(sizeof(DecisionTrace::Header), data.size());
+  auto const header = parseHeader(data);
+  EXPECT_EQ("THRTRACE", std::string(header.magic, sizeof(header.magic)));
+  EXPECT_EQ(DecisionTrace::VERSION, header.version);
+  EXPECT_EQ(sizeof(DecisionRecord), header.recordSize);
+  EXPECT_EQ(0u, header.records);
+}
+
+TEST(DecisionTraceTests, test_wraps_around) {
+  IOThread io;
+  DecisionTrace trace(None(), io, 4);
+  for (int i = 0; i < 6; ++i) {
+    trace.record(makeRecord(i));
+  }
+  EXPECT_EQ(4u, trace.size());
+
+  auto const data = trace.serialize();
+  ASSERT_EQ(sizeof(DecisionTrace::Header) + 4 * sizeof(DecisionRecord), data.size());
+  EXPECT_EQ(4u, parseHeader(data).records);
+
+  // only the most recent records are kept, oldest first
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(i + 2, parseRecord(data, i).load[0]);
+  }
+}
+
+TEST(DecisionTraceTests, test_dumps_on_signal) {
+  installPreviousHandler();
+  auto const calls = previousHandlerCalls;
+
+  auto const directory = os::mkdtemp().get();
+  auto const path = path::join(directory, "threshold.trace");
+  {
+    IOThread io;
+    DecisionTrace trace(path, io, 4);
+    trace.record(makeRecord(1));
+    ASSERT_EQ(0, raise(SIGUSR2));
+    EXPECT_EQ(calls + 1, previousHandlerCalls);
+    EXPECT_FALSE(os::exists(path));
+    trace.record(makeRecord(2));
+  } // completes the dump
+
+  auto const data = os::read(path);
+  ASSERT_TRUE(data.isSome());
+  ASSERT_EQ(sizeof(DecisionTrace::Header) + 2 * sizeof(DecisionRecord), data.get().size());
+  EXPECT_EQ(2u, parseHeader(data.get()).records);
+  EXPECT_EQ(1, parseRecord(data.get(), 0).load[0]);
+  EXPECT_EQ(2, parseRecord(data.get(), 1).load[0]);
+
+  struct stat status;
+  ASSERT_EQ(0, stat(path.c_str(), &status));
+  EXPECT_EQ(0600u, status.st_mode & 0777);
+
+  // nothing is left behind but the dump
+  EXPECT_EQ(1u, os::ls(directory).get().size());
+  os::rmdir(directory);
+}
+
+TEST(DecisionTraceTests, test_no_dump_without_path) {
+  installPreviousHandler();
+  IOThread io;
+  DecisionTrace trace(None(), io, 4);
+  trace.record(makeRecord(1));
+  ASSERT_EQ(0, raise(SIGUSR2));
+  trace.record(makeRecord(2));
+  EXPECT_EQ(2u, trace.size());
+}
+
+} // namespace {
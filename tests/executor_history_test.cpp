@@ -0,0 +1,227 @@
+#include "checkpoint.hpp"
+#include "executor_history.hpp"
+
+#include "testutils.hpp"
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::ExecutorHistory;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+
+namespace {
+
+void setStatistics(ResourceUsage::Executor* executor, double timestamp, double cpuTime, uint64_t mem) {
+  auto* statistics = executor->mutable_statistics();
+  statistics->set_timestamp(timestamp);
+  statistics->set_cpus_user_time_secs(cpuTime);
+  statistics->set_cpus_system_time_secs(0);
+  statistics->set_mem_total_bytes(mem);
+}
+
+struct ExecutorHistoryTests : public ::testing::Test
+{
+  ResourceUsageFake usage;
+
+  ExecutorHistoryTests() {
+    usage.setMany({"cpus(*):1;mem(*):64", "cpus(*):1;mem(*):64"}, {"cpus(*):1;mem(*):64"});
+  }
+
+  mesos::ExecutorInfo const& info(int index) {
+    return usage.executor(index)->executor_info();
+  }
+
+  // Records `count` snapshots, 10 seconds apart, in which executor 0 uses
+  // one CPU and a growing amount of memory.
+  void record(ExecutorHistory& history, int count) {
+    for (int i = 0; i < count; ++i) {
+      double const timestamp = 10.0 * (snapshots + i);
+      setStatistics(usage.executor(0), timestamp, timestamp, 1000 * (snapshots + i + 1));
+      setStatistics(usage.executor(1), timestamp, 0, 0);
+      setStatistics(usage.executor(2), timestamp, 0, 0);
+      history.update(usage().get());
+    }
+    snapshots += count;
+  }
+
+  int snapshots = 0;
+};
+
+TEST_F(ExecutorHistoryTests, test_rate_and_delta) {
+  ExecutorHistory history{4};
+
+  record(history, 1);
+  EXPECT_EQ(1u, history.samples(info(0)));
+  EXPECT_TRUE(history.rate(info(0), ExecutorHistory::CPU_TIME, 1).isNone());
+  EXPECT_EQ(1000, history.latest(info(0), ExecutorHistory::MEM_BYTES).get());
+
+  record(history, 2);
+  EXPECT_DOUBLE_EQ(1, history.rate(info(0), ExecutorHistory::CPU_TIME, 1).get());
+  EXPECT_DOUBLE_EQ(1000, history.delta(info(0), ExecutorHistory::MEM_BYTES, 1).get());
+  EXPECT_DOUBLE_EQ(2000, history.delta(info(0), ExecutorHistory::MEM_BYTES, 10).get());
+}
+
+TEST_F(ExecutorHistoryTests, test_window_wraps_around) {
+  ExecutorHistory history{4};
+
+  record(history, 10);
+  EXPECT_EQ(4u, history.samples(info(0)));
+  EXPECT_EQ(10000, history.latest(info(0), ExecutorHistory::MEM_BYTES).get());
+
+  // Only the last four samples are kept, i.e. 7000 to 10000 bytes
+  EXPECT_DOUBLE_EQ(3000, history.delta(info(0), ExecutorHistory::MEM_BYTES, 10).get());
+  EXPECT_DOUBLE_EQ(7000, history.percentile(info(0), ExecutorHistory::MEM_BYTES, 0).get());
+  EXPECT_DOUBLE_EQ(8000, history.percentile(info(0), ExecutorHistory::MEM_BYTES, 0.5).get());
+  EXPECT_DOUBLE_EQ(10000, history.percentile(info(0), ExecutorHistory::MEM_BYTES, 0.99).get());
+}
+
+TEST_F(ExecutorHistoryTests, test_slope) {
+  ExecutorHistory history{8};
+
+  record(history, 2);
+  EXPECT_TRUE(history.slope(info(0), ExecutorHistory::MEM_BYTES, 4).isNone());
+
+  // 1000 bytes more every 10 seconds, and no change at all
+  record(history, 4);
+  EXPECT_DOUBLE_EQ(100, history.slope(info(0), ExecutorHistory::MEM_BYTES, 4).get());
+  EXPECT_DOUBLE_EQ(0, history.slope(info(1), ExecutorHistory::MEM_BYTES, 4).get());
+
+  // A single drop hardly changes the trend, unlike the delta
+  setStatistics(usage.executor(0), 60, 60, 0);
+  history.update(usage().get());
+  EXPECT_TRUE(history.delta(info(0), ExecutorHistory::MEM_BYTES, 6).isNone());
+  EXPECT_LT(0, history.slope(info(0), ExecutorHistory::MEM_BYTES, 6).get());
+}
+
+TEST_F(ExecutorHistoryTests, test_counter_reset) {
+  ExecutorHistory history{4};
+
+  record(history, 2);
+  setStatistics(usage.executor(0), 20, 1, 0);
+  history.update(usage().get());
+  EXPECT_TRUE(history.rate(info(0), ExecutorHistory::CPU_TIME, 1).isNone());
+}
+
+TEST_F(ExecutorHistoryTests, test_missing_network_statistics) {
+  ExecutorHistory history{4};
+
+  record(history, 2);
+  EXPECT_TRUE(history.latest(info(0), ExecutorHistory::NET_BYTES).isNone());
+  EXPECT_TRUE(history.rate(info(0), ExecutorHistory::NET_BYTES, 1).isNone());
+  EXPECT_TRUE(history.percentile(info(0), ExecutorHistory::NET_BYTES, 0.5).isNone());
+}
+
+TEST_F(ExecutorHistoryTests, test_evicts_absent_executors) {
+  ExecutorHistory history{4};
+
+  record(history, 2);
+  EXPECT_EQ(3u, history.size());
+  auto const terminated = info(0);
+
+  usage.setMany({}, {"cpus(*):1;mem(*):64"});
+  history.update(usage().get());
+  EXPECT_EQ(1u, history.size());
+  EXPECT_EQ(0u, history.samples(terminated));
+
+  // The slots are reused without leaking old samples
+  usage.setMany({"cpus(*):1;mem(*):64"}, {"cpus(*):1;mem(*):64"});
+  history.update(usage().get());
+  EXPECT_EQ(2u, history.size());
+  EXPECT_EQ(1u, history.samples(terminated));
+  EXPECT_TRUE(history.delta(terminated, ExecutorHistory::MEM_BYTES, 1).isNone());
+}
+
+TEST_F(ExecutorHistoryTests, test_memory_limit) {
+  // Room for two executors only
+  ExecutorHistory history{4, Bytes(2 * ExecutorHistory::bytesPerExecutor(4).bytes())};
+  EXPECT_EQ(2u, history.capacity());
+
+  record(history, 3);
+  EXPECT_EQ(2u, history.size());
+  EXPECT_EQ(3u, history.samples(info(0)));
+  EXPECT_EQ(3u, history.samples(info(1)));
+  EXPECT_EQ(0u, history.samples(info(2)));
+  EXPECT_TRUE(history.rate(info(2), ExecutorHistory::CPU_TIME, 1).isNone());
+
+  // Tracked as soon as another executor has terminated
+  usage.setMany({"cpus(*):1;mem(*):64"}, {"cpus(*):1;mem(*):64"});
+  history.update(usage().get());
+  EXPECT_EQ(2u, history.size());
+  EXPECT_EQ(1u, history.samples(info(1)));
+}
+
+TEST_F(ExecutorHistoryTests, test_restore) {
+  ExecutorHistory history{4};
+  record(history, 6);
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  history.save(writer, 4);
+
+  ExecutorHistory restored{4};
+  StateReader reader(buffer);
+  ASSERT_TRUE(restored.restore(reader));
+  EXPECT_TRUE(reader.done());
+  EXPECT_EQ(3u, restored.size());
+  EXPECT_EQ(4u, restored.samples(info(0)));
+  EXPECT_EQ(6000, restored.latest(info(0), ExecutorHistory::MEM_BYTES).get());
+  EXPECT_DOUBLE_EQ(3000, restored.delta(info(0), ExecutorHistory::MEM_BYTES, 10).get());
+  EXPECT_DOUBLE_EQ(3000, restored.percentile(info(0), ExecutorHistory::MEM_BYTES, 0).get());
+
+  // Continues where the saved history left off
+  record(restored, 1);
+  EXPECT_EQ(4u, restored.samples(info(0)));
+  EXPECT_EQ(7000, restored.latest(info(0), ExecutorHistory::MEM_BYTES).get());
+  EXPECT_DOUBLE_EQ(1, restored.rate(info(0), ExecutorHistory::CPU_TIME, 1).get());
+}
+
+TEST_F(ExecutorHistoryTests, test_restore_newest_samples) {
+  ExecutorHistory history{4};
+  record(history, 6);
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  history.save(writer, 2);
+
+  ExecutorHistory restored{4};
+  StateReader reader(buffer);
+  ASSERT_TRUE(restored.restore(reader));
+  EXPECT_EQ(2u, restored.samples(info(0)));
+  EXPECT_EQ(6000, restored.latest(info(0), ExecutorHistory::MEM_BYTES).get());
+  EXPECT_DOUBLE_EQ(1000, restored.delta(info(0), ExecutorHistory::MEM_BYTES, 10).get());
+
+  record(restored, 1);
+  EXPECT_EQ(3u, restored.samples(info(0)));
+  EXPECT_EQ(7000, restored.latest(info(0), ExecutorHistory::MEM_BYTES).get());
+}
+
+TEST_F(ExecutorHistoryTests, test_restore_within_memory_limit) {
+  ExecutorHistory history{4};
+  record(history, 2);
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  history.save(writer, 4);
+
+  ExecutorHistory restored{4, Bytes(2 * ExecutorHistory::bytesPerExecutor(4).bytes())};
+  StateReader reader(buffer);
+  ASSERT_TRUE(restored.restore(reader));
+  EXPECT_EQ(2u, restored.size());
+}
+
+TEST_F(ExecutorHistoryTests, test_restore_fails_for_other_window) {
+  ExecutorHistory history{4};
+  record(history, 2);
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  history.save(writer, 4);
+
+  ExecutorHistory other{8};
+  record(other, 1);
+  StateReader reader(buffer);
+  EXPECT_FALSE(other.restore(reader));
+  EXPECT_EQ(1u, other.samples(info(0)));
+}
+
+} // namespace {
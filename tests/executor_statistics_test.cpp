@@ -0,0 +1,186 @@
+#include "checkpoint.hpp"
+#include "executor_statistics.hpp"
+
+#include "testutils.hpp"
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::ExecutorStatistics;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+
+namespace {
+
+void setStatistics(
+    ResourceUsage::Executor* executor,
+    double timestamp,
+    double cpuTime,
+    uint32_t periods,
+    uint32_t throttled)
+{
+  auto* statistics = executor->mutable_statistics();
+  statistics->set_timestamp(timestamp);
+  statistics->set_cpus_user_time_secs(cpuTime);
+  statistics->set_cpus_system_time_secs(0);
+  statistics->set_cpus_nr_periods(periods);
+  statistics->set_cpus_nr_throttled(throttled);
+}
+
+struct ExecutorStatisticsTests : public ::testing::Test
+{
+  ResourceUsageFake usage;
+  ExecutorStatistics statistics;
+
+  ExecutorStatisticsTests() {
+    // executors 0 and 1 are revocable, 2 and 3 are not
+    usage.setMany({"cpus(*):1;mem(*):64", "cpus(*):2;mem(*):64"}, {"cpus(*):1;mem(*):64", "cpus(*):1;mem(*):64"});
+    for (int i = 0; i < 4; ++i) {
+      setStatistics(usage.executor(i), 100, 0, 0, 0);
+    }
+  }
+};
+
+TEST_F(ExecutorStatisticsTests, test_first_snapshot) {
+  statistics.update(usage().get());
+  EXPECT_TRUE(statistics.nonRevocableThrottling().isNone());
+  EXPECT_TRUE(statistics.cpuUsage(usage.executor(0)->executor_info()).isNone());
+}
+
+TEST_F(ExecutorStatisticsTests, test_throttling_of_non_revocable_only) {
+  statistics.update(usage().get());
+
+  setStatistics(usage.executor(0), 110, 5, 100, 100);
+  setStatistics(usage.executor(2), 110, 5, 100, 30);
+  setStatistics(usage.executor(3), 110, 5, 100, 10);
+  statistics.update(usage().get());
+
+  ASSERT_TRUE(statistics.nonRevocableThrottling().isSome());
+  EXPECT_DOUBLE_EQ(0.2, statistics.nonRevocableThrottling().get());
+}
+
+TEST_F(ExecutorStatisticsTests, test_cpu_usage) {
+  statistics.update(usage().get());
+
+  setStatistics(usage.executor(0), 110, 5, 0, 0);
+  setStatistics(usage.executor(1), 110, 15, 0, 0);
+  statistics.update(usage().get());
+
+  EXPECT_DOUBLE_EQ(0.5, statistics.cpuUsage(usage.executor(0)->executor_info()).get());
+  EXPECT_DOUBLE_EQ(1.5, statistics.cpuUsage(usage.executor(1)->executor_info()).get());
+  EXPECT_TRUE(statistics.nonRevocableThrottling().isNone());
+}
+
+TEST_F(ExecutorStatisticsTests, test_disk_usage) {
+  auto addBytes = [this](int index, double timestamp, uint64_t bytes) {
+    auto* statistics = usage.executor(index)->mutable_statistics();
+    statistics->set_timestamp(timestamp);
+    auto* throttling = statistics->mutable_blkio_statistics()->add_throttling();
+    throttling->mutable_device()->set_major_number(8);
+    throttling->mutable_device()->set_minor_number(index);
+    auto* value = throttling->add_io_service_bytes();
+    value->set_op(mesos::CgroupInfo::Blkio::TOTAL);
+    value->set_value(bytes);
+  };
+
+  addBytes(0, 100, 1000);
+  statistics.update(usage().get());
+
+  usage.executor(0)->mutable_statistics()->clear_blkio_statistics();
+  addBytes(0, 110, 11000);
+  statistics.update(usage().get());
+
+  EXPECT_DOUBLE_EQ(1000, statistics.diskUsage(usage.executor(0)->executor_info()).get());
+}
+
+TEST_F(ExecutorStatisticsTests, test_network_usage) {
+  statistics.update(usage().get());
+
+  auto* reported = usage.executor(0)->mutable_statistics();
+  reported->set_net_rx_bytes(1000);
+  reported->set_net_tx_bytes(2000);
+  statistics.update(usage().get());
+
+  reported->set_timestamp(110);
+  reported->set_net_rx_bytes(11000);
+  reported->set_net_tx_bytes(12000);
+  statistics.update(usage().get());
+
+  EXPECT_DOUBLE_EQ(2000, statistics.networkUsage(usage.executor(0)->executor_info()).get());
+
+  // Executors without network statistics have no network usage
+  EXPECT_TRUE(statistics.networkUsage(usage.executor(1)->executor_info()).isNone());
+}
+
+TEST_F(ExecutorStatisticsTests, test_forgets_terminated_executors) {
+  statistics.update(usage().get());
+  auto const info = usage.executor(0)->executor_info();
+
+  usage.setMany({}, {});
+  statistics.update(usage().get());
+
+  usage.setMany({"cpus(*):1;mem(*):64"}, {});
+  setStatistics(usage.executor(0), 110, 5, 0, 0);
+  statistics.update(usage().get());
+  EXPECT_TRUE(statistics.cpuUsage(info).isNone());
+}
+
+TEST_F(ExecutorStatisticsTests, test_age) {
+  EXPECT_TRUE(statistics.age(usage.executor(0)->executor_info()).isNone());
+
+  statistics.update(usage().get());
+  EXPECT_DOUBLE_EQ(0, statistics.age(usage.executor(0)->executor_info()).get());
+
+  // The age is not limited to the samples in the window
+  for (int i = 1; i <= 40; ++i) {
+    setStatistics(usage.executor(0), 100 + 10 * i, 0, 0, 0);
+    statistics.update(usage().get());
+  }
+  EXPECT_DOUBLE_EQ(400, statistics.age(usage.executor(0)->executor_info()).get());
+
+  // A restarted executor starts over
+  auto const info = usage.executor(0)->executor_info();
+  usage.setMany({}, {});
+  statistics.update(usage().get());
+  EXPECT_TRUE(statistics.age(info).isNone());
+
+  usage.setMany({"cpus(*):1;mem(*):64"}, {});
+  setStatistics(usage.executor(0), 600, 0, 0, 0);
+  statistics.update(usage().get());
+  EXPECT_DOUBLE_EQ(0, statistics.age(info).get());
+}
+
+TEST_F(ExecutorStatisticsTests, test_restore) {
+  statistics.update(usage().get());
+  setStatistics(usage.executor(0), 110, 5, 0, 0);
+  setStatistics(usage.executor(2), 110, 5, 100, 30);
+  statistics.update(usage().get());
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  statistics.save(writer);
+
+  ExecutorStatistics restored;
+  StateReader reader(buffer);
+  ASSERT_TRUE(restored.restore(reader));
+  EXPECT_TRUE(reader.done());
+  auto const& info = usage.executor(0)->executor_info();
+  EXPECT_DOUBLE_EQ(10, restored.age(info).get());
+  EXPECT_DOUBLE_EQ(0.5, restored.cpuUsage(info).get());
+  EXPECT_DOUBLE_EQ(0.3, restored.nonRevocableThrottling().get());
+
+  // Ages count from the first snapshot before the restart
+  setStatistics(usage.executor(0), 120, 10, 0, 0);
+  setStatistics(usage.executor(2), 120, 10, 200, 40);
+  restored.update(usage().get());
+  EXPECT_DOUBLE_EQ(20, restored.age(info).get());
+  EXPECT_DOUBLE_EQ(0.1, restored.nonRevocableThrottling().get());
+
+  // A truncated state is not restored at all
+  std::string const truncated = buffer.substr(0, buffer.size() - 1);
+  StateReader truncatedReader(truncated);
+  ExecutorStatistics untouched;
+  EXPECT_FALSE(untouched.restore(truncatedReader));
+  EXPECT_TRUE(untouched.age(info).isNone());
+}
+
+} // namespace {
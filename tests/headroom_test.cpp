@@ -0,0 +1,151 @@
+#include "checkpoint.hpp"
+#include "executor_statistics.hpp"
+#include "headroom.hpp"
+
+#include "testutils.hpp"
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::ExecutorStatistics;
+using com::blue_yonder::Headroom;
+using com::blue_yonder::PercentileWindow;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+
+namespace {
+
+TEST(PercentileWindowTests, test_percentile) {
+  PercentileWindow window{4};
+  EXPECT_TRUE(window.percentile(0.5).isNone());
+
+  for (double value : {5, 1, 4, 2, 3}) {
+    window.add(value);
+  }
+
+  // The first value has been overwritten
+  EXPECT_EQ(4u, window.size());
+  EXPECT_EQ(1, window.percentile(0).get());
+  EXPECT_EQ(2, window.percentile(0.5).get());
+  EXPECT_EQ(4, window.percentile(0.99).get());
+}
+
+struct HeadroomTests : public ::testing::Test
+{
+  ResourceUsageFake usage;
+  ExecutorStatistics statistics;
+  Headroom headroom{4};
+
+  HeadroomTests() {
+    usage.setMany({"cpus(*):1;mem(*):64"}, {"cpus(*):4;mem(*):1024"});
+    usage.setTotal("cpus(*):8;mem(*):2048");
+  }
+
+  void record(double timestamp, double cpuTime, Bytes const& mem) {
+    auto* executor = usage.executor(1)->mutable_statistics();
+    executor->set_timestamp(timestamp);
+    executor->set_cpus_user_time_secs(cpuTime);
+    executor->set_cpus_system_time_secs(0);
+    executor->set_mem_total_bytes(mem.bytes());
+
+    // The revocable executor never counts
+    usage.executor(0)->mutable_statistics()->set_mem_total_bytes(Gigabytes(64).bytes());
+
+    statistics.update(usage().get());
+    headroom.update(usage().get(), statistics);
+  }
+
+  // Non-revocable usage of 0, 2, 4 and 2 CPUs with a memory peak of 1 GB
+  void recordPeak() {
+    record(0, 0, Megabytes(512));
+    record(10, 20, Megabytes(512));
+    record(20, 60, Megabytes(1024));
+    record(30, 80, Megabytes(512));
+  }
+};
+
+TEST_F(HeadroomTests, test_reserved) {
+  EXPECT_TRUE(headroom.reservedCpus(0.99, 0.5).isNone());
+
+  recordPeak();
+  EXPECT_DOUBLE_EQ(6, headroom.reservedCpus(0.99, 0.5).get());
+  EXPECT_DOUBLE_EQ(3, headroom.reservedCpus(0.5, 0.5).get());
+  EXPECT_EQ(Megabytes(1536), headroom.reservedMem(0.99, 0.5).get());
+}
+
+TEST_F(HeadroomTests, test_limit) {
+  recordPeak();
+  auto const offerable = Resources::parse("cpus(*):4;mem(*):1024;disk(*):100").get();
+
+  auto const limited = headroom.limit(offerable, usage().get(), 0.99, 0.5);
+  EXPECT_DOUBLE_EQ(2, limited.cpus().get());
+  EXPECT_EQ(Megabytes(512), limited.mem().get());
+  EXPECT_EQ(Megabytes(100), limited.disk().get());
+
+  // Never more than offerable
+  auto const quiet = headroom.limit(offerable, usage().get(), 0, 0);
+  EXPECT_DOUBLE_EQ(4, quiet.cpus().get());
+  EXPECT_EQ(Megabytes(1024), quiet.mem().get());
+}
+
+TEST_F(HeadroomTests, test_unknown_capacity) {
+  recordPeak();
+  usage.setMany({}, {"cpus(*):4;mem(*):1024"});
+  auto const offerable = Resources::parse("cpus(*):4;mem(*):1024").get();
+
+  EXPECT_EQ(offerable, headroom.limit(offerable, usage().get(), 0.99, 0.5));
+}
+
+TEST(PercentileWindowTests, test_restore) {
+  PercentileWindow window{4};
+  for (double value : {5, 1, 4, 2, 3}) {
+    window.add(value);
+  }
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  window.save(writer);
+
+  PercentileWindow restored{4};
+  StateReader reader(buffer);
+  ASSERT_TRUE(restored.restore(reader));
+  EXPECT_TRUE(reader.done());
+  EXPECT_EQ(4u, restored.size());
+  EXPECT_EQ(1, restored.percentile(0).get());
+  EXPECT_EQ(4, restored.percentile(0.99).get());
+
+  // The oldest values are overwritten first
+  restored.add(0);
+  restored.add(0);
+  EXPECT_EQ(3, restored.percentile(0.99).get());
+
+  // Only the most recent values fit into a shorter window
+  PercentileWindow shorter{2};
+  StateReader again(buffer);
+  ASSERT_TRUE(shorter.restore(again));
+  EXPECT_EQ(2u, shorter.size());
+  EXPECT_EQ(2, shorter.percentile(0).get());
+  EXPECT_EQ(3, shorter.percentile(1).get());
+}
+
+TEST_F(HeadroomTests, test_restore) {
+  recordPeak();
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  headroom.save(writer);
+
+  Headroom restored{4};
+  StateReader reader(buffer);
+  ASSERT_TRUE(restored.restore(reader));
+  EXPECT_TRUE(reader.done());
+  EXPECT_DOUBLE_EQ(6, restored.reservedCpus(0.99, 0.5).get());
+  EXPECT_EQ(Megabytes(1536), restored.reservedMem(0.99, 0.5).get());
+
+  std::string const truncated = buffer.substr(0, buffer.size() - 1);
+  StateReader truncatedReader(truncated);
+  Headroom untouched{4};
+  EXPECT_FALSE(untouched.restore(truncatedReader));
+  EXPECT_TRUE(untouched.reservedCpus(0.99, 0.5).isNone());
+}
+
+} // namespace {
@@ -0,0 +1,138 @@
+#include "host_state.hpp"
+#include "host_state_export.hpp"
+
+#include "decision_trace.hpp"
+#include "os.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::DecisionRecord;
+using com::blue_yonder::HostState;
+using com::blue_yonder::HostStateExport;
+using com::blue_yonder::HostStateReader;
+using com::blue_yonder::HostStateSegment;
+using com::blue_yonder::os::MemInfo;
+
+namespace {
+
+struct HostStateTests : public ::testing::Test
+{
+  std::string name;
+
+  virtual void SetUp() {
+    name = "/threshold-host-state-test-" + std::to_string(getpid());
+  }
+
+  virtual void TearDown() {
+    shm_unlink(name.c_str());
+  }
+
+  static DecisionRecord makeRecord(double load) {
+    auto record = DecisionRecord::make(
+      DecisionRecord::CORRECTION,
+      ::os::Load{load, 2, 1},
+      MemInfo{Megabytes(512), Megabytes(300)},
+      ::os::Load{4, 3, 2},
+      Megabytes(384),
+      3);
+    record.flags |= load > 4 ? DecisionRecord::LOAD_EXCEEDED : 0;
+    return record;
+  }
+};
+
+TEST_F(HostStateTests, test_reader_without_segment) {
+  HostStateReader reader;
+  HostState state;
+  EXPECT_FALSE(reader.open(name.c_str()));
+  EXPECT_FALSE(reader.read(state));
+}
+
+TEST_F(HostStateTests, test_nothing_published) {
+  auto const exported = HostStateExport::open(name, 0600).get();
+
+  HostStateReader reader;
+  HostState state;
+  ASSERT_TRUE(reader.open(name.c_str()));
+  EXPECT_FALSE(reader.read(state));
+}
+
+TEST_F(HostStateTests, test_read_latest_state) {
+  auto const exported = HostStateExport::open(name, 0600).get();
+  HostStateReader reader;
+  ASSERT_TRUE(reader.open(name.c_str()));
+
+  exported->publish(makeRecord(3.9));
+  exported->publish(makeRecord(10));
+
+  HostState state;
+  ASSERT_TRUE(reader.read(state));
+  EXPECT_EQ(2u, state.decisions);
+  EXPECT_EQ(10, state.load[0]);
+  EXPECT_EQ(4, state.loadThreshold[0]);
+  EXPECT_EQ(Megabytes(212).bytes(), state.memTotalBytes - state.memAvailableBytes);
+  EXPECT_EQ(3u, state.executors);
+  EXPECT_TRUE(state.flags & HostState::LOAD_EXCEEDED);
+  EXPECT_FALSE(state.flags & HostState::MEM_EXCEEDED);
+}
+
+TEST_F(HostStateTests, test_survives_reopen) {
+  HostStateReader reader;
+  HostState state;
+  {
+    auto const exported = HostStateExport::open(name, 0600).get();
+    exported->publish(makeRecord(3.9));
+    ASSERT_TRUE(reader.open(name.c_str()));
+  }
+
+  // Readers keep their mapping while the module is restarted
+  auto const exported = HostStateExport::open(name, 0600).get();
+  ASSERT_TRUE(reader.read(state));
+  EXPECT_EQ(3.9, state.load[0]);
+
+  exported->publish(makeRecord(5));
+  ASSERT_TRUE(reader.read(state));
+  EXPECT_EQ(5, state.load[0]);
+}
+
+TEST_F(HostStateTests, test_mode) {
+  auto const exported = HostStateExport::open(name, 0600).get();
+  int const fd = shm_open(name.c_str(), O_RDONLY, 0);
+  ASSERT_GE(fd, 0);
+  struct stat status;
+  ASSERT_EQ(0, fstat(fd, &status));
+  EXPECT_EQ(0600u, status.st_mode & 0777);
+
+  // Applied to an existing segment as well
+  HostStateExport::open(name, 0640).get();
+  ASSERT_EQ(0, fstat(fd, &status));
+  EXPECT_EQ(0640u, status.st_mode & 0777);
+  close(fd);
+}
+
+TEST_F(HostStateTests, test_ignores_other_version) {
+  auto const exported = HostStateExport::open(name, 0600).get();
+  exported->publish(makeRecord(3.9));
+
+  int const fd = shm_open(name.c_str(), O_RDWR, 0);
+  ASSERT_GE(fd, 0);
+  auto* segment = static_cast<HostStateSegment*>(
+    mmap(nullptr, sizeof(HostStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+  close(fd);
+  segment->version = HostStateSegment::VERSION + 1;
+
+  HostStateReader reader;
+  EXPECT_FALSE(reader.open(name.c_str()));
+
+  // The module resets a segment of another layout
+  HostStateExport::open(name, 0600).get()->publish(makeRecord(3.9));
+  EXPECT_TRUE(reader.open(name.c_str()));
+  munmap(segment, sizeof(HostStateSegment));
+}
+
+} // namespace {
@@ -0,0 +1,80 @@
+#include "io_thread.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using process::Future;
+
+using com::blue_yonder::IOThread;
+
+namespace {
+
+TEST(IOThreadTests, test_run) {
+  IOThread io;
+  auto const result = io.run<int>([]() { return 42; });
+  EXPECT_EQ(42, result.get());
+}
+
+TEST(IOThreadTests, test_runs_on_dedicated_thread) {
+  IOThread io;
+  auto const caller = std::this_thread::get_id();
+  auto const executor = io.run<std::thread::id>([]() { return std::this_thread::get_id(); });
+  EXPECT_NE(caller, executor.get());
+}
+
+TEST(IOThreadTests, test_preserves_order) {
+  IOThread io;
+  auto const calls = std::make_shared<std::vector<int>>();
+  std::vector<Future<int>> results;
+  for (int i = 0; i < 10; ++i) {
+    results.push_back(io.run<int>([calls, i]() { calls->push_back(i); return i; }));
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, results[i].get());
+  }
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), *calls);
+}
+
+TEST(IOThreadTests, test_completes_pending_calls_on_destruction) {
+  Future<int> result;
+  {
+    IOThread io;
+    io.run<int>([]() { std::this_thread::sleep_for(std::chrono::milliseconds(10)); return 0; });
+    result = io.run<int>([]() { return 1; });
+  }
+  ASSERT_TRUE(result.isReady());
+  EXPECT_EQ(1, result.get());
+}
+
+TEST(IOThreadTests, test_rejects_calls_beyond_capacity) {
+  auto const started = std::make_shared<std::atomic<bool>>(false);
+  auto const released = std::make_shared<std::atomic<bool>>(false);
+
+  IOThread io(2);
+  auto const hanging = io.run<int>([started, released]() {
+    *started = true;
+    while (!*released) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return 0;
+  });
+  while (!*started) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  auto const first = io.run<int>([]() { return 1; });
+  auto const second = io.run<int>([]() { return 2; });
+  auto const rejected = io.run<int>([]() { return 3; });
+  EXPECT_TRUE(rejected.isFailed());
+
+  *released = true;
+  EXPECT_EQ(0, hanging.get());
+  EXPECT_EQ(1, first.get());
+  EXPECT_EQ(2, second.get());
+  EXPECT_EQ(4, io.run<int>([]() { return 4; }).get());
+}
+
+} // namespace {
@@ -0,0 +1,181 @@
+#include "memory_protection.hpp"
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+#include "testutils.hpp"
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::MemoryProtection;
+using com::blue_yonder::applyMemoryProtection;
+using com::blue_yonder::planMemoryProtection;
+using com::blue_yonder::planMemoryReset;
+
+namespace {
+
+struct MemoryProtectionTests : public ::testing::Test
+{
+  ResourceUsageFake usage;
+  Configuration config;
+
+  MemoryProtectionTests() {
+    // Revocable containers use 64 MB each, the non-revocable one 128 MB
+    usage.setMany({"cpus(*):1;mem(*):64", "cpus(*):1;mem(*):64"}, {"cpus(*):1;mem(*):128"});
+    for (int i = 0; i < 3; ++i) {
+      usage.executor(i)->mutable_container_id()->set_value("container_" + std::to_string(i));
+    }
+
+    config.memoryProtection = true;
+    config.cgroupRoot = "/cgroup";
+    config.memThreshold = Megabytes(768);
+  }
+
+  // Half of the host memory is used, which leaves 256 MB to the threshold
+  Try<MemInfo> memory() const {
+    return MemInfo{Megabytes(1024), Megabytes(512)};
+  }
+};
+
+TEST_F(MemoryProtectionTests, test_plan_per_container) {
+  auto const protection = planMemoryProtection(usage().get(), memory(), config);
+
+  // The slack is split among the revocable containers
+  ASSERT_EQ(2u, protection.high.size());
+  EXPECT_EQ("/cgroup/container_0", protection.high[0].first);
+  EXPECT_EQ(Megabytes(192).bytes(), protection.high[0].second);
+  EXPECT_EQ("/cgroup/container_1", protection.high[1].first);
+  EXPECT_EQ(Megabytes(192).bytes(), protection.high[1].second);
+
+  // The parent is protected as well
+  ASSERT_EQ(2u, protection.low.size());
+  EXPECT_EQ("/cgroup/container_2", protection.low[0].first);
+  EXPECT_EQ(Megabytes(128).bytes(), protection.low[0].second);
+  EXPECT_EQ("/cgroup", protection.low[1].first);
+  EXPECT_EQ(Megabytes(128).bytes(), protection.low[1].second);
+
+  EXPECT_EQ(
+    (std::vector<std::string>{"/cgroup/container_0", "/cgroup/container_1"}),
+    protection.revocable);
+  EXPECT_EQ(1000, protection.oomScoreAdj);
+}
+
+TEST_F(MemoryProtectionTests, test_plan_revocable_parent) {
+  config.revocableCgroup = "/cgroup/revocable";
+  auto const protection = planMemoryProtection(usage().get(), memory(), config);
+
+  ASSERT_EQ(1u, protection.high.size());
+  EXPECT_EQ("/cgroup/revocable", protection.high[0].first);
+  EXPECT_EQ(Megabytes(384).bytes(), protection.high[0].second);
+}
+
+TEST_F(MemoryProtectionTests, test_plan_beyond_threshold) {
+  usage.executor(1)->mutable_statistics()->set_mem_total_bytes(Megabytes(192).bytes());
+
+  // The excess of 64 MB is taken from the containers in proportion to their usage
+  config.memThreshold = Megabytes(448);
+  auto const protection = planMemoryProtection(usage().get(), memory(), config);
+  ASSERT_EQ(2u, protection.high.size());
+  EXPECT_EQ(Megabytes(48).bytes(), protection.high[0].second);
+  EXPECT_EQ(Megabytes(144).bytes(), protection.high[1].second);
+
+  // But never below the minimum
+  config.memThreshold = Megabytes(256);
+  auto const floored = planMemoryProtection(usage().get(), memory(), config);
+  ASSERT_EQ(2u, floored.high.size());
+  EXPECT_EQ(Megabytes(64).bytes(), floored.high[0].second);
+  EXPECT_EQ(Megabytes(64).bytes(), floored.high[1].second);
+
+  config.revocableCgroup = "/cgroup/revocable";
+  auto const parent = planMemoryProtection(usage().get(), memory(), config);
+  ASSERT_EQ(1u, parent.high.size());
+  EXPECT_EQ(Megabytes(64).bytes(), parent.high[0].second);
+}
+
+TEST_F(MemoryProtectionTests, test_plan_reset) {
+  auto const applied = planMemoryProtection(usage().get(), memory(), config);
+
+  // The same cgroups are not reset
+  auto same = planMemoryProtection(usage().get(), memory(), config);
+  planMemoryReset(same, applied);
+  EXPECT_TRUE(same.unlimited.empty());
+  EXPECT_TRUE(same.unprotected.empty());
+
+  // A container that is gone is reset
+  usage.setMany({"cpus(*):1;mem(*):64"}, {"cpus(*):1;mem(*):128"});
+  usage.executor(0)->mutable_container_id()->set_value("container_0");
+  usage.executor(1)->mutable_container_id()->set_value("container_3");
+  auto changed = planMemoryProtection(usage().get(), memory(), config);
+  planMemoryReset(changed, applied);
+  EXPECT_EQ(std::vector<std::string>{"/cgroup/container_1"}, changed.unlimited);
+  EXPECT_EQ(std::vector<std::string>{"/cgroup/container_2"}, changed.unprotected);
+
+  // Disabling protection resets everything
+  MemoryProtection disabled = MemoryProtection();
+  planMemoryReset(disabled, applied);
+  EXPECT_EQ(
+    (std::vector<std::string>{"/cgroup/container_0", "/cgroup/container_1"}),
+    disabled.unlimited);
+  EXPECT_EQ((std::vector<std::string>{"/cgroup/container_2", "/cgroup"}), disabled.unprotected);
+  EXPECT_TRUE(disabled.high.empty());
+  EXPECT_TRUE(disabled.revocable.empty());
+}
+
+TEST_F(MemoryProtectionTests, test_plan_without_memory) {
+  auto const protection =
+    planMemoryProtection(usage().get(), Try<MemInfo>(Error("unavailable")), config);
+  EXPECT_TRUE(protection.high.empty());
+  EXPECT_EQ(2u, protection.low.size());
+}
+
+TEST_F(MemoryProtectionTests, test_apply) {
+  auto const directory = os::mkdtemp().get();
+  auto const cgroup = path::join(directory, "cgroup", "container_0");
+  auto const proc = path::join(directory, "proc");
+
+  // Tasks of nested cgroups are adjusted as well, exited ones are skipped
+  ASSERT_TRUE(os::mkdir(path::join(cgroup, "leaf")).isSome());
+  ASSERT_TRUE(os::write(path::join(cgroup, "cgroup.procs"), "").isSome());
+  ASSERT_TRUE(os::write(path::join(cgroup, "leaf", "cgroup.procs"), "123\n456\n").isSome());
+  ASSERT_TRUE(os::mkdir(path::join(proc, "123")).isSome());
+
+  MemoryProtection protection;
+  protection.high.emplace_back(cgroup, 1024);
+  protection.low.emplace_back(path::join(directory, "cgroup"), 2048);
+  protection.revocable.push_back(cgroup);
+  protection.oomScoreAdj = 1000;
+
+  EXPECT_EQ(0u, applyMemoryProtection(protection, proc));
+  EXPECT_EQ("1024", os::read(path::join(cgroup, "memory.high")).get());
+  EXPECT_EQ("2048", os::read(path::join(directory, "cgroup", "memory.low")).get());
+  EXPECT_EQ("1000", os::read(path::join(proc, "123", "oom_score_adj")).get());
+  EXPECT_FALSE(os::exists(path::join(proc, "456")));
+
+  // Failures are counted, the remaining settings are still applied
+  protection.high.emplace(protection.high.begin(), path::join(directory, "missing"), 1024);
+  EXPECT_EQ(1u, applyMemoryProtection(protection, proc));
+
+  os::rmdir(directory);
+}
+
+TEST_F(MemoryProtectionTests, test_apply_reset) {
+  auto const directory = os::mkdtemp().get();
+  auto const cgroup = path::join(directory, "container_0");
+  ASSERT_TRUE(os::mkdir(cgroup).isSome());
+  ASSERT_TRUE(os::write(path::join(cgroup, "memory.high"), "1024").isSome());
+  ASSERT_TRUE(os::write(path::join(cgroup, "memory.low"), "2048").isSome());
+
+  // Cgroups that are gone are skipped
+  MemoryProtection protection = MemoryProtection();
+  protection.unlimited = {cgroup, path::join(directory, "missing")};
+  protection.unprotected = {cgroup, path::join(directory, "missing")};
+
+  EXPECT_EQ(0u, applyMemoryProtection(protection, path::join(directory, "proc")));
+  EXPECT_EQ("max", os::read(path::join(cgroup, "memory.high")).get());
+  EXPECT_EQ("0", os::read(path::join(cgroup, "memory.low")).get());
+  EXPECT_FALSE(os::exists(path::join(directory, "missing")));
+
+  os::rmdir(directory);
+}
+
+} // namespace {
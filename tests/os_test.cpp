@@ -1,8 +1,19 @@
 #include "os.hpp"
 
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 using com::blue_yonder::os::meminfo;
+using com::blue_yonder::os::diskstats;
+using com::blue_yonder::os::netdev;
+using com::blue_yonder::os::parseCpuList;
+using com::blue_yonder::os::parseSchedStat;
+using com::blue_yonder::os::schedstat;
+using com::blue_yonder::os::vmstat;
+
+namespace proc = com::blue_yonder::proc;
 
 TEST(MemoryTests, smoketest) {
   auto const memInfo = meminfo().get();
@@ -12,3 +23,98 @@ TEST(MemoryTests, smoketest) {
 
   EXPECT_LT(memInfo.memAvailable, memInfo.total);
 }
+
+TEST(VmStatTests, smoketest) {
+  auto const first = vmstat().get();
+  auto const second = vmstat().get();
+
+  EXPECT_LT(0, first.timestamp);
+  EXPECT_LE(first.timestamp, second.timestamp);
+  EXPECT_LE(first.pgscanDirect, second.pgscanDirect);
+  EXPECT_LE(first.pgsteal, second.pgsteal);
+  EXPECT_LE(first.pswpout, second.pswpout);
+}
+
+TEST(DiskStatsTests, smoketest) {
+  auto const first = diskstats().get();
+  auto const second = diskstats().get();
+
+  EXPECT_LE(first.timestamp, second.timestamp);
+  for (auto const& device : first.devices) {
+    ASSERT_EQ(1u, second.devices.count(device.first));
+    EXPECT_LE(device.second.ioTicks, second.devices.at(device.first).ioTicks);
+  }
+}
+
+TEST(NetDevTests, smoketest) {
+  auto const first = netdev().get();
+  auto const second = netdev().get();
+
+  EXPECT_LE(first.timestamp, second.timestamp);
+  ASSERT_EQ(1u, first.interfaces.count("lo"));
+  EXPECT_EQ(0u, first.interfaces.at("lo").speed);
+  for (auto const& interface : first.interfaces) {
+    ASSERT_EQ(1u, second.interfaces.count(interface.first));
+    EXPECT_LE(interface.second.rxBytes, second.interfaces.at(interface.first).rxBytes);
+    EXPECT_LE(interface.second.txBytes, second.interfaces.at(interface.first).txBytes);
+  }
+}
+
+TEST(SchedStatTests, smoketest) {
+  auto const first = schedstat().get();
+  auto const second = schedstat().get();
+
+  EXPECT_LE(first.runDelay, second.runDelay);
+  EXPECT_LE(first.timeslices, second.timeslices);
+}
+
+TEST(SchedStatTests, sums_up_all_cpus) {
+  std::string const content =
+    "version 15\n"
+    "timestamp 4297162035\n"
+    "cpu0 0 0 100 50 60 30 9000000 3000000 40\n"
+    "domain0 00000003 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25\n"
+    "cpu1 0 0 100 50 60 30 8000000 2000000 60\n"
+    "domain0 00000003 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25\n";
+  auto const stat = parseSchedStat(proc::View(content)).get();
+
+  EXPECT_EQ(5000000u, stat.runDelay);
+  EXPECT_EQ(100u, stat.timeslices);
+
+  std::string const withoutCpus = "version 15\ntimestamp 4297162035\n";
+  EXPECT_TRUE(parseSchedStat(proc::View(withoutCpus)).isError());
+
+  std::string const truncated = "version 15\ncpu0 0 0 100 50\n";
+  EXPECT_TRUE(parseSchedStat(proc::View(truncated)).isError());
+}
+
+TEST(SchedStatTests, checks_the_version) {
+  std::string const cpus =
+    "timestamp 4297162035\n"
+    "cpu0 0 0 100 50 60 30 9000000 3000000 40\n";
+
+  for (auto const& version : {"version 15\n", "version 16\n", "version 17\n"}) {
+    auto const stat = parseSchedStat(proc::View(version + cpus));
+    ASSERT_TRUE(stat.isSome()) << version;
+    EXPECT_EQ(3000000u, stat.get().runDelay);
+  }
+
+  // Other versions may have moved the counters
+  std::string const older = "version 14\n" + cpus;
+  EXPECT_TRUE(parseSchedStat(proc::View(older)).isError());
+  std::string const newer = "version 18\n" + cpus;
+  EXPECT_TRUE(parseSchedStat(proc::View(newer)).isError());
+  std::string const invalid = "version fifteen\n" + cpus;
+  EXPECT_TRUE(parseSchedStat(proc::View(invalid)).isError());
+  EXPECT_TRUE(parseSchedStat(proc::View(cpus)).isError());
+}
+
+TEST(CpuFreqTests, parses_cpu_lists) {
+  EXPECT_EQ((std::vector<size_t>{0, 1, 2, 3, 8, 10, 11}), parseCpuList("0-3,8,10-11\n").get());
+  EXPECT_EQ((std::vector<size_t>{0}), parseCpuList("0").get());
+  EXPECT_TRUE(parseCpuList("").get().empty());
+
+  EXPECT_TRUE(parseCpuList("3-1").isError());
+  EXPECT_TRUE(parseCpuList("0-1-2").isError());
+  EXPECT_TRUE(parseCpuList("a").isError());
+}
@@ -0,0 +1,311 @@
+#include "checkpoint.hpp"
+#include "config.hpp"
+#include "os.hpp"
+#include "policy.hpp"
+#include "samplers.hpp"
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::Configuration;
+using com::blue_yonder::HostSample;
+using com::blue_yonder::Signals;
+using com::blue_yonder::SignalState;
+using com::blue_yonder::StateReader;
+using com::blue_yonder::StateWriter;
+using com::blue_yonder::os::CpuFreq;
+using com::blue_yonder::os::DiskCounters;
+using com::blue_yonder::os::DiskStats;
+using com::blue_yonder::os::InterfaceCounters;
+using com::blue_yonder::os::MemInfo;
+using com::blue_yonder::os::NetDev;
+using com::blue_yonder::os::SchedStat;
+using com::blue_yonder::os::VmStat;
+
+namespace rules = com::blue_yonder::rules;
+
+namespace {
+
+// Rules with a fixed outcome that count how often they are evaluated
+template <bool result>
+struct Fixed
+{
+  static int evaluations;
+
+  static bool reached(Signals const&, Configuration const&) {
+    ++evaluations;
+    return result;
+  }
+};
+
+template <bool result>
+int Fixed<result>::evaluations = 0;
+
+typedef Fixed<true> Reached;
+typedef Fixed<false> NotReached;
+
+struct PolicyTests : public ::testing::Test
+{
+  Configuration config;
+  Signals signals{
+    ::os::Load{1, 1, 1},
+    MemInfo{Gigabytes(4), Gigabytes(2)},
+    None(),
+    None(),
+    None(),
+    None(),
+    None(),
+    None()};
+
+  PolicyTests() {
+    Reached::evaluations = 0;
+    NotReached::evaluations = 0;
+  }
+};
+
+TEST_F(PolicyTests, test_combinators) {
+  EXPECT_FALSE(rules::AnyOf<>::reached(signals, config));
+  EXPECT_TRUE(rules::AllOf<>::reached(signals, config));
+
+  EXPECT_TRUE((rules::AnyOf<NotReached, Reached>::reached(signals, config)));
+  EXPECT_FALSE((rules::AnyOf<NotReached, NotReached>::reached(signals, config)));
+  EXPECT_TRUE((rules::AllOf<Reached, Reached>::reached(signals, config)));
+  EXPECT_FALSE((rules::AllOf<Reached, NotReached>::reached(signals, config)));
+
+  // Combinations are rules themselves
+  EXPECT_TRUE((rules::AllOf<rules::AnyOf<NotReached, Reached>, Reached>::reached(signals, config)));
+}
+
+TEST_F(PolicyTests, test_combinators_short_circuit) {
+  EXPECT_TRUE((rules::AnyOf<Reached, NotReached>::reached(signals, config)));
+  EXPECT_FALSE((rules::AllOf<NotReached, Reached>::reached(signals, config)));
+
+  EXPECT_EQ(1, Reached::evaluations);
+  EXPECT_EQ(1, NotReached::evaluations);
+}
+
+TEST_F(PolicyTests, test_host_rules) {
+  EXPECT_FALSE(rules::Overload::reached(signals, config));
+
+  config.memThreshold = Gigabytes(2);
+  EXPECT_TRUE(rules::Memory::reached(signals, config));
+  EXPECT_TRUE(rules::HostOverload::reached(signals, config));
+  EXPECT_FALSE(rules::Load::reached(signals, config));
+
+  // Throttling is not a host threshold
+  config.memThreshold = Gigabytes(3);
+  config.throttleRatioThreshold = 0.5;
+  signals.throttling = 0.6;
+  EXPECT_FALSE(rules::HostOverload::reached(signals, config));
+  EXPECT_TRUE(rules::Overload::reached(signals, config));
+}
+
+TEST_F(PolicyTests, test_policy_sets_the_flags_of_its_rules) {
+  config.throttleRatioThreshold = 0.5;
+  signals.throttling = 0.6;
+  config.memThreshold = Gigabytes(2);
+
+  auto const overloads = com::blue_yonder::evaluate(signals, config);
+  EXPECT_TRUE(overloads.memory);
+  EXPECT_TRUE(overloads.throttling);
+  EXPECT_FALSE(overloads.load);
+  EXPECT_FALSE(overloads.io);
+
+  // Flags of rules outside of the policy stay unset
+  auto const host = rules::HostOverload::evaluate(signals, config);
+  EXPECT_TRUE(host.memory);
+  EXPECT_FALSE(host.throttling);
+}
+
+TEST(ConceptTests, test_rules_and_signals) {
+  static_assert(rules::IsRule<Reached>::value, "Fixed rules are rules");
+  static_assert(rules::IsRule<rules::HostOverload>::value, "Policies are rules");
+  static_assert(!rules::IsRule<Signals>::value, "Signals are no rule");
+
+  static_assert(
+    com::blue_yonder::IsSignal<com::blue_yonder::threshold::DiskSignal>::value,
+    "The disk signal can be checkpointed");
+  static_assert(!com::blue_yonder::IsSignal<Signals>::value, "Signals are no stateful signal");
+}
+
+TEST_F(PolicyTests, test_unsampled_signal_never_reached) {
+  // The signal may have been sampled for another policy only, so even a
+  // failure to sample it does not count.
+  signals.reclaim = Try<Option<com::blue_yonder::threshold::ReclaimRates>>(Error("Injected"));
+  EXPECT_FALSE(rules::Reclaim::reached(signals, config));
+
+  config.reclaimThreshold.pgscanDirect = 1000;
+  EXPECT_TRUE(rules::Reclaim::reached(signals, config));
+}
+
+TEST(SignalStateTests, test_update) {
+  Configuration config;
+  SignalState state;
+
+  HostSample sample{
+    ::os::Load{1, 1, 1}, MemInfo{Gigabytes(4), Gigabytes(2)}, None(), None(), None(), None(), None()};
+  auto signals = state.update(sample, 0.25, config);
+  EXPECT_TRUE(signals.reclaim.isNone());
+  EXPECT_TRUE(signals.disk.isNone());
+  EXPECT_TRUE(signals.network.isNone());
+  EXPECT_TRUE(signals.runQueueDelay.isNone());
+  EXPECT_TRUE(signals.frequency.isNone());
+  EXPECT_EQ(0.25, signals.throttling.get());
+
+  // Rates need two samples
+  sample.vmstat = Try<VmStat>(VmStat{0, 0, 0, 0, 0, 0});
+  signals = state.update(sample, None(), config);
+  EXPECT_TRUE(signals.reclaim.get().get().isNone());
+
+  sample.vmstat = Try<VmStat>(VmStat{2, 2000, 0, 0, 0, 0});
+  signals = state.update(sample, None(), config);
+  EXPECT_EQ(1000, signals.reclaim.get().get().get().pgscanDirect);
+}
+
+TEST(SignalStateTests, test_runqueue_delay) {
+  Configuration config;
+  SignalState state;
+
+  HostSample sample{
+    ::os::Load{1, 1, 1}, MemInfo{Gigabytes(4), Gigabytes(2)}, None(), None(), None(), None(), None()};
+  sample.schedstat = Try<SchedStat>(SchedStat{1000000000, 1000});
+  EXPECT_TRUE(state.update(sample, None(), config).runQueueDelay.get().get().isNone());
+
+  // 4 seconds of waiting over 2000 timeslices
+  sample.schedstat = Try<SchedStat>(SchedStat{5000000000, 3000});
+  EXPECT_EQ(2, state.update(sample, None(), config).runQueueDelay.get().get().get());
+
+  // Nobody waits without any timeslices run
+  EXPECT_EQ(0, state.update(sample, None(), config).runQueueDelay.get().get().get());
+
+  // A failed sample starts over
+  sample.schedstat = Try<SchedStat>(Error("Injected"));
+  EXPECT_TRUE(state.update(sample, None(), config).runQueueDelay.get().isError());
+  sample.schedstat = Try<SchedStat>(SchedStat{6000000000, 4000});
+  EXPECT_TRUE(state.update(sample, None(), config).runQueueDelay.get().get().isNone());
+}
+
+TEST(SignalStateTests, test_frequency) {
+  Configuration config;
+  SignalState state;
+
+  HostSample sample{
+    ::os::Load{1, 1, 1},
+    MemInfo{Gigabytes(4), Gigabytes(2)},
+    None(),
+    None(),
+    None(),
+    None(),
+    None()};
+  sample.cpufreq = Try<CpuFreq>(CpuFreq{2000, 2000, 5});
+  EXPECT_TRUE(state.update(sample, None(), config).frequency.get().get().isNone());
+
+  // A single dip does not count
+  sample.cpufreq = Try<CpuFreq>(CpuFreq{1600, 2000, 5});
+  auto frequency = state.update(sample, None(), config).frequency.get().get().get();
+  EXPECT_EQ(100, frequency.percent.get());
+  EXPECT_EQ(0u, frequency.throttleEvents);
+
+  sample.cpufreq = Try<CpuFreq>(CpuFreq{1700, 2000, 7});
+  frequency = state.update(sample, None(), config).frequency.get().get().get();
+  EXPECT_EQ(85, frequency.percent.get());
+  EXPECT_EQ(2u, frequency.throttleEvents);
+
+  config.cpuFrequencyThreshold = 80;
+  Signals signals{
+    ::os::Load{1, 1, 1},
+    MemInfo{Gigabytes(4), Gigabytes(2)},
+    None(),
+    None(),
+    None(),
+    None(),
+    None(),
+    Try<Option<com::blue_yonder::threshold::CpuFrequency>>(frequency)};
+  EXPECT_TRUE(rules::Frequency::reached(signals, config));
+
+  frequency.throttleEvents = 0;
+  signals.frequency = Try<Option<com::blue_yonder::threshold::CpuFrequency>>(frequency);
+  EXPECT_FALSE(rules::Frequency::reached(signals, config));
+
+  config.cpuFrequencyThreshold = 90;
+  EXPECT_TRUE(rules::Frequency::reached(signals, config));
+}
+
+TEST(SignalStateTests, test_frequency_without_nominal) {
+  Configuration config;
+  config.cpuFrequencyThreshold = 90;
+  SignalState state;
+
+  HostSample sample{
+    ::os::Load{1, 1, 1},
+    MemInfo{Gigabytes(4), Gigabytes(2)},
+    None(),
+    None(),
+    None(),
+    None(),
+    Try<CpuFreq>(CpuFreq{2000, 2000, 5})};
+  state.update(sample, None(), config);
+
+  // Without a nominal frequency a low one does not count
+  sample.cpufreq = Try<CpuFreq>(CpuFreq{1000, 0, 5});
+  auto signals = state.update(sample, None(), config);
+  auto const frequency = signals.frequency.get().get().get();
+  EXPECT_TRUE(frequency.percent.isNone());
+  EXPECT_EQ(0u, frequency.throttleEvents);
+  EXPECT_FALSE(rules::Frequency::reached(signals, config));
+
+  sample.cpufreq = Try<CpuFreq>(CpuFreq{1000, 0, 5});
+  signals = state.update(sample, None(), config);
+  EXPECT_FALSE(rules::Frequency::reached(signals, config));
+
+  // But thermal throttling still does
+  sample.cpufreq = Try<CpuFreq>(CpuFreq{1000, 0, 6});
+  signals = state.update(sample, None(), config);
+  EXPECT_EQ(1u, signals.frequency.get().get().get().throttleEvents);
+  EXPECT_TRUE(rules::Frequency::reached(signals, config));
+}
+
+TEST(SignalStateTests, test_restore) {
+  Configuration config;
+  SignalState state;
+
+  HostSample sample{
+    ::os::Load{1, 1, 1},
+    MemInfo{Gigabytes(4), Gigabytes(2)},
+    Try<VmStat>(VmStat{0, 0, 0, 0, 0, 0}),
+    Try<DiskStats>(DiskStats{0, {{"sda", DiskCounters{0, 0}}}}),
+    Try<NetDev>(NetDev{0, {{"eth0", InterfaceCounters{0, 0, 1000}}}}),
+    Try<SchedStat>(SchedStat{1000000000, 1000}),
+    Try<CpuFreq>(CpuFreq{2000, 2000, 5})};
+  state.update(sample, None(), config);
+
+  std::string buffer;
+  StateWriter writer(buffer);
+  state.save(writer);
+
+  SignalState restored;
+  StateReader reader(buffer);
+  ASSERT_TRUE(restored.restore(reader));
+  EXPECT_TRUE(reader.done());
+
+  // All signals continue from the saved samples
+  sample.vmstat = Try<VmStat>(VmStat{2, 2000, 0, 0, 0, 0});
+  sample.diskstats = Try<DiskStats>(DiskStats{1, {{"sda", DiskCounters{500, 1000}}}});
+  sample.netdev = Try<NetDev>(NetDev{1, {{"eth0", InterfaceCounters{1000, 1000, 1000}}}});
+  sample.schedstat = Try<SchedStat>(SchedStat{5000000000, 3000});
+  sample.cpufreq = Try<CpuFreq>(CpuFreq{1700, 2000, 7});
+  auto const signals = restored.update(sample, None(), config);
+  EXPECT_EQ(1000, signals.reclaim.get().get().get().pgscanDirect);
+  EXPECT_DOUBLE_EQ(0.5, signals.disk.get().get().get().utilization);
+  EXPECT_EQ("eth0", signals.network.get().get().get().interface);
+  EXPECT_EQ(2, signals.runQueueDelay.get().get().get());
+  EXPECT_EQ(2u, signals.frequency.get().get().get().throttleEvents);
+
+  // A truncated state is not restored at all
+  std::string const truncated = buffer.substr(0, buffer.size() - 1);
+  StateReader truncatedReader(truncated);
+  SignalState untouched;
+  EXPECT_FALSE(untouched.restore(truncatedReader));
+  EXPECT_TRUE(untouched.update(sample, None(), config).reclaim.get().get().isNone());
+}
+
+} // namespace {
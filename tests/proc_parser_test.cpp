@@ -0,0 +1,349 @@
+#include "proc_parser.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+
+#include <gtest/gtest.h>
+
+#include "os.hpp"
+
+using com::blue_yonder::os::DiskStats;
+using com::blue_yonder::os::NetDev;
+using com::blue_yonder::os::VmStat;
+using com::blue_yonder::os::parseDiskStats;
+using com::blue_yonder::os::parseNetDev;
+using com::blue_yonder::os::parseVmStat;
+
+namespace detail = com::blue_yonder::proc::detail;
+namespace proc = com::blue_yonder::proc;
+
+namespace {
+
+/*
+ * The stream based parsers the `proc` parsers replaced. The parsers must
+ * agree with them on any input generated below.
+ */
+Try<VmStat> referenceVmStat(std::string const& content) {
+  std::istringstream proc{content};
+  std::string identifier;
+  std::string value;
+
+  auto matches = [](std::string const& identifier, std::string const& counter) {
+    return identifier == counter || strings::startsWith(identifier, counter + "_");
+  };
+
+  VmStat stat{0, 0, 0, 0, 0, 0};
+  bool swap = false;
+  while (proc >> identifier >> value) {
+    uint64_t* counter = nullptr;
+    if (matches(identifier, "pgscan_direct") && identifier != "pgscan_direct_throttle") {
+      counter = &stat.pgscanDirect;
+    } else if (matches(identifier, "pgsteal_kswapd") || matches(identifier, "pgsteal_direct")) {
+      counter = &stat.pgsteal;
+    } else if (matches(identifier, "allocstall")) {
+      counter = &stat.allocstall;
+    } else if (identifier == "pswpin") {
+      counter = &stat.pswpin;
+      swap = true;
+    } else if (identifier == "pswpout") {
+      counter = &stat.pswpout;
+    } else {
+      continue;
+    }
+    auto const parsed = numify<uint64_t>(value);
+    if (parsed.isError()) {
+      return Error(parsed.error());
+    }
+    *counter += parsed.get();
+  }
+  if (not swap) {
+    return Error("Could not find pswpin");
+  }
+  return stat;
+}
+
+Try<DiskStats> referenceDiskStats(std::string const& content) {
+  std::istringstream proc{content};
+  DiskStats stats{0, {}};
+  std::string line;
+  while (std::getline(proc, line)) {
+    std::istringstream fields{line};
+    std::string major, minor, name;
+    uint64_t counters[11] = {};
+    fields >> major >> minor >> name;
+    for (auto& counter : counters) {
+      fields >> counter;
+    }
+    if (fields.fail()) {
+      return Error("Failed to parse line '" + line + "'");
+    }
+    stats.devices[name] = {counters[9], counters[10]};
+  }
+  return stats;
+}
+
+Try<NetDev> referenceNetDev(std::string const& content) {
+  std::istringstream proc{content};
+  NetDev stats{0, {}};
+  std::string line;
+  std::getline(proc, line);
+  std::getline(proc, line);
+  while (std::getline(proc, line)) {
+    auto const colon = line.find(':');
+    if (colon == std::string::npos) {
+      return Error("Failed to parse line '" + line + "'");
+    }
+    std::istringstream fields{line.substr(colon + 1)};
+    uint64_t counters[9] = {};
+    for (auto& counter : counters) {
+      fields >> counter;
+    }
+    if (fields.fail()) {
+      return Error("Failed to parse line '" + line + "'");
+    }
+    stats.interfaces[strings::trim(line.substr(0, colon))] = {counters[0], counters[8], 0};
+  }
+  return stats;
+}
+
+/*
+ * Generates random but mostly well-formed content of /proc files. Some
+ * values are invalid or close to overflowing so that the error paths are
+ * exercised as well.
+ */
+class Generator
+{
+public:
+  explicit Generator(uint32_t seed) : random{seed} {}
+
+  // The stream parsers read trailing garbage of the last field as a number,
+  // so invalid values always start with garbage.
+  std::string counter(bool maybeEmpty = true) {
+    switch (random() % 1024) {
+      case 0: return maybeEmpty ? "" : "0";
+      case 1: return "x12";
+      case 2: return "18446744073709551616"; // overflows
+      case 3: return "18446744073709551615";
+      default: return std::to_string(random() % 100000000);
+    }
+  }
+
+  std::string blanks() {
+    return std::string(1 + random() % 3, random() % 8 == 0 ? '\t' : ' ');
+  }
+
+  std::string vmstat() {
+    static char const* const identifiers[] = {
+      "nr_free_pages", "pgscan_direct", "pgscan_direct_normal", "pgscan_direct_throttle",
+      "pgscan_directly", "pgsteal_kswapd", "pgsteal_direct_dma", "pgsteal_anon", "allocstall",
+      "allocstall_movable", "pswpin", "pswpout", "pgfault"};
+    std::string content;
+    for (size_t lines = random() % 40; lines > 0; --lines) {
+      content += identifiers[random() % (sizeof(identifiers) / sizeof(identifiers[0]))];
+      content += " " + counter(false) + "\n";
+    }
+    return content;
+  }
+
+  std::string diskstats() {
+    std::string content;
+    for (size_t lines = random() % 20; lines > 0; --lines) {
+      content += blanks() + std::to_string(random() % 300) + blanks() + std::to_string(random() % 16);
+      content += " sd" + std::string(1, static_cast<char>('a' + random() % 8));
+      for (size_t fields = 11 + random() % 7 - (random() % 50 == 0 ? 2 : 0); fields > 0; --fields) {
+        content += " " + counter();
+      }
+      content += "\n";
+    }
+    return content;
+  }
+
+  std::string netdev() {
+    std::string content =
+      "Inter-|   Receive                                                |  Transmit\n"
+      " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs "
+      "drop fifo colls carrier compressed\n";
+    for (size_t lines = random() % 10; lines > 0; --lines) {
+      content += blanks() + "eth" + std::to_string(random() % 4) + ":";
+      for (size_t fields = 16 - (random() % 50 == 0 ? 8 : 0); fields > 0; --fields) {
+        content += (random() % 2 == 0 ? " " : blanks()) + counter();
+      }
+      content += "\n";
+    }
+    return content;
+  }
+
+  std::mt19937& engine() { return random; }
+
+private:
+  std::mt19937 random;
+};
+
+} // namespace {
+
+
+TEST(ProcParserTests, find_newline_implementations_agree) {
+  Generator generator{1};
+  auto& random = generator.engine();
+
+  for (int i = 0; i < 100000; ++i) {
+    // Random content at a random alignment, with or without newlines
+    std::string buffer(64 + random() % 256, '\0');
+    size_t const offset = random() % 64;
+    size_t const density = 1 + random() % 64;
+    for (size_t j = offset; j < buffer.size(); ++j) {
+      buffer[j] = random() % density == 0 ? '\n' : static_cast<char>(random());
+    }
+    char const* const begin = buffer.data() + offset;
+    char const* const end = buffer.data() + buffer.size();
+
+    auto const* expected = static_cast<char const*>(memchr(begin, '\n', end - begin));
+    if (expected == nullptr) {
+      expected = end;
+    }
+
+    ASSERT_EQ(expected, detail::findNewlineScalar(begin, end));
+    ASSERT_EQ(expected, proc::findNewline(begin, end));
+#if defined(__x86_64__)
+    ASSERT_EQ(expected, detail::findNewlineSse2(begin, end));
+    if (detail::supportsAvx2()) {
+      ASSERT_EQ(expected, detail::findNewlineAvx2(begin, end));
+    }
+#endif
+  }
+}
+
+TEST(ProcParserTests, parse_uint_agrees_with_strtoull) {
+  Generator generator{2};
+  auto& random = generator.engine();
+
+  for (int i = 0; i < 100000; ++i) {
+    // Mostly digits, or numbers close to overflowing
+    std::string value;
+    for (size_t length = random() % 22; length > 0; --length) {
+      value += random() % 32 == 0 ? static_cast<char>(random()) : static_cast<char>('0' + random() % 10);
+    }
+    if (random() % 4 == 0) {
+      value = std::to_string(std::numeric_limits<uint64_t>::max() - random() % 1000);
+      value += random() % 4 == 0 ? "0" : "";
+    }
+
+    // strtoull also accepts leading blanks and signs
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long const expected = strtoull(value.c_str(), &end, 10);
+    bool const valid = !value.empty() && *end == '\0' && errno == 0 &&
+      value.find_first_not_of("0123456789") == std::string::npos;
+
+    uint64_t parsed = 0;
+    ASSERT_EQ(valid, proc::parseUint(proc::View(value), parsed)) << value;
+    if (valid) {
+      ASSERT_EQ(expected, parsed) << value;
+    }
+  }
+}
+
+TEST(ProcParserTests, lines_and_fields) {
+  std::string const content = "a  b\t c\n\n d\n";
+  proc::Lines lines{proc::View(content)};
+  proc::View line;
+
+  ASSERT_TRUE(lines.next(line));
+  proc::Fields fields{line};
+  proc::View field;
+  ASSERT_TRUE(fields.next(field));
+  EXPECT_TRUE(field == "a");
+  ASSERT_TRUE(fields.skip(1));
+  ASSERT_TRUE(fields.next(field));
+  EXPECT_TRUE(field == "c");
+  EXPECT_FALSE(fields.next(field));
+
+  ASSERT_TRUE(lines.next(line));
+  EXPECT_TRUE(line.empty());
+  ASSERT_TRUE(lines.next(line));
+  EXPECT_EQ(" d", line.str());
+  EXPECT_FALSE(lines.next(line));
+}
+
+TEST(ProcParserTests, vmstat_agrees_with_stream_parser) {
+  Generator generator{3};
+  for (int i = 0; i < 5000; ++i) {
+    auto const content = generator.vmstat();
+    auto const expected = referenceVmStat(content);
+    auto const parsed = parseVmStat(proc::View(content), 0);
+
+    ASSERT_EQ(expected.isError(), parsed.isError()) << content;
+    if (parsed.isSome()) {
+      EXPECT_EQ(expected.get().pgscanDirect, parsed.get().pgscanDirect);
+      EXPECT_EQ(expected.get().pgsteal, parsed.get().pgsteal);
+      EXPECT_EQ(expected.get().allocstall, parsed.get().allocstall);
+      EXPECT_EQ(expected.get().pswpin, parsed.get().pswpin);
+      EXPECT_EQ(expected.get().pswpout, parsed.get().pswpout);
+    }
+  }
+}
+
+TEST(ProcParserTests, diskstats_agrees_with_stream_parser) {
+  Generator generator{4};
+  for (int i = 0; i < 5000; ++i) {
+    auto const content = generator.diskstats();
+    auto const expected = referenceDiskStats(content);
+    auto const parsed = parseDiskStats(proc::View(content), 0);
+
+    ASSERT_EQ(expected.isError(), parsed.isError()) << content;
+    if (parsed.isSome()) {
+      ASSERT_EQ(expected.get().devices.size(), parsed.get().devices.size());
+      for (auto const& device : expected.get().devices) {
+        auto const& actual = parsed.get().devices.at(device.first);
+        EXPECT_EQ(device.second.ioTicks, actual.ioTicks);
+        EXPECT_EQ(device.second.timeInQueue, actual.timeInQueue);
+      }
+    }
+  }
+}
+
+TEST(ProcParserTests, netdev_agrees_with_stream_parser) {
+  Generator generator{5};
+  for (int i = 0; i < 5000; ++i) {
+    auto const content = generator.netdev();
+    auto const expected = referenceNetDev(content);
+    auto const parsed = parseNetDev(proc::View(content), 0);
+
+    ASSERT_EQ(expected.isError(), parsed.isError()) << content;
+    if (parsed.isSome()) {
+      ASSERT_EQ(expected.get().interfaces.size(), parsed.get().interfaces.size());
+      for (auto const& interface : expected.get().interfaces) {
+        auto const& actual = parsed.get().interfaces.at(interface.first);
+        EXPECT_EQ(interface.second.rxBytes, actual.rxBytes);
+        EXPECT_EQ(interface.second.txBytes, actual.txBytes);
+      }
+    }
+  }
+}
+
+TEST(ProcParserTests, proc_file_rereads_content) {
+  auto const directory = os::mkdtemp().get();
+  auto const path = path::join(directory, "counters");
+
+  // Larger than the initial buffer
+  std::string const content(10000, 'x');
+  ASSERT_TRUE(os::write(path, content).isSome());
+
+  proc::ProcFile file{path};
+  EXPECT_EQ(content, file.read().get().str());
+
+  ASSERT_TRUE(os::write(path, "short\n").isSome());
+  EXPECT_EQ("short\n", file.read().get().str());
+
+  os::rmdir(directory);
+}
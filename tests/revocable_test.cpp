@@ -0,0 +1,321 @@
+#include "executor_statistics.hpp"
+#include "revocable.hpp"
+#include "threshold_qos_controller.hpp"
+#include "threshold_resource_estimator.hpp"
+
+#include "testutils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using com::blue_yonder::ExecutorStatistics;
+using com::blue_yonder::RevocableExecutors;
+using com::blue_yonder::ThresholdQoSController;
+using com::blue_yonder::ThresholdResourceEstimator;
+using com::blue_yonder::cheapestRevocable;
+using com::blue_yonder::firstRevocable;
+using com::blue_yonder::heaviestRevocable;
+using com::blue_yonder::isRevocable;
+using com::blue_yonder::mostFreed;
+using com::blue_yonder::mostGreedyRevocable;
+using com::blue_yonder::priorityOf;
+
+namespace {
+
+// Allocations of the current thread while `counting` is set, and of all
+// threads while `countingAll` is set
+thread_local bool counting = false;
+thread_local size_t allocations = 0;
+std::atomic<bool> countingAll{false};
+std::atomic<size_t> allAllocations{0};
+
+} // namespace {
+
+void* operator new(std::size_t size) {
+  if (counting) {
+    ++allocations;
+  }
+  if (countingAll.load(std::memory_order_relaxed)) {
+    allAllocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  void* memory = std::malloc(size > 0 ? size : 1);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+// Allocations a single decision may need once the buffers have grown. They
+// only depend on the number of kinds of revocable resources.
+constexpr size_t ALLOCATION_BUDGET = 64;
+
+// Long enough to rule out the small string optimization
+std::string const LONG_ID = "-0123456789abcdef0123456789abcdef";
+
+struct RevocableTests : public ::testing::Test
+{
+  ResourceUsageFake usage;
+  RevocableExecutors revocable;
+  ExecutorStatistics statistics;
+
+  // Creates the given number of revocable and non-revocable executors
+  void create(int count) {
+    std::vector<std::string> revocableAllocated;
+    std::vector<std::string> nonRevocableAllocated;
+    for (int i = 0; i < count; ++i) {
+      revocableAllocated.push_back("cpus(*):1;mem(*):" + std::to_string(64 + i));
+      nonRevocableAllocated.push_back("cpus(*):1;mem(*):64");
+    }
+    usage.setMany(revocableAllocated, nonRevocableAllocated);
+
+    for (int i = 0; i < 2 * count; ++i) {
+      auto* info = usage.executor(i)->mutable_executor_info();
+      info->mutable_framework_id()->set_value(info->framework_id().value() + LONG_ID);
+      info->mutable_executor_id()->set_value(info->executor_id().value() + LONG_ID);
+    }
+  }
+
+  void advance(double timestamp) {
+    for (int i = 0; i < usage().get().executors_size(); ++i) {
+      auto* statistics = usage.executor(i)->mutable_statistics();
+      statistics->set_timestamp(timestamp);
+      statistics->set_cpus_user_time_secs(timestamp * (i + 1) / 100);
+      statistics->set_cpus_nr_periods(static_cast<uint32_t>(timestamp));
+      statistics->set_cpus_nr_throttled(0);
+    }
+  }
+
+  // The parts of a correction that look at every executor
+  void decide(ResourceUsage const& snapshot) {
+    revocable.update(snapshot);
+    statistics.update(snapshot);
+
+    mostGreedyRevocable(revocable);
+    heaviestRevocable(revocable, [this](mesos::ExecutorInfo const& executor) {
+      return statistics.cpuUsage(executor);
+    });
+    heaviestRevocable(revocable, [this](mesos::ExecutorInfo const& executor) {
+      return statistics.diskUsage(executor);
+    });
+    heaviestRevocable(revocable, [this](mesos::ExecutorInfo const& executor) {
+      return statistics.networkUsage(executor);
+    });
+    cheapestRevocable(
+      revocable,
+      0,
+      [](ResourceUsage::Executor const& executor) {
+        return static_cast<double>(executor.statistics().mem_total_bytes());
+      },
+      [this](ResourceUsage::Executor const& executor) {
+        auto const& info = executor.executor_info();
+        return statistics.age(info).getOrElse(0) * (1 + priorityOf(info, "priority"));
+      });
+  }
+
+  // Returns the allocations of a decision after the buffers have grown
+  size_t allocationsPerDecision(int count) {
+    create(count);
+    for (int i = 0; i < 3; ++i) {
+      advance(10 * i);
+      decide(usage().get());
+    }
+
+    advance(100);
+    ResourceUsage const snapshot = usage().get();
+    allocations = 0;
+    counting = true;
+    decide(snapshot);
+    counting = false;
+    return allocations;
+  }
+};
+
+TEST_F(RevocableTests, test_classification) {
+  usage.setMany({"cpus(*):1;mem(*):64", "cpus(*):2;mem(*):128"}, {"cpus(*):1;mem(*):256"});
+  ResourceUsage const snapshot = usage().get();
+  revocable.update(snapshot);
+
+  EXPECT_TRUE(isRevocable(snapshot.executors(0)));
+  EXPECT_FALSE(isRevocable(snapshot.executors(2)));
+  ASSERT_EQ(2u, revocable.executors().size());
+  EXPECT_EQ(&snapshot.executors(0), firstRevocable(revocable));
+
+  // The non-revocable executor uses more memory but is never a victim
+  EXPECT_EQ(&snapshot.executors(1), mostGreedyRevocable(revocable));
+
+  EXPECT_DOUBLE_EQ(3, revocable.allocated().cpus().get());
+  EXPECT_EQ(Megabytes(192), revocable.allocated().mem().get());
+}
+
+TEST_F(RevocableTests, test_no_revocable_executors) {
+  usage.setMany({}, {"cpus(*):1;mem(*):256"});
+  ResourceUsage const snapshot = usage().get();
+  revocable.update(snapshot);
+
+  EXPECT_TRUE(firstRevocable(revocable) == nullptr);
+  EXPECT_TRUE(mostGreedyRevocable(revocable) == nullptr);
+  EXPECT_TRUE(revocable.allocated().empty());
+}
+
+TEST_F(RevocableTests, test_cheapest) {
+  usage.setMany(
+    {"cpus(*):1;mem(*):64", "cpus(*):1;mem(*):128", "cpus(*):1;mem(*):256"},
+    {"cpus(*):1;mem(*):512"});
+  ResourceUsage const snapshot = usage().get();
+  revocable.update(snapshot);
+
+  auto const memory = [](ResourceUsage::Executor const& executor) {
+    return static_cast<double>(executor.statistics().mem_total_bytes());
+  };
+  auto const sameCost = [](ResourceUsage::Executor const&) { return 1.0; };
+
+  // The cheapest of those freeing enough, or the one freeing the most
+  EXPECT_EQ(&snapshot.executors(0), cheapestRevocable(revocable, 0, memory, memory));
+  EXPECT_EQ(&snapshot.executors(1),
+            cheapestRevocable(revocable, Megabytes(100).bytes(), memory, memory));
+  EXPECT_EQ(&snapshot.executors(2), cheapestRevocable(revocable, 0, memory, sameCost));
+  EXPECT_TRUE(cheapestRevocable(revocable, Megabytes(300).bytes(), memory, sameCost) == nullptr);
+}
+
+TEST_F(RevocableTests, test_most_freed) {
+  usage.setMany({"cpus(*):1;mem(*):64", "cpus(*):1;mem(*):128"}, {"cpus(*):1;mem(*):512"});
+  ResourceUsage const snapshot = usage().get();
+  revocable.update(snapshot);
+
+  auto const memory = [](ResourceUsage::Executor const& executor) {
+    return static_cast<double>(executor.statistics().mem_total_bytes());
+  };
+
+  // The non-revocable executor is not considered
+  EXPECT_DOUBLE_EQ(Megabytes(128).bytes(), mostFreed(revocable, memory));
+
+  usage.setMany({}, {"cpus(*):1;mem(*):512"});
+  ResourceUsage const empty = usage().get();
+  revocable.update(empty);
+  EXPECT_DOUBLE_EQ(0, mostFreed(revocable, memory));
+}
+
+TEST_F(RevocableTests, test_priority) {
+  mesos::ExecutorInfo info;
+  EXPECT_EQ(0, priorityOf(info, "priority"));
+
+  auto* label = info.mutable_labels()->add_labels();
+  label->set_key("priority");
+  label->set_value("2.5");
+  EXPECT_EQ(2.5, priorityOf(info, "priority"));
+  EXPECT_EQ(0, priorityOf(info, "tier"));
+
+  label->set_value("high");
+  EXPECT_EQ(0, priorityOf(info, "priority"));
+  label->set_value("-1");
+  EXPECT_EQ(0, priorityOf(info, "priority"));
+}
+
+TEST_F(RevocableTests, test_allocation_budget) {
+  size_t const few = allocationsPerDecision(4);
+  size_t const many = allocationsPerDecision(256);
+
+  EXPECT_LE(few, ALLOCATION_BUDGET);
+  EXPECT_EQ(few, many) << "Allocations of a decision must not grow with the number of executors";
+}
+
+// Whole corrections and estimations of the modules, from sampling the host
+// on the I/O thread to the continuations on the libprocess workers
+struct DecisionAllocationTests : public RevocableTests
+{
+  LoadFake load;
+  MemInfoFake memory;
+  process::Future<ResourceUsage> snapshot;
+
+  DecisionAllocationTests() {
+    load.set(1, 1, 1);
+  }
+
+  // The usage as the agent hands it over, copied before allocations are counted
+  std::function<process::Future<ResourceUsage>()> snapshots() {
+    return [this]() { return snapshot; };
+  }
+
+  /*
+   * Returns the allocations of all threads during a decision once the
+   * buffers have grown, the fewest of a few decisions in case libprocess
+   * happens to allocate for something else meanwhile.
+   */
+  size_t allocationsPerDecision(int count, std::function<void()> const& decide) {
+    create(count);
+    size_t fewest = std::numeric_limits<size_t>::max();
+    for (int i = 0; i < 6; ++i) {
+      advance(10 * i);
+      snapshot = usage();
+      bool const warm = i >= 3;
+      allAllocations = 0;
+      countingAll = warm;
+      decide();
+
+      // Callbacks on the decision, e.g. of the latency timers, may still run
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      countingAll = false;
+      if (warm) {
+        fewest = std::min(fewest, allAllocations.load());
+      }
+    }
+    return fewest;
+  }
+};
+
+TEST_F(DecisionAllocationTests, test_correction) {
+  // Every correction kills, so that a victim is chosen among all executors
+  memory.set("512MB", "0MB");
+  auto const config = makeConfiguration("", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+
+  auto const correct = [this, &config](int count) {
+    ThresholdQoSController controller{Samplers(load, memory), config};
+    controller.initialize(snapshots());
+    size_t kills = 0;
+    size_t const counted = allocationsPerDecision(count, [&controller, &kills]() {
+      kills = controller.corrections().get().size();
+    });
+    EXPECT_EQ(1u, kills);
+    return counted;
+  };
+
+  size_t const few = correct(4);
+  size_t const many = correct(256);
+  EXPECT_EQ(few, many) << "Allocations of a correction must not grow with the number of executors";
+}
+
+TEST_F(DecisionAllocationTests, test_estimation) {
+  memory.set("512MB", "300MB");
+  auto const config =
+    makeConfiguration("cpus(*):512;mem(*):65536", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+
+  auto const estimate = [this, &config](int count) {
+    ThresholdResourceEstimator estimator{Samplers(load, memory), config};
+    estimator.initialize(snapshots());
+    bool offered = false;
+    size_t const counted = allocationsPerDecision(count, [&estimator, &offered]() {
+      offered = !estimator.oversubscribable().get().empty();
+    });
+    EXPECT_TRUE(offered);
+    return counted;
+  };
+
+  size_t const few = estimate(4);
+  size_t const many = estimate(256);
+  EXPECT_EQ(few, many) << "Allocations of an estimation must not grow with the number of executors";
+}
+
+} // namespace {
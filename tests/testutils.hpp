@@ -2,10 +2,14 @@
 
 #include <vector>
 
+#include <stout/json.hpp>
 #include <stout/os.hpp>
+#include "config.hpp"
 #include "os.hpp"
+#include "samplers.hpp"
 
 #include <mesos/resources.hpp>
+#include <process/http.hpp>
 #include <process/process.hpp>
 
 using process::Future;
@@ -13,7 +17,14 @@ using process::Future;
 using mesos::Resources;
 using mesos::ResourceUsage;
 
+using com::blue_yonder::Configuration;
+using com::blue_yonder::Samplers;
+using com::blue_yonder::os::CpuFreq;
 using com::blue_yonder::os::MemInfo;
+using com::blue_yonder::os::DiskStats;
+using com::blue_yonder::os::NetDev;
+using com::blue_yonder::os::SchedStat;
+using com::blue_yonder::os::VmStat;
 
 namespace {
 
@@ -30,6 +41,7 @@ public:
 
     for (auto const& task_resources : revocable_allocated) {
       auto* revocable_executor = value->add_executors();
+      setIds(revocable_executor, "revocable", value->executors_size());
       auto revocable_resources = Resources::parse(task_resources);
       for (auto const& parsed_resource : revocable_resources.get()) {
         auto* mutable_resource = revocable_executor->add_allocated();
@@ -46,6 +58,7 @@ public:
 
     for (auto const& task_resources : non_revocable_allocated) {
       auto* non_revocable_executor = value->add_executors();
+      setIds(non_revocable_executor, "non_revocable", value->executors_size());
       auto non_revocable_resources = Resources::parse(task_resources);
       for (auto const& parsed_resource : non_revocable_resources.get()) {
         auto* mutable_resource = non_revocable_executor->add_allocated();
@@ -72,9 +85,25 @@ public:
     return *value;
   }
 
+  // Allows to adjust the statistics of a single executor after `set`
+  ResourceUsage::Executor* executor(int index) {
+    return value->mutable_executors(index);
+  }
+
+  // Sets the total resources of the agent after `set`
+  void setTotal(std::string const& total) {
+    value->mutable_total()->CopyFrom(Resources::parse(total).get());
+  }
+
 
 
 private:
+  static void setIds(ResourceUsage::Executor* executor, std::string const& prefix, int index) {
+    auto* info = executor->mutable_executor_info();
+    info->mutable_framework_id()->set_value("framework");
+    info->mutable_executor_id()->set_value(prefix + "_" + std::to_string(index));
+  }
+
   std::shared_ptr<ResourceUsage> value;
 };
 
@@ -121,6 +150,174 @@ private:
   std::shared_ptr<Try<MemInfo>> value;
 };
 
+class VmStatFake {
+public:
+  VmStatFake() : value{std::make_shared<Try<VmStat>>(VmStat{0, 0, 0, 0, 0, 0})} {};
+
+  Try<VmStat> operator()() const {
+    return *value;
+  }
+
+  // Advances the clock by the given seconds and adds to the counters
+  void advance(double seconds, uint64_t pgscanDirect, uint64_t pgsteal, uint64_t swap) {
+    VmStat const previous = value->isSome() ? value->get() : VmStat{0, 0, 0, 0, 0, 0};
+    *value = VmStat{
+      previous.timestamp + seconds,
+      previous.pgscanDirect + pgscanDirect,
+      previous.pgsteal + pgsteal,
+      previous.allocstall,
+      previous.pswpin,
+      previous.pswpout + swap};
+  }
+
+  void set_error() {
+    *value = Error("Injected by Test");
+  }
+
+private:
+  std::shared_ptr<Try<VmStat>> value;
+};
+
+class DiskStatsFake {
+public:
+  DiskStatsFake() : value{std::make_shared<Try<DiskStats>>(DiskStats{0, {}})} {};
+
+  Try<DiskStats> operator()() const {
+    return *value;
+  }
+
+  // Advances the clock by the given seconds and adds to the counters of the device
+  void advance(double seconds, std::string const& device, uint64_t ioTicks, uint64_t timeInQueue) {
+    DiskStats stats = value->isSome() ? value->get() : DiskStats{0, {}};
+    stats.timestamp += seconds;
+    stats.devices[device].ioTicks += ioTicks;
+    stats.devices[device].timeInQueue += timeInQueue;
+    *value = stats;
+  }
+
+  void set_error() {
+    *value = Error("Injected by Test");
+  }
+
+private:
+  std::shared_ptr<Try<DiskStats>> value;
+};
+
+class NetDevFake {
+public:
+  NetDevFake() : value{std::make_shared<Try<NetDev>>(NetDev{0, {}})} {};
+
+  Try<NetDev> operator()() const {
+    return *value;
+  }
+
+  void setSpeed(std::string const& interface, uint64_t speed) {
+    NetDev stats = value->isSome() ? value->get() : NetDev{0, {}};
+    stats.interfaces[interface].speed = speed;
+    *value = stats;
+  }
+
+  // Advances the clock by the given seconds and adds to the counters of the interface
+  void advance(double seconds, std::string const& interface, uint64_t rxBytes, uint64_t txBytes) {
+    NetDev stats = value->isSome() ? value->get() : NetDev{0, {}};
+    stats.timestamp += seconds;
+    stats.interfaces[interface].rxBytes += rxBytes;
+    stats.interfaces[interface].txBytes += txBytes;
+    *value = stats;
+  }
+
+  void set_error() {
+    *value = Error("Injected by Test");
+  }
+
+private:
+  std::shared_ptr<Try<NetDev>> value;
+};
+
+class SchedStatFake {
+public:
+  SchedStatFake() : value{std::make_shared<Try<SchedStat>>(SchedStat{0, 0})} {};
+
+  Try<SchedStat> operator()() const {
+    return *value;
+  }
+
+  // Adds the given run queue delay in milliseconds and timeslices to the counters
+  void advance(double runDelay, uint64_t timeslices) {
+    SchedStat const previous = value->isSome() ? value->get() : SchedStat{0, 0};
+    *value = SchedStat{
+      previous.runDelay + static_cast<uint64_t>(runDelay * 1000000),
+      previous.timeslices + timeslices};
+  }
+
+  void set_error() {
+    *value = Error("Injected by Test");
+  }
+
+private:
+  std::shared_ptr<Try<SchedStat>> value;
+};
+
+class CpuFreqFake {
+public:
+  CpuFreqFake() : value{std::make_shared<Try<CpuFreq>>(CpuFreq{100, 100, 0})} {};
+
+  Try<CpuFreq> operator()() const {
+    return *value;
+  }
+
+  // Sets the current frequency in percent of the nominal one
+  void set(uint64_t percent) {
+    CpuFreq const previous = value->isSome() ? value->get() : CpuFreq{100, 100, 0};
+    *value = CpuFreq{percent, 100, previous.throttleEvents};
+  }
+
+  void throttle(uint64_t events) {
+    CpuFreq const previous = value->isSome() ? value->get() : CpuFreq{100, 100, 0};
+    *value = CpuFreq{previous.current, 100, previous.throttleEvents + events};
+  }
+
+  void set_error() {
+    *value = Error("Injected by Test");
+  }
+
+private:
+  std::shared_ptr<Try<CpuFreq>> value;
+};
+
+inline Samplers makeSamplers(
+  LoadFake const& load,
+  MemInfoFake const& memory,
+  VmStatFake const& vmstat)
+{
+  Samplers samplers(load, memory);
+  samplers.vmstat = vmstat;
+  return samplers;
+}
 
+inline Configuration makeConfiguration(
+  std::string const& resources,
+  os::Load const& loadThreshold,
+  Bytes const& memThreshold)
+{
+  Configuration config;
+  config.resources = Resources::parse(resources).get();
+  config.loadThreshold = loadThreshold;
+  config.memThreshold = memThreshold;
+  return config;
+}
+
+/*
+ * Returns the current values of all metrics registered with libprocess.
+ */
+inline JSON::Object metricsSnapshot() {
+  process::UPID const upid("metrics", process::address());
+  auto const response = process::http::get(upid, "snapshot").get();
+  return JSON::parse<JSON::Object>(response.body).get();
+}
+
+inline double metricValue(std::string const& name) {
+  return metricsSnapshot().values[name].as<JSON::Number>().as<double>();
+}
 
 }
@@ -2,10 +2,19 @@
 
 #include "testutils.hpp"
 
+#include <chrono>
+#include <list>
+#include <memory>
+#include <thread>
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
 #include <gtest/gtest.h>
 
 using mesos::Resources;
 
+using com::blue_yonder::parseConfiguration;
 using com::blue_yonder::ThresholdQoSController;
 
 namespace {
@@ -25,11 +34,8 @@ struct ThresholdQoSControllerTests : public ::testing::Test
     load{},
     memory{},
     controller{
-      load,
-      memory,
-      Resources::parse("").get(),
-      loadThreshold,
-      memThreshold}
+      Samplers(load, memory),
+      makeConfiguration("", loadThreshold, memThreshold)}
   {
     controller.initialize(usage);
   }
@@ -100,4 +106,420 @@ TEST_F(ControllerTests, thresholds_exceed_but_no_revocable_tasks) {
   EXPECT_TRUE(corrections.empty());
 }
 
+TEST_F(ControllerTests, metrics) {
+  controller.corrections().get();
+  EXPECT_FLOAT_EQ(3.9, metricValue("threshold_qos_controller/load_1min"));
+  EXPECT_EQ(212 * 1024 * 1024, metricValue("threshold_qos_controller/mem_used_bytes"));
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/load_threshold_exceeded"));
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/mem_threshold_exceeded"));
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/kills/memory"));
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/kills/load"));
+
+  memory.set("512MB", "0MB");
+  controller.corrections().get();
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/mem_threshold_exceeded"));
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/kills/memory"));
+
+  memory.set("512MB", "300MB");
+  load.set(10.0, 2.9, 1.9);
+  controller.corrections().get();
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/load_threshold_exceeded"));
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/kills/load"));
+}
+
+struct ReclaimTests : public ::testing::Test
+{
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  VmStatFake vmstat;
+  ThresholdQoSController controller;
+
+  static Configuration reclaimConfiguration() {
+    auto config = makeConfiguration("", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+    config.reclaimThreshold.pgscanDirect = 1000;
+    return config;
+  }
+
+  ReclaimTests() :
+    usage{},
+    load{},
+    memory{},
+    vmstat{},
+    controller{makeSamplers(load, memory, vmstat), reclaimConfiguration()}
+  {
+    controller.initialize(usage);
+    usage.setMany({"cpus(*):0.5;mem(*):64", "cpus(*):1.0;mem(*):96"}, {"cpus(*):1.5;mem(*):128"});
+    load.set(3.9, 2.9, 1.9);
+    memory.set("512MB", "300MB");
+  }
+};
+
+TEST_F(ReclaimTests, first_sample_never_exceeds) {
+  vmstat.advance(10, 1000000, 0, 0);
+  EXPECT_TRUE(controller.corrections().get().empty());
+}
+
+TEST_F(ReclaimTests, reclaim_exceeded) {
+  controller.corrections().get();
+
+  vmstat.advance(10, 5000, 0, 0);
+  EXPECT_TRUE(controller.corrections().get().empty());
+
+  vmstat.advance(10, 20000, 0, 0);
+  EXPECT_EQ(1u, controller.corrections().get().size());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/reclaim_threshold_exceeded"));
+  EXPECT_EQ(2000, metricValue("threshold_qos_controller/pgscan_direct_rate"));
+}
+
+TEST_F(ReclaimTests, reclaim_not_available) {
+  vmstat.set_error();
+  EXPECT_EQ(1u, controller.corrections().get().size());
+}
+
+// Controllers whose configuration and samplers each test sets up before it
+// starts them, on a host below the load and memory thresholds
+struct ConfiguredControllerTests : public ::testing::Test
+{
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  Configuration config;
+  Samplers samplers;
+  std::unique_ptr<ThresholdQoSController> controller;
+
+  ConfiguredControllerTests() :
+    usage{},
+    load{},
+    memory{},
+    config{makeConfiguration("", os::Load{4, 3, 2}, Bytes::parse("384MB").get())},
+    samplers{load, memory}
+  {
+    load.set(1, 1, 1);
+    memory.set("512MB", "300MB");
+    usage.setMany({"cpus(*):1;mem(*):64", "cpus(*):1;mem(*):64"}, {"cpus(*):2;mem(*):128"});
+  }
+
+  // Replaces a running controller, as a restart of the agent would
+  void start() {
+    controller.reset();
+    controller.reset(new ThresholdQoSController{samplers, config});
+    controller->initialize(usage);
+  }
+
+  std::list<mesos::slave::QoSCorrection> corrections() {
+    return controller->corrections().get();
+  }
+
+  // The statistics of an executor, 10 seconds after the previous ones
+  mesos::ResourceStatistics* advance(int index) {
+    auto* statistics = usage.executor(index)->mutable_statistics();
+    statistics->set_timestamp(statistics->timestamp() + 10);
+    return statistics;
+  }
+
+  void setTimestamps(double timestamp) {
+    for (int index = 0; index < usage().get().executors_size(); ++index) {
+      usage.executor(index)->mutable_statistics()->set_timestamp(timestamp);
+    }
+  }
+};
+
+TEST_F(ConfiguredControllerTests, hanging_sample_does_not_kill) {
+  usage.setMany({"cpus(*):0.5;mem(*):64"}, {"cpus(*):1.5;mem(*):128"});
+  load.set(3.9, 2.9, 1.9);
+  auto const sampled = load;
+  samplers.load = [sampled]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return sampled();
+  };
+  config.sampleTimeout = Milliseconds(50);
+  start();
+
+  // Unlike a failed read of the load, a sample that does not complete in
+  // time tells nothing about the host
+  EXPECT_TRUE(corrections().empty());
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/kills/load"));
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/kills/memory"));
+}
+
+TEST_F(ConfiguredControllerTests, throttling_kills_heaviest_revocable_cpu_consumer) {
+  config.throttleRatioThreshold = 0.25;
+  start();
+
+  auto setStatistics = [this](int index, double cpuTime, uint32_t periods, uint32_t throttled) {
+    auto* statistics = advance(index);
+    statistics->set_cpus_user_time_secs(cpuTime);
+    statistics->set_cpus_nr_periods(periods);
+    statistics->set_cpus_nr_throttled(throttled);
+  };
+
+  EXPECT_TRUE(corrections().empty());
+
+  setStatistics(0, 2, 0, 0);
+  setStatistics(1, 8, 0, 0);
+  setStatistics(2, 10, 100, 10);
+  EXPECT_TRUE(corrections().empty());
+
+  setStatistics(0, 4, 0, 0);
+  setStatistics(1, 18, 0, 0);
+  setStatistics(2, 20, 200, 60);
+  auto const killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_2", killed.front().kill().executor_id().value());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/kills/throttling"));
+}
+
+TEST_F(ConfiguredControllerTests, runqueue_kills_heaviest_revocable_cpu_consumer) {
+  SchedStatFake schedstat;
+  samplers.schedstat = schedstat;
+  config.runQueueDelayThreshold = 5;
+  start();
+
+  EXPECT_TRUE(corrections().empty());
+
+  advance(0)->set_cpus_user_time_secs(2);
+  advance(1)->set_cpus_user_time_secs(8);
+  advance(2)->set_cpus_user_time_secs(10);
+  schedstat.advance(1000, 1000);
+  EXPECT_TRUE(corrections().empty());
+
+  advance(0)->set_cpus_user_time_secs(12);
+  advance(1)->set_cpus_user_time_secs(10);
+  advance(2)->set_cpus_user_time_secs(30);
+  schedstat.advance(8000, 1000);
+  auto const killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_1", killed.front().kill().executor_id().value());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/kills/runqueue"));
+}
+
+TEST_F(ConfiguredControllerTests, frequency_kills_heaviest_revocable_cpu_consumer) {
+  CpuFreqFake cpufreq;
+  samplers.cpufreq = cpufreq;
+  config.cpuFrequencyThreshold = 90;
+  start();
+
+  EXPECT_TRUE(corrections().empty());
+
+  advance(0)->set_cpus_user_time_secs(2);
+  advance(1)->set_cpus_user_time_secs(8);
+  advance(2)->set_cpus_user_time_secs(10);
+  EXPECT_TRUE(corrections().empty());
+
+  advance(0)->set_cpus_user_time_secs(12);
+  advance(1)->set_cpus_user_time_secs(10);
+  advance(2)->set_cpus_user_time_secs(30);
+  cpufreq.throttle(1);
+  auto const killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_1", killed.front().kill().executor_id().value());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/kills/frequency"));
+}
+
+TEST_F(ConfiguredControllerTests, network_kills_heaviest_revocable_network_consumer) {
+  NetDevFake interfaces;
+  samplers.netdev = interfaces;
+  config.netRxThreshold = 0.9;
+  start();
+
+  auto setStatistics = [this](int index, uint64_t rxBytes, uint64_t txBytes) {
+    auto* statistics = advance(index);
+    statistics->set_net_rx_bytes(rxBytes);
+    statistics->set_net_tx_bytes(txBytes);
+  };
+
+  interfaces.setSpeed("eth0", 1000);
+  interfaces.advance(10, "eth0", 0, 0);
+  EXPECT_TRUE(corrections().empty());
+
+  setStatistics(0, 100000000, 0);
+  setStatistics(1, 0, 0);
+  setStatistics(2, 0, 0);
+  interfaces.advance(10, "eth0", 0, 0);
+  EXPECT_TRUE(corrections().empty());
+
+  setStatistics(0, 200000000, 0);
+  setStatistics(1, 1000000000, 100000000);
+  setStatistics(2, 100000000, 0);
+  interfaces.advance(10, "eth0", 1200000000, 0);
+  auto const killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_2", killed.front().kill().executor_id().value());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/kills/network"));
+}
+
+TEST_F(ConfiguredControllerTests, memory_growth_kills_fastest_growing_revocable) {
+  usage.setMany({"cpus(*):1;mem(*):256", "cpus(*):1;mem(*):32"}, {"cpus(*):2;mem(*):128"});
+  config.memoryVictim = Configuration::GROWTH;
+  start();
+
+  // The large executor is stable, the small one grows by 8 MB per correction
+  auto grow = [this](int correction) {
+    setTimestamps(10.0 * correction);
+    usage.executor(1)->mutable_statistics()->set_mem_total_bytes(
+      Megabytes(32 + 8 * correction).bytes());
+  };
+
+  for (int correction = 0; correction < 3; ++correction) {
+    grow(correction);
+    EXPECT_TRUE(corrections().empty());
+  }
+
+  grow(3);
+  memory.set("512MB", "0MB");
+  auto const killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_2", killed.front().kill().executor_id().value());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/kills/memory"));
+}
+
+TEST_F(ConfiguredControllerTests, lost_work_kills_youngest_revocable_freeing_enough) {
+  config.victimSelection = Configuration::LOST_WORK;
+  start();
+
+  // The large revocable executor runs for 100 seconds, the small one just started
+  usage.setMany({"cpus(*):1;mem(*):256"}, {"cpus(*):1;mem(*):128"});
+  setTimestamps(0);
+  EXPECT_TRUE(corrections().empty());
+
+  usage.setMany({"cpus(*):1;mem(*):256", "cpus(*):1;mem(*):128"}, {"cpus(*):1;mem(*):128"});
+  setTimestamps(100);
+
+  // Killing either gets the host below the threshold again
+  memory.set("512MB", "0MB");
+  auto killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_2", killed.front().kill().executor_id().value());
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/kills/lost_work_seconds"));
+
+  // Only killing the large one does
+  memory.set("640MB", "0MB");
+  killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_1", killed.front().kill().executor_id().value());
+  EXPECT_EQ(100, metricValue("threshold_qos_controller/kills/lost_work_seconds"));
+}
+
+TEST_F(ConfiguredControllerTests, lost_work_spares_young_executor_freeing_little_cpu) {
+  config.victimSelection = Configuration::LOST_WORK;
+  config.throttleRatioThreshold = 0.25;
+  start();
+
+  auto setStatistics = [this](
+      int index, double timestamp, double cpuTime, uint32_t periods, uint32_t throttled) {
+    auto* statistics = usage.executor(index)->mutable_statistics();
+    statistics->set_timestamp(timestamp);
+    statistics->set_cpus_user_time_secs(cpuTime);
+    statistics->set_cpus_nr_periods(periods);
+    statistics->set_cpus_nr_throttled(throttled);
+  };
+
+  // The busy revocable executor runs for 100 seconds
+  usage.setMany({"cpus(*):1;mem(*):64"}, {"cpus(*):2;mem(*):128"});
+  setStatistics(0, 0, 0, 0, 0);
+  setStatistics(1, 0, 0, 0, 0);
+  EXPECT_TRUE(corrections().empty());
+
+  // The idle one just started
+  usage.setMany({"cpus(*):1;mem(*):64", "cpus(*):1;mem(*):64"}, {"cpus(*):2;mem(*):128"});
+  setStatistics(0, 100, 80, 0, 0);
+  setStatistics(1, 100, 0, 0, 0);
+  setStatistics(2, 100, 100, 100, 0);
+  EXPECT_TRUE(corrections().empty());
+
+  // Killing the young one would free almost nothing
+  setStatistics(0, 110, 88, 0, 0);
+  setStatistics(1, 110, 0.1, 0, 0);
+  setStatistics(2, 110, 110, 200, 60);
+  auto const killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_1", killed.front().kill().executor_id().value());
+  EXPECT_EQ(110, metricValue("threshold_qos_controller/kills/lost_work_seconds"));
+}
+
+TEST_F(ConfiguredControllerTests, lost_work_restores_ages_after_restart) {
+  auto const directory = os::mkdtemp().get();
+  config.victimSelection = Configuration::LOST_WORK;
+  config.stateDir = directory;
+
+  // The large revocable executor is first seen before the agent restarts
+  usage.setMany({"cpus(*):1;mem(*):256"}, {"cpus(*):1;mem(*):128"});
+  setTimestamps(0);
+  start();
+  EXPECT_TRUE(corrections().empty());
+  start();
+
+  // Both would be new to a controller without state and the larger one be killed
+  usage.setMany({"cpus(*):1;mem(*):256", "cpus(*):1;mem(*):128"}, {"cpus(*):1;mem(*):128"});
+  setTimestamps(100);
+  memory.set("512MB", "0MB");
+  auto const killed = corrections();
+  ASSERT_EQ(1u, killed.size());
+  EXPECT_EQ("revocable_2", killed.front().kill().executor_id().value());
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/kills/lost_work_seconds"));
+
+  controller.reset();
+  os::rmdir(directory);
+}
+
+TEST_F(ConfiguredControllerTests, shadow_records_divergence_without_acting) {
+  usage.setMany({"cpus(*):0.5;mem(*):64"}, {"cpus(*):1.5;mem(*):128"});
+  load.set(3.9, 2.9, 1.9);
+
+  // The shadow policy kills on less memory and tolerates more load
+  auto shadow = config;
+  shadow.loadThreshold = os::Load{8, 6, 4};
+  shadow.memThreshold = Bytes::parse("128MB").get();
+  config.shadow = std::make_shared<Configuration const>(shadow);
+  start();
+
+  EXPECT_TRUE(corrections().empty());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/shadow/extra_kills"));
+
+  memory.set("512MB", "500MB");
+  load.set(5, 2.9, 1.9);
+  EXPECT_EQ(1u, corrections().size());
+  EXPECT_EQ(1, metricValue("threshold_qos_controller/shadow/missing_kills"));
+  EXPECT_EQ(0, metricValue("threshold_qos_controller/shadow/other_victims"));
+}
+
+TEST(ControllerReloadTests, reloads_thresholds) {
+  auto const directory = os::mkdtemp().get();
+  auto const path = path::join(directory, "controller.json");
+  os::write(path, R"({"mem_threshold": "384"})");
+
+  mesos::Parameters parameters;
+  auto* parameter = parameters.add_parameter();
+  parameter->set_key("config_file");
+  parameter->set_value(path);
+
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  usage.setMany({"cpus(*):0.5;mem(*):64"}, {"cpus(*):1.5;mem(*):128"});
+  memory.set("512MB", "300MB");
+
+  ThresholdQoSController controller{Samplers(load, memory), parseConfiguration(parameters).get()};
+  controller.initialize(usage);
+  EXPECT_TRUE(controller.corrections().get().empty());
+
+  // lower the threshold below the 212MB in use
+  os::write(path, R"({"mem_threshold": "128"})");
+
+  bool reloaded = false;
+  for (int i = 0; i < 1000 && !reloaded; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    reloaded = controller.corrections().get().size() == 1;
+  }
+  EXPECT_TRUE(reloaded);
+
+  // an invalid configuration is ignored
+  os::write(path, R"({"mem_threshold": "lots"})");
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(1u, controller.corrections().get().size());
+
+  os::rmdir(directory);
+}
+
 } // namespace {
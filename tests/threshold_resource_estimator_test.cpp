@@ -2,6 +2,11 @@
 
 #include "testutils.hpp"
 
+#include <chrono>
+#include <thread>
+
+#include <stout/os.hpp>
+
 #include <gtest/gtest.h>
 
 using mesos::Resources;
@@ -26,11 +31,8 @@ struct ThresholdResourceEstimatorTests : public ::testing::Test
     load{},
     memory{},
     estimator{
-      load,
-      memory,
-      Resources::parse(resources).get(),
-      loadThreshold,
-      memThreshold}
+      Samplers(load, memory),
+      makeConfiguration(resources, loadThreshold, memThreshold)}
   {
     estimator.initialize(usage);
   }
@@ -115,4 +117,335 @@ TEST_F(EstimatorTests, mem_not_available) {
   EXPECT_TRUE(availableResources.empty());
 }
 
+TEST_F(EstimatorTests, metrics) {
+  estimator.oversubscribable().get();
+  EXPECT_EQ(1.0, metricValue("threshold_resource_estimator/offered_revocable_cpus"));
+  EXPECT_EQ(448, metricValue("threshold_resource_estimator/offered_revocable_mem"));
+  EXPECT_EQ(0, metricValue("threshold_resource_estimator/load_threshold_exceeded"));
+
+  load.set(10.0, 2.9, 1.9);
+  estimator.oversubscribable().get();
+  EXPECT_EQ(0, metricValue("threshold_resource_estimator/offered_revocable_cpus"));
+  EXPECT_EQ(0, metricValue("threshold_resource_estimator/offered_revocable_mem"));
+  EXPECT_EQ(1, metricValue("threshold_resource_estimator/load_threshold_exceeded"));
+
+  load.set_error();
+  estimator.oversubscribable().get();
+  EXPECT_EQ(1, metricValue("threshold_resource_estimator/sample_errors"));
+}
+
+TEST(EstimatorReclaimTests, reclaim_exceeded) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  VmStatFake vmstat;
+  usage.set("cpus(*):1.0;mem(*):64", "cpus(*):1.0;mem(*):128");
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.reclaimThreshold.swap = 100;
+  ThresholdResourceEstimator estimator{makeSamplers(load, memory, vmstat), config};
+  estimator.initialize(usage);
+
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  vmstat.advance(10, 0, 0, 500);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  vmstat.advance(10, 0, 0, 1000);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+
+  vmstat.set_error();
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+}
+
+TEST(EstimatorDiskTests, io_util_exceeded_on_selected_device) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  DiskStatsFake disks;
+  usage.set("cpus(*):1.0;mem(*):64", "cpus(*):1.0;mem(*):128");
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.ioUtilThreshold = 0.9;
+  config.ioDevices = {"sdb"};
+  Samplers samplers(load, memory);
+  samplers.diskstats = disks;
+  ThresholdResourceEstimator estimator{samplers, config};
+  estimator.initialize(usage);
+
+  disks.advance(10, "sda", 0, 0);
+  disks.advance(0, "sdb", 0, 0);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  // saturating a device that is not selected is fine
+  disks.advance(10, "sda", 10000, 0);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  disks.advance(10, "sdb", 9500, 0);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_DOUBLE_EQ(0.95, metricValue("threshold_resource_estimator/io_utilization"));
+
+  disks.advance(10, "sdb", 1000, 0);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+}
+
+TEST(EstimatorNetworkTests, tx_exceeded_relative_to_link_speed) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  NetDevFake interfaces;
+  usage.set("cpus(*):1.0;mem(*):64", "cpus(*):1.0;mem(*):128");
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.netTxThreshold = 0.8;
+  Samplers samplers(load, memory);
+  samplers.netdev = interfaces;
+  ThresholdResourceEstimator estimator{samplers, config};
+  estimator.initialize(usage);
+
+  // 1 Gbit/s, i.e. 125 MB/s
+  interfaces.setSpeed("eth0", 1000);
+  interfaces.advance(10, "eth0", 0, 0);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  // interfaces without a known link speed are ignored
+  interfaces.advance(0, "lo", 0, 0);
+  interfaces.advance(10, "lo", 0, 10000000000);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  interfaces.advance(10, "eth0", 100000000, 1100000000);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_DOUBLE_EQ(0.08, metricValue("threshold_resource_estimator/net_rx_utilization"));
+  EXPECT_DOUBLE_EQ(0.88, metricValue("threshold_resource_estimator/net_tx_utilization"));
+
+  interfaces.advance(10, "eth0", 0, 100000000);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+}
+
+TEST(EstimatorRunQueueTests, runqueue_delay_exceeded) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  SchedStatFake schedstat;
+  usage.set("cpus(*):1.0;mem(*):64", "cpus(*):1.0;mem(*):128");
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.runQueueDelayThreshold = 2;
+  Samplers samplers(load, memory);
+  samplers.schedstat = schedstat;
+  ThresholdResourceEstimator estimator{samplers, config};
+  estimator.initialize(usage);
+
+  // the first sample never exceeds
+  schedstat.advance(100000, 1);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  schedstat.advance(1000, 1000);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  // tasks wait even though the load stays below its thresholds
+  schedstat.advance(2500, 1000);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_DOUBLE_EQ(2.5, metricValue("threshold_resource_estimator/runqueue_delay_ms"));
+  EXPECT_EQ(1, metricValue("threshold_resource_estimator/runqueue_threshold_exceeded"));
+
+  schedstat.advance(500, 1000);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  schedstat.set_error();
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+}
+
+TEST(EstimatorFrequencyTests, sustained_frequency_loss) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  CpuFreqFake cpufreq;
+  usage.set("cpus(*):1.0;mem(*):64", "cpus(*):1.0;mem(*):128");
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.cpuFrequencyThreshold = 90;
+  Samplers samplers(load, memory);
+  samplers.cpufreq = cpufreq;
+  ThresholdResourceEstimator estimator{samplers, config};
+  estimator.initialize(usage);
+
+  // the first sample never reaches the threshold
+  cpufreq.set(50);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  // a single dip is tolerated
+  cpufreq.set(100);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+  cpufreq.set(80);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  cpufreq.set(85);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_DOUBLE_EQ(85, metricValue("threshold_resource_estimator/cpu_frequency_percent"));
+  EXPECT_EQ(1, metricValue("threshold_resource_estimator/cpu_frequency_threshold_reached"));
+
+  cpufreq.set(100);
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  // thermal throttling counts regardless of the frequency
+  cpufreq.throttle(3);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_EQ(3, metricValue("threshold_resource_estimator/thermal_throttle_events"));
+
+  EXPECT_FALSE(estimator.oversubscribable().get().empty());
+
+  cpufreq.set_error();
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+}
+
+TEST(EstimatorTimeoutTests, hanging_sample_is_treated_as_failed) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  usage.setMany({}, {"cpus(*):1.0;mem(*):128"});
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto hanging = [load]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return load();
+  };
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.sampleTimeout = Milliseconds(50);
+  ThresholdResourceEstimator estimator{Samplers(hanging, memory), config};
+  estimator.initialize(usage);
+
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+}
+
+TEST(EstimatorRampTests, offers_ramp_up_after_overload) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  usage.setMany({}, {"cpus(*):1.0;mem(*):128"});
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.offerRampIncrease = 0.25;
+  config.offerRampDecrease = 0.5;
+  ThresholdResourceEstimator estimator{Samplers(load, memory), config};
+  estimator.initialize(usage);
+
+  // Slow start
+  auto offered = estimator.oversubscribable().get();
+  EXPECT_EQ(0.5, offered.revocable().cpus().get());
+  EXPECT_EQ(Megabytes(128), offered.revocable().mem().get());
+  EXPECT_EQ(1.0, estimator.oversubscribable().get().revocable().cpus().get());
+  EXPECT_EQ(1.5, estimator.oversubscribable().get().revocable().cpus().get());
+  EXPECT_EQ(2.0, estimator.oversubscribable().get().revocable().cpus().get());
+  EXPECT_EQ(1.0, metricValue("threshold_resource_estimator/offer_fraction"));
+
+  // Only the start of an overload halves the offers
+  load.set(10.0, 2.9, 1.9);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_EQ(0.5, metricValue("threshold_resource_estimator/offer_fraction"));
+
+  load.set(3.9, 2.9, 1.9);
+  EXPECT_EQ(1.5, estimator.oversubscribable().get().revocable().cpus().get());
+  EXPECT_EQ(2.0, estimator.oversubscribable().get().revocable().cpus().get());
+}
+
+TEST(EstimatorHeadroomTests, reserves_non_revocable_peak) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  usage.setMany({}, {"cpus(*):1.0;mem(*):768"});
+  usage.setTotal("cpus(*):4;mem(*):1024");
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.headroomPercentile = 0.99;
+  config.headroomMargin = 0.25;
+  ThresholdResourceEstimator estimator{Samplers(load, memory), config};
+  estimator.initialize(usage);
+
+  // 768 MB plus 25% are reserved out of 1024 MB
+  auto const offered = estimator.oversubscribable().get();
+  EXPECT_EQ(2.0, offered.revocable().cpus().get());
+  EXPECT_EQ(Megabytes(64), offered.revocable().mem().get());
+  EXPECT_EQ(960, metricValue("threshold_resource_estimator/headroom_mem"));
+}
+
+TEST(EstimatorShadowTests, records_divergence_without_acting) {
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  usage.setMany({}, {"cpus(*):1.0;mem(*):128"});
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  // The shadow policy tolerates more load and offers more
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  auto shadow = config;
+  shadow.resources = Resources::parse("cpus(*):3;mem(*):512").get();
+  shadow.loadThreshold = os::Load{8, 6, 4};
+  config.shadow = std::make_shared<Configuration const>(shadow);
+  ThresholdResourceEstimator estimator{Samplers(load, memory), config};
+  estimator.initialize(usage);
+
+  EXPECT_EQ(2.0, estimator.oversubscribable().get().revocable().cpus().get());
+  EXPECT_EQ(3.0, metricValue("threshold_resource_estimator/shadow/offered_revocable_cpus"));
+  EXPECT_EQ(1.0, metricValue("threshold_resource_estimator/shadow/offer_delta_cpus"));
+  EXPECT_EQ(0, metricValue("threshold_resource_estimator/shadow/extra_offers"));
+
+  // Only the live policy cuts its offers
+  load.set(5, 2.9, 1.9);
+  EXPECT_TRUE(estimator.oversubscribable().get().empty());
+  EXPECT_EQ(3.0, metricValue("threshold_resource_estimator/shadow/offered_revocable_cpus"));
+  EXPECT_EQ(1, metricValue("threshold_resource_estimator/shadow/extra_offers"));
+  EXPECT_EQ(0, metricValue("threshold_resource_estimator/shadow/cut_offers"));
+}
+
+TEST(EstimatorShadowTests, restores_shadow_ramp_after_restart) {
+  auto const directory = os::mkdtemp().get();
+  ResourceUsageFake usage;
+  LoadFake load;
+  MemInfoFake memory;
+  usage.setMany({}, {"cpus(*):1.0;mem(*):128"});
+  load.set(3.9, 2.9, 1.9);
+  memory.set("512MB", "300MB");
+
+  // Only the shadow policy ramps its offers up
+  auto config = makeConfiguration("cpus(*):2;mem(*):512", os::Load{4, 3, 2}, Bytes::parse("384MB").get());
+  config.stateDir = directory;
+  auto shadow = config;
+  shadow.offerRampIncrease = 0.25;
+  config.shadow = std::make_shared<Configuration const>(shadow);
+
+  {
+    ThresholdResourceEstimator estimator{Samplers(load, memory), config};
+    estimator.initialize(usage);
+    estimator.oversubscribable().get();
+    EXPECT_EQ(0.5, metricValue("threshold_resource_estimator/shadow/offered_revocable_cpus"));
+  }
+
+  // Continues rather than starting over from zero
+  ThresholdResourceEstimator estimator{Samplers(load, memory), config};
+  estimator.initialize(usage);
+  EXPECT_EQ(2.0, estimator.oversubscribable().get().revocable().cpus().get());
+  EXPECT_EQ(1.0, metricValue("threshold_resource_estimator/shadow/offered_revocable_cpus"));
+
+  os::rmdir(directory);
+}
+
 } // namespace {
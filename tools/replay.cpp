@@ -0,0 +1,558 @@
+/*
+ * Replays recorded host metrics and resource usage through the threshold
+ * estimator and controller to compare different parameter sets offline.
+ *
+ * The trace is a file with one JSON object per line and sample:
+ *
+ *   {"timestamp": 1570000000.0,
+ *    "load": [12.1, 10.5, 9.8],
+ *    "meminfo": {"total_bytes": 270000000000, "available_bytes": 90000000000},
+ *    "vmstat": {"pgscan_direct": 0, "pgsteal": 0, "allocstall": 0, "pswpin": 0, "pswpout": 0},
+ *    "diskstats": {"sda": {"io_ticks": 1200, "time_in_queue": 3400}},
+ *    "netdev": {"eth0": {"rx_bytes": 5600, "tx_bytes": 7800, "speed": 25000}},
+ *    "schedstat": {"run_delay": 81234000, "timeslices": 52000},
+ *    "cpufreq": {"current_khz": 89600000, "nominal_khz": 102400000, "throttle_events": 0},
+ *    "usage": { ...ResourceUsage as reported by the agent... }}
+ *
+ * A missing `load`, `meminfo`, `vmstat`, `diskstats`, `netdev`, `schedstat`
+ * or `cpufreq` is replayed as a failed sample. The `vmstat`, `diskstats`,
+ * `netdev`, `schedstat` and `cpufreq` counters are only needed if any
+ * reclaim, I/O, network, run queue or CPU frequency threshold is set,
+ * respectively. The link `speed` is given in Mbit/s, the `run_delay` in
+ * nanoseconds. The `run_delay` and all `cpufreq` values are summed up over
+ * all CPUs. A `nominal_khz` of 0 stands for an unknown nominal frequency.
+ * A missing `usage` is replayed as an agent without executors.
+ *
+ * The parameter sets are given as a file with one JSON object per line and
+ * set, holding the module parameters of estimator and controller:
+ *
+ *   {"name": "conservative",
+ *    "estimator": {"resources": "cpus:16;mem:96000", "load_threshold_5min": "48"},
+ *    "controller": {"load_threshold_5min": "60", "mem_threshold": "230000"}}
+ *
+ * Executors killed by the controller are removed from all subsequent usage
+ * samples. Load and memory are replayed as recorded, i.e. the effect of a
+ * kill on the host metrics is not simulated.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stout/flags.hpp>
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/os.hpp>
+#include <stout/protobuf.hpp>
+#include <stout/strings.hpp>
+
+#include <glog/logging.h>
+
+#include <process/future.hpp>
+
+#include <mesos/resources.hpp>
+
+#include "config.hpp"
+#include "os.hpp"
+#include "policy.hpp"
+#include "samplers.hpp"
+#include "threshold.hpp"
+#include "threshold_qos_controller.hpp"
+#include "threshold_resource_estimator.hpp"
+
+using std::list;
+using std::string;
+using std::vector;
+
+using process::Future;
+
+using mesos::Resources;
+using mesos::ResourceUsage;
+using mesos::slave::QoSCorrection;
+
+using ::os::Load;
+
+using com::blue_yonder::Configuration;
+using com::blue_yonder::HostSample;
+using com::blue_yonder::SignalState;
+using com::blue_yonder::ThresholdQoSController;
+using com::blue_yonder::ThresholdResourceEstimator;
+using com::blue_yonder::Samplers;
+using com::blue_yonder::os::CpuFreq;
+using com::blue_yonder::os::DiskCounters;
+using com::blue_yonder::os::DiskStats;
+using com::blue_yonder::os::InterfaceCounters;
+using com::blue_yonder::os::MemInfo;
+using com::blue_yonder::os::NetDev;
+using com::blue_yonder::os::SchedStat;
+using com::blue_yonder::os::VmStat;
+using com::blue_yonder::parametersFromJSON;
+using com::blue_yonder::parseConfiguration;
+
+namespace rules = com::blue_yonder::rules;
+
+
+namespace {
+
+class Flags : public virtual flags::FlagsBase
+{
+public:
+  Flags()
+  {
+    add(&Flags::trace,
+        "trace",
+        "Path to the recorded samples, one JSON object per line.");
+
+    add(&Flags::parameters,
+        "parameters",
+        "Path to the parameter sets to evaluate, one JSON object per line.");
+
+    add(&Flags::verbose,
+        "verbose",
+        "Log the decisions of estimator and controller to stderr.",
+        false);
+  }
+
+  Option<string> trace;
+  Option<string> parameters;
+  bool verbose;
+};
+
+
+struct Sample
+{
+  double timestamp;
+  Try<Load> load;
+  Try<MemInfo> memory;
+  Try<VmStat> vmstat;
+  Try<DiskStats> diskstats;
+  Try<NetDev> netdev;
+  Try<SchedStat> schedstat;
+  Try<CpuFreq> cpufreq;
+  ResourceUsage usage;
+};
+
+struct ParameterSet
+{
+  string name;
+  Configuration estimator;
+  Configuration controller;
+};
+
+struct Report
+{
+  double duration = 0;
+  double offeredCpuSeconds = 0;
+  double offeredMemSeconds = 0; // MB * seconds
+  size_t kills = 0;
+  double estimatorOverloadSeconds = 0;
+  double controllerOverloadSeconds = 0;
+};
+
+
+Try<vector<JSON::Object>> readObjects(string const& path) {
+  Try<string> content = ::os::read(path);
+  if (content.isError()) {
+    return Error("Failed to read '" + path + "': " + content.error());
+  }
+
+  vector<JSON::Object> objects;
+  size_t lineNumber = 0;
+  foreach (string const& line, strings::split(content.get(), "\n")) {
+    ++lineNumber;
+    if (strings::trim(line).empty()) {
+      continue;
+    }
+    Try<JSON::Object> object = JSON::parse<JSON::Object>(line);
+    if (object.isError()) {
+      return Error(path + ":" + stringify(lineNumber) + ": " + object.error());
+    }
+    objects.push_back(object.get());
+  }
+  return objects;
+}
+
+Try<Sample> parseSample(JSON::Object const& object) {
+  Result<JSON::Number> timestamp = object.find<JSON::Number>("timestamp");
+  if (!timestamp.isSome()) {
+    return Error("Sample without a valid 'timestamp'");
+  }
+
+  Try<Load> load = Error("No load recorded");
+  Result<JSON::Array> loadValues = object.find<JSON::Array>("load");
+  if (loadValues.isSome()) {
+    if (loadValues.get().values.size() != 3) {
+      return Error("Expected three load averages");
+    }
+    vector<double> averages;
+    foreach (JSON::Value const& value, loadValues.get().values) {
+      if (!value.is<JSON::Number>()) {
+        return Error("Load averages must be numbers");
+      }
+      averages.push_back(value.as<JSON::Number>().as<double>());
+    }
+    load = Load{averages[0], averages[1], averages[2]};
+  }
+
+  Try<MemInfo> memory = Error("No meminfo recorded");
+  Result<JSON::Number> total = object.find<JSON::Number>("meminfo.total_bytes");
+  Result<JSON::Number> available = object.find<JSON::Number>("meminfo.available_bytes");
+  if (total.isSome() && available.isSome()) {
+    memory = MemInfo{
+      Bytes(total.get().as<uint64_t>()),
+      Bytes(available.get().as<uint64_t>())};
+  }
+
+  Try<VmStat> vmstat = Error("No vmstat recorded");
+  Result<JSON::Object> vmstatObject = object.find<JSON::Object>("vmstat");
+  if (vmstatObject.isSome()) {
+    VmStat stat{timestamp.get().as<double>(), 0, 0, 0, 0, 0};
+    vector<std::pair<string, uint64_t*>> const counters = {
+      {"pgscan_direct", &stat.pgscanDirect},
+      {"pgsteal", &stat.pgsteal},
+      {"allocstall", &stat.allocstall},
+      {"pswpin", &stat.pswpin},
+      {"pswpout", &stat.pswpout}};
+    foreach (auto const& counter, counters) {
+      Result<JSON::Number> value = vmstatObject.get().find<JSON::Number>(counter.first);
+      if (!value.isSome()) {
+        return Error("Sample without a valid 'vmstat." + counter.first + "'");
+      }
+      *counter.second = value.get().as<uint64_t>();
+    }
+    vmstat = stat;
+  }
+
+  Try<DiskStats> diskstats = Error("No diskstats recorded");
+  Result<JSON::Object> diskstatsObject = object.find<JSON::Object>("diskstats");
+  if (diskstatsObject.isSome()) {
+    DiskStats stats{timestamp.get().as<double>(), {}};
+    foreachpair (string const& device, JSON::Value const& counters, diskstatsObject.get().values) {
+      if (!counters.is<JSON::Object>()) {
+        return Error("Counters of device '" + device + "' must be an object");
+      }
+      Result<JSON::Number> ioTicks = counters.as<JSON::Object>().find<JSON::Number>("io_ticks");
+      Result<JSON::Number> timeInQueue =
+        counters.as<JSON::Object>().find<JSON::Number>("time_in_queue");
+      if (!ioTicks.isSome() || !timeInQueue.isSome()) {
+        return Error("Sample without valid counters for device '" + device + "'");
+      }
+      stats.devices[device] =
+        DiskCounters{ioTicks.get().as<uint64_t>(), timeInQueue.get().as<uint64_t>()};
+    }
+    diskstats = stats;
+  }
+
+  Try<NetDev> netdev = Error("No netdev recorded");
+  Result<JSON::Object> netdevObject = object.find<JSON::Object>("netdev");
+  if (netdevObject.isSome()) {
+    NetDev stats{timestamp.get().as<double>(), {}};
+    foreachpair (string const& interface, JSON::Value const& counters, netdevObject.get().values) {
+      if (!counters.is<JSON::Object>()) {
+        return Error("Counters of interface '" + interface + "' must be an object");
+      }
+      Result<JSON::Number> rxBytes = counters.as<JSON::Object>().find<JSON::Number>("rx_bytes");
+      Result<JSON::Number> txBytes = counters.as<JSON::Object>().find<JSON::Number>("tx_bytes");
+      Result<JSON::Number> speed = counters.as<JSON::Object>().find<JSON::Number>("speed");
+      if (!rxBytes.isSome() || !txBytes.isSome() || !speed.isSome()) {
+        return Error("Sample without valid counters for interface '" + interface + "'");
+      }
+      stats.interfaces[interface] = InterfaceCounters{
+        rxBytes.get().as<uint64_t>(),
+        txBytes.get().as<uint64_t>(),
+        speed.get().as<uint64_t>()};
+    }
+    netdev = stats;
+  }
+
+  Try<SchedStat> schedstat = Error("No schedstat recorded");
+  Result<JSON::Object> schedstatObject = object.find<JSON::Object>("schedstat");
+  if (schedstatObject.isSome()) {
+    Result<JSON::Number> runDelay = schedstatObject.get().find<JSON::Number>("run_delay");
+    Result<JSON::Number> timeslices = schedstatObject.get().find<JSON::Number>("timeslices");
+    if (!runDelay.isSome() || !timeslices.isSome()) {
+      return Error("Sample without valid 'schedstat' counters");
+    }
+    schedstat = SchedStat{runDelay.get().as<uint64_t>(), timeslices.get().as<uint64_t>()};
+  }
+
+  Try<CpuFreq> cpufreq = Error("No cpufreq recorded");
+  Result<JSON::Object> cpufreqObject = object.find<JSON::Object>("cpufreq");
+  if (cpufreqObject.isSome()) {
+    Result<JSON::Number> current = cpufreqObject.get().find<JSON::Number>("current_khz");
+    Result<JSON::Number> nominal = cpufreqObject.get().find<JSON::Number>("nominal_khz");
+    Result<JSON::Number> throttleEvents =
+      cpufreqObject.get().find<JSON::Number>("throttle_events");
+    if (!current.isSome() || !nominal.isSome() || !throttleEvents.isSome()) {
+      return Error("Sample without valid 'cpufreq' counters");
+    }
+    cpufreq = CpuFreq{
+      current.get().as<uint64_t>(),
+      nominal.get().as<uint64_t>(),
+      throttleEvents.get().as<uint64_t>()};
+  }
+
+  ResourceUsage usage;
+  Result<JSON::Object> usageObject = object.find<JSON::Object>("usage");
+  if (usageObject.isSome()) {
+    Try<ResourceUsage> parsed = ::protobuf::parse<ResourceUsage>(usageObject.get());
+    if (parsed.isError()) {
+      return Error("Failed to parse usage: " + parsed.error());
+    }
+    usage = parsed.get();
+  }
+
+  return Sample{
+    timestamp.get().as<double>(),
+    load,
+    memory,
+    vmstat,
+    diskstats,
+    netdev,
+    schedstat,
+    cpufreq,
+    usage};
+}
+
+Try<ParameterSet> parseParameterSet(JSON::Object const& object) {
+  ParameterSet set;
+
+  Result<JSON::String> name = object.find<JSON::String>("name");
+  if (!name.isSome()) {
+    return Error("Parameter set without a 'name'");
+  }
+  set.name = name.get().value;
+
+  foreach (string const& module, vector<string>({"estimator", "controller"})) {
+    Result<JSON::Object> values = object.find<JSON::Object>(module);
+    if (values.isError()) {
+      return Error(set.name + ": " + values.error());
+    }
+
+    Try<mesos::Parameters> parameters =
+      parametersFromJSON(values.isSome() ? values.get() : JSON::Object());
+    if (parameters.isError()) {
+      return Error(set.name + ": " + parameters.error());
+    }
+
+    Try<Configuration> config = parseConfiguration(parameters.get());
+    if (config.isError()) {
+      return Error(set.name + ": " + config.error());
+    }
+    (module == "estimator" ? set.estimator : set.controller) = config.get();
+  }
+  return set;
+}
+
+
+/*
+ * Feeds the current sample to estimator and controller via their injection
+ * points, in the same way the test fakes do.
+ */
+class Feeder
+{
+public:
+  Feeder() : current{std::make_shared<std::shared_ptr<Sample const>>()} {}
+
+  void set(Sample const& sample) {
+    *current = std::make_shared<Sample const>(sample);
+  }
+
+  Samplers samplers() const {
+    auto const current = this->current;
+    Samplers samplers(
+      [current]() { return (*current)->load; },
+      [current]() { return (*current)->memory; });
+    samplers.vmstat = [current]() { return (*current)->vmstat; };
+    samplers.diskstats = [current]() { return (*current)->diskstats; };
+    samplers.netdev = [current]() { return (*current)->netdev; };
+    samplers.schedstat = [current]() { return (*current)->schedstat; };
+    samplers.cpufreq = [current]() { return (*current)->cpufreq; };
+    return samplers;
+  }
+
+  std::function<Future<ResourceUsage>()> usage() const {
+    auto const current = this->current;
+    return [current]() { return Future<ResourceUsage>((*current)->usage); };
+  }
+
+private:
+  std::shared_ptr<std::shared_ptr<Sample const>> current;
+};
+
+
+ResourceUsage withoutKilled(
+    ResourceUsage const& usage,
+    std::set<std::pair<string, string>> const& killed)
+{
+  ResourceUsage result;
+  result.mutable_total()->CopyFrom(usage.total());
+  foreach (ResourceUsage::Executor const& executor, usage.executors()) {
+    auto const id = std::make_pair(
+      executor.executor_info().framework_id().value(),
+      executor.executor_info().executor_id().value());
+    if (killed.count(id) == 0) {
+      result.add_executors()->CopyFrom(executor);
+    }
+  }
+  return result;
+}
+
+// Whether any of the host thresholds of the configuration is exceeded. The
+// throttling of executors is not taken into account.
+bool overloaded(Sample const& sample, SignalState& signals, Configuration const& config) {
+  // Derive the signals first so that they see every sample
+  HostSample const host{
+    sample.load,
+    sample.memory,
+    sample.vmstat,
+    sample.diskstats,
+    sample.netdev,
+    sample.schedstat,
+    sample.cpufreq};
+  return rules::HostOverload::reached(signals.update(host, None(), config), config);
+}
+
+Report replay(vector<Sample> const& samples, ParameterSet const& set) {
+  Feeder feeder;
+  ThresholdResourceEstimator estimator(feeder.samplers(), set.estimator);
+  ThresholdQoSController controller(feeder.samplers(), set.controller);
+
+  Report report;
+  std::set<std::pair<string, string>> killed;
+  SignalState estimatorSignals;
+  SignalState controllerSignals;
+
+  for (size_t i = 0; i < samples.size(); ++i) {
+    Sample sample = samples[i];
+    sample.usage = withoutKilled(sample.usage, killed);
+    feeder.set(sample);
+
+    if (i == 0) {
+      estimator.initialize(feeder.usage());
+      controller.initialize(feeder.usage());
+    }
+
+    // Each sample is weighted with the time until the next one.
+    double const interval =
+      i + 1 < samples.size() ? samples[i + 1].timestamp - sample.timestamp : 0;
+    report.duration += interval;
+
+    Resources const offered = estimator.oversubscribable().get();
+    report.offeredCpuSeconds += offered.cpus().getOrElse(0) * interval;
+    report.offeredMemSeconds += offered.mem().getOrElse(Bytes(0)).megabytes() * interval;
+
+    list<QoSCorrection> const corrections = controller.corrections().get();
+    foreach (QoSCorrection const& correction, corrections) {
+      if (correction.has_kill()) {
+        ++report.kills;
+        killed.insert(std::make_pair(
+          correction.kill().framework_id().value(),
+          correction.kill().executor_id().value()));
+      }
+    }
+
+    if (overloaded(sample, estimatorSignals, set.estimator)) {
+      report.estimatorOverloadSeconds += interval;
+    }
+    if (overloaded(sample, controllerSignals, set.controller)) {
+      report.controllerOverloadSeconds += interval;
+    }
+  }
+
+  return report;
+}
+
+void print(ParameterSet const& set, Report const& report) {
+  double const duration = report.duration > 0 ? report.duration : 1;
+  std::cout << std::left << std::setw(24) << set.name << std::right << std::fixed
+            << std::setprecision(2)
+            << std::setw(14) << report.offeredCpuSeconds / duration
+            << std::setw(14) << report.offeredMemSeconds / duration
+            << std::setw(8) << report.kills
+            << std::setw(14) << 100 * report.estimatorOverloadSeconds / duration
+            << std::setw(14) << 100 * report.controllerOverloadSeconds / duration
+            << std::endl;
+}
+
+} // namespace {
+
+
+int main(int argc, char** argv) {
+  Flags flags;
+  Try<flags::Warnings> load = flags.load(None(), argc, argv);
+  if (load.isError()) {
+    std::cerr << flags.usage(load.error()) << std::endl;
+    return 1;
+  }
+  if (flags.help) {
+    std::cout << flags.usage() << std::endl;
+    return 0;
+  }
+  if (flags.trace.isNone() || flags.parameters.isNone()) {
+    std::cerr << flags.usage("Both --trace and --parameters are required") << std::endl;
+    return 1;
+  }
+
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+  FLAGS_minloglevel = flags.verbose ? google::INFO : google::WARNING;
+
+  vector<Sample> samples;
+  vector<ParameterSet> sets;
+
+  Try<vector<JSON::Object>> sampleObjects = readObjects(flags.trace.get());
+  if (sampleObjects.isError()) {
+    std::cerr << sampleObjects.error() << std::endl;
+    return 1;
+  }
+  foreach (JSON::Object const& object, sampleObjects.get()) {
+    Try<Sample> sample = parseSample(object);
+    if (sample.isError()) {
+      std::cerr << "Invalid sample: " << sample.error() << std::endl;
+      return 1;
+    }
+    samples.push_back(sample.get());
+  }
+
+  Try<vector<JSON::Object>> setObjects = readObjects(flags.parameters.get());
+  if (setObjects.isError()) {
+    std::cerr << setObjects.error() << std::endl;
+    return 1;
+  }
+  foreach (JSON::Object const& object, setObjects.get()) {
+    Try<ParameterSet> set = parseParameterSet(object);
+    if (set.isError()) {
+      std::cerr << "Invalid parameter set: " << set.error() << std::endl;
+      return 1;
+    }
+    sets.push_back(set.get());
+  }
+
+  if (samples.empty()) {
+    std::cerr << "No samples in " << flags.trace.get() << std::endl;
+    return 1;
+  }
+
+  std::cout << "Replaying " << samples.size() << " samples over "
+            << samples.back().timestamp - samples.front().timestamp << " seconds" << std::endl
+            << std::endl;
+  std::cout << std::left << std::setw(24) << "parameter set" << std::right
+            << std::setw(14) << "avg cpus"
+            << std::setw(14) << "avg mem (MB)"
+            << std::setw(8) << "kills"
+            << std::setw(14) << "% est. over"
+            << std::setw(14) << "% ctrl. over"
+            << std::endl;
+
+  foreach (ParameterSet const& set, sets) {
+    print(set, replay(samples, set));
+  }
+
+  return 0;
+}